@@ -5,9 +5,11 @@
 #include <stdio.h>
 #include "analyze.h"
 #include "globals.h"
+#include "util.h"
 #include "symtab.h"
+#include "outbuf.h"
 
-static int location = 0;
+static THREAD_LOCAL int location = 0;
 
 void insertNode(TreeNode *t) {
     switch (t->nodekind) {
@@ -30,13 +32,18 @@ void insertNode(TreeNode *t) {
                         t = t->child[0];
                         if (symTabLookUp(t->attr.name) == -1)
                             symTabInsert(t->attr.name, t->lineno, location++);
-                        else
-                            fprintf(listing, "The variable %s has been repeatedly defined at line %d.", t->attr.name,
-                                    t->lineno);
+                        else {
+                            OutBuf *out = outOpen(listing);
+                            outPuts(out, "The variable ");
+                            outPuts(out, t->attr.name);
+                            outPuts(out, " has been repeatedly defined at line ");
+                            outInt(out, t->lineno);
+                            outChar(out, '.');
+                        }
                     }
                     break;
                 default:
-                    fprintf(listing, "This is an error nodeKind statement.");
+                    outPuts(outOpen(listing), "This is an error nodeKind statement.");
                     break;
             }
             break;
@@ -54,12 +61,12 @@ void insertNode(TreeNode *t) {
                 case BoolK:
                     break;
                 default:
-                    fprintf(listing, "This is an error nodeKind expression.");
+                    outPuts(outOpen(listing), "This is an error nodeKind expression.");
                     break;
             }
             break;
         default:
-            fprintf(listing, "This is an error nodeKind.\n");
+            outPuts(outOpen(listing), "This is an error nodeKind.\n");
             break;
     }
 }
@@ -67,7 +74,13 @@ void insertNode(TreeNode *t) {
 void nullProc(TreeNode *t) {}
 
 void typeError(TreeNode *t, char *message) {
-    fprintf(listing, "Type error at line %d: %s\n", t->lineno, message);
+    OutBuf *out = outOpen(listing);
+    outPuts(out, "Type error at line ");
+    outInt(out, t->lineno);
+    outPuts(out, ": ");
+    outPuts(out, message);
+    outChar(out, '\n');
+    addDiagnostic(t->lineno, message);
     Error = TRUE;
 }
 
@@ -138,9 +151,12 @@ void traverse(TreeNode *t, void (*preProc)(TreeNode *), void (*postProc)(TreeNod
 }*/
 
 void buildSymTab(TreeNode *syntaxTree) {
+    /*每次编译从空的符号表开始*/
+    symTabClear();
+    location = 0;
     traverse(syntaxTree, insertNode, nullProc);
-    if (TraceAnalyze) {
-        fprintf(listing, "\nSymbol table:\n");
+    if (TRACING(TRACE_ANALYZE, 1)) {
+        outPuts(outOpen(listing), "\nSymbol table:\n");
         printSymTab(listing);
     }
 }
@@ -0,0 +1,158 @@
+//
+// Created by liang on 2020/7/12.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include "globals.h"
+#include "translate.h"
+#include "aot.h"
+
+/*C中的关系运算符，按操作码JEQ到JGE排列*/
+static const char *relations[] = {"==", "<", ">", "<=", ">="};
+
+/*C中的算术运算，加减乘按无符号数回绕，与常量折叠和虚拟机一致*/
+static const char *arithmetics[] = {"+", "-", "*"};
+
+/*输出一个操作数：常量写为它的值，变量加上前缀v_，避免与C的关键字冲突*/
+static void emitOperand(VMProgram *prog, FILE *file, int slot) {
+    char *name = vmSlotName(prog, slot);
+    if (isConstant(name))
+        fprintf(file, "%d", prog->init[slot]);
+    else
+        fprintf(file, "v_%s", name);
+}
+
+/*输出C字符串字面量*/
+static void emitString(FILE *file, const char *s) {
+    fputc('"', file);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\' || *s == '?')
+            fputc('\\', file);
+        fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+/*把程序翻译为独立的C源文件*/
+void aotEmit(VMProgram *prog, FILE *file) {
+    int i, first = TRUE, line = 0;
+    char *isTarget = (char *) calloc(prog->codeNum + 1, sizeof(char));
+    VMInstr *ins;
+    for (i = 0; i < prog->codeNum; i++)
+        if (prog->code[i].op >= OP_JMP && prog->code[i].op <= OP_JGE)
+            isTarget[prog->code[i].c] = TRUE;
+
+    fprintf(file, "/* Generated by the TINY compiler. */\n");
+    fprintf(file, "#include <stdio.h>\n#include <stdlib.h>\n\n");
+    if (prog->stringNum > 0) {
+        fprintf(file, "static const char *strings[%d] = {", prog->stringNum);
+        for (i = 0; i < prog->stringNum; i++) {
+            fprintf(file, i == 0 ? "\n        " : ",\n        ");
+            emitString(file, vmString(prog, i));
+        }
+        fprintf(file, "\n};\n\n");
+    }
+    fprintf(file, "static int tiny_div(int a, int b) {\n"
+                  "    if (b == 0) {\n"
+                  "        fprintf(stderr, \"Runtime error: division by zero\\n\");\n"
+                  "        exit(%d);\n"
+                  "    }\n"
+                  "    return b == -1 ? (int) (0u - (unsigned) a) : a / b;\n"
+                  "}\n\n", VM_DIV_ZERO);
+    fprintf(file, "static int tiny_in(void) {\n"
+                  "    int v;\n"
+                  "    if (scanf(\"%%d\", &v) != 1) {\n"
+                  "        fprintf(stderr, \"Runtime error: bad input\\n\");\n"
+                  "        exit(%d);\n"
+                  "    }\n"
+                  "    return v;\n"
+                  "}\n\n", VM_BAD_INPUT);
+    if (prog->stringNum > 0)
+        fprintf(file, "static void tiny_out_string(int v) {\n"
+                      "    if (v >= 0 && v < %d)\n"
+                      "        printf(\"%%s\\n\", strings[v]);\n"
+                      "    else\n"
+                      "        printf(\"%%d\\n\", v);\n"
+                      "}\n\n", prog->stringNum);
+    fprintf(file, "int main(void) {\n");
+    for (i = 0; i < prog->regNum; i++) {
+        if (isConstant(vmSlotName(prog, i)))
+            continue;
+        fprintf(file, first ? "    int " : ",\n        ");
+        fprintf(file, "v_%s = 0", vmSlotName(prog, i));
+        first = FALSE;
+    }
+    if (!first)
+        fprintf(file, ";\n");
+
+    for (i = 0; i < prog->codeNum; i++) {
+        ins = &prog->code[i];
+        if (isTarget[i])
+            fprintf(file, "L%d:\n", i);
+        if (prog->lines[i] > 0 && prog->lines[i] != line) {
+            line = prog->lines[i];
+            fprintf(file, "    /* line %d */\n", line);
+        }
+        fprintf(file, "    ");
+        switch (ins->op) {
+            case OP_MOVE:
+                emitOperand(prog, file, ins->c);
+                fprintf(file, " = ");
+                emitOperand(prog, file, ins->a);
+                fprintf(file, ";\n");
+                break;
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+                emitOperand(prog, file, ins->c);
+                fprintf(file, " = (int) ((unsigned) ");
+                emitOperand(prog, file, ins->a);
+                fprintf(file, " %s (unsigned) ", arithmetics[ins->op - OP_ADD]);
+                emitOperand(prog, file, ins->b);
+                fprintf(file, ");\n");
+                break;
+            case OP_DIV:
+                emitOperand(prog, file, ins->c);
+                fprintf(file, " = tiny_div(");
+                emitOperand(prog, file, ins->a);
+                fprintf(file, ", ");
+                emitOperand(prog, file, ins->b);
+                fprintf(file, ");\n");
+                break;
+            case OP_JMP:
+                fprintf(file, "goto L%d;\n", ins->c);
+                break;
+            case OP_JEQ:
+            case OP_JLT:
+            case OP_JGT:
+            case OP_JLE:
+            case OP_JGE:
+                fprintf(file, "if (");
+                emitOperand(prog, file, ins->a);
+                fprintf(file, " %s ", relations[ins->op - OP_JEQ]);
+                emitOperand(prog, file, ins->b);
+                fprintf(file, ") goto L%d;\n", ins->c);
+                break;
+            case OP_IN:
+                emitOperand(prog, file, ins->c);
+                fprintf(file, " = tiny_in();\n");
+                break;
+            case OP_OUT:
+                fprintf(file, "printf(\"%%d\\n\", ");
+                emitOperand(prog, file, ins->a);
+                fprintf(file, ");\n");
+                break;
+            case OP_OUTS:
+                fprintf(file, "tiny_out_string(");
+                emitOperand(prog, file, ins->a);
+                fprintf(file, ");\n");
+                break;
+            case OP_HALT:
+            default:
+                fprintf(file, "return 0;\n");
+                break;
+        }
+    }
+    fprintf(file, "}\n");
+    free(isTarget);
+}
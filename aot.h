@@ -0,0 +1,15 @@
+//
+// Created by liang on 2020/7/12.
+//
+
+#ifndef TINY_AOT_H
+#define TINY_AOT_H
+
+#include <stdio.h>
+#include "vm.h"
+
+/*把程序翻译为独立的C源文件：变量和临时变量成为局部变量，跳转目标成为标号，
+ * 跳转成为goto，IN和OUT成为scanf和printf。运行错误的退出码与虚拟机的运行结果相同*/
+void aotEmit(VMProgram *prog, FILE *file);
+
+#endif //TINY_AOT_H
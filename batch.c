@@ -0,0 +1,316 @@
+//
+// Created by liang on 2020/7/15.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "analyze.h"
+#include "translate.h"
+#include "outbuf.h"
+#include "stats.h"
+#include "batch.h"
+
+/*把扩展名ext接到name的前baseLen个字符之后，打开该文件；失败时在清单中报告*/
+static FILE *openOutput(char *name, size_t baseLen, const char *ext, const char *mode) {
+    FILE *file;
+    OutBuf *out;
+    strcpy(name + baseLen, ext);
+    file = fopen(name, mode);
+    if (file == NULL) {
+        out = outOpen(listing);
+        outPuts(out, "Unable to open ");
+        outPuts(out, name);
+        outChar(out, '\n');
+        addDiagnostic(0, "Unable to open output file");
+        Error = TRUE;
+    }
+    return file;
+}
+
+/*去掉pgm的扩展名后接上ext*/
+char *outputName(const char *pgm, const char *ext) {
+    const char *slash = strrchr(pgm, '/'), *dot = strrchr(pgm, '.');
+    size_t baseLen = dot != NULL && (slash == NULL || dot > slash) ? (size_t) (dot - pgm) : strlen(pgm);
+    char *name = (char *) malloc(baseLen + strlen(ext) + 1);
+    memcpy(name, pgm, baseLen);
+    strcpy(name + baseLen, ext);
+    return name;
+}
+
+/*分析已经打开的源文件source并建立符号表，有错误时返回NULL*/
+TreeNode *parseSource(void) {
+    TreeNode *syntaxTree;
+    OutBuf *out = outOpen(listing);
+    statsReset();
+    clearDiagnostics();
+    initScanner();
+    Error = FALSE;
+    statsBegin(PHASE_PARSE);
+    syntaxTree = parse();
+    statsEnd();
+    if (TRACING(TRACE_PARSE, 1)) {
+        outPuts(out, "\nSyntax tree:\n");
+        printTree(syntaxTree);
+    }
+    if (Error) {
+        freeTree(syntaxTree);
+        return NULL;
+    }
+    if (TRACING(TRACE_ANALYZE, 1))
+        outPuts(out, "\nBuilding Symbol Table...\n");
+    statsBegin(PHASE_ANALYZE);
+    buildSymTab(syntaxTree);
+    statsEnd();
+    /*if (TRACING(TRACE_ANALYZE, 1))
+        fprintf(listing, "\nChecking Types...\n");
+    typeCheck(syntaxTree);
+    if (TRACING(TRACE_ANALYZE, 1))
+        fprintf(listing, "\nType Checking Finished\n");*/
+    if (Error) {
+        freeTree(syntaxTree);
+        return NULL;
+    }
+    return syntaxTree;
+}
+
+/*编译已经打开的源文件source，没有错误时返回TRUE*/
+int compileSource(const char *pgm, int emitC) {
+    TreeNode *syntaxTree = parseSource();
+    char *codeFile;
+    size_t baseLen;
+    if (syntaxTree == NULL)
+        return FALSE;
+    /*输出文件名：去掉源文件的扩展名后加上.tm、.tnb或.c*/
+    codeFile = outputName(pgm, ".tnb");
+    baseLen = strlen(codeFile) - 4;
+    code = openOutput(codeFile, baseLen, ".tm", "w");
+    binary = code != NULL ? openOutput(codeFile, baseLen, ".tnb", "wb") : NULL;
+    ccode = binary != NULL && emitC ? openOutput(codeFile, baseLen, ".c", "w") : NULL;
+    if (!Error) {
+        strcpy(codeFile + baseLen, ".tm");
+        codeGen(syntaxTree, codeFile);
+    }
+    freeTree(syntaxTree);
+    statsBegin(PHASE_OUTPUT);
+    if (code != NULL) {
+        outClose(code);
+        fclose(code);
+    }
+    if (binary != NULL)
+        fclose(binary);
+    if (ccode != NULL)
+        fclose(ccode);
+    free(codeFile);
+    statsEnd();
+    return !Error;
+}
+
+/*在列表末尾加一个源文件*/
+void batchAdd(BatchList *list, const char *file) {
+    if (list->num == list->capacity) {
+        list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        list->files = (char **) realloc(list->files, list->capacity * sizeof(char *));
+    }
+    list->files[list->num++] = copyString((char *) file);
+}
+
+/*读入清单文件，每行一个源文件*/
+int batchAddManifest(BatchList *list, const char *manifest) {
+    char line[1024];
+    size_t len;
+    FILE *file = fopen(manifest, "r");
+    if (file == NULL)
+        return FALSE;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        len = strlen(line);
+        while (len > 0 && isspace((unsigned char) line[len - 1]))
+            line[--len] = '\0';
+        if (len > 0 && line[0] != '#')
+            batchAdd(list, line);
+    }
+    fclose(file);
+    return TRUE;
+}
+
+/*一个文件的编译结果*/
+typedef struct BatchJobRec {
+    char *file;
+    int ok;
+    int quadNum;/*优化后的四元式条数*/
+    double ms;
+    char *log;/*该文件的清单*/
+    size_t logSize;
+    int done;
+} BatchJob;
+
+/*工作线程和它的任务队列，队列中是jobs[top]到jobs[bottom - 1]*/
+typedef struct WorkerRec {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int top;
+    int bottom;
+    int id;
+} Worker;
+
+static BatchJob *jobs;
+static Worker *workers;
+static int workerNum;
+
+/*选项是线程局部的，工作线程开始时复制主线程的选项*/
+static int mainTraceLevel[TRACE_NUM];
+static int mainOptimize;
+static int mainCollectStats;
+
+/*完成的任务，主线程按顺序等待并输出*/
+static pthread_mutex_t doneLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t doneCond = PTHREAD_COND_INITIALIZER;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*从自己的队列头部取一个任务，没有时返回-1*/
+static int takeJob(Worker *w) {
+    int job = -1;
+    pthread_mutex_lock(&w->lock);
+    if (w->top < w->bottom)
+        job = w->top++;
+    pthread_mutex_unlock(&w->lock);
+    return job;
+}
+
+/*从别的线程的队列尾部取走一半放进自己的队列，所有队列都空时返回FALSE*/
+static int stealJobs(Worker *w) {
+    Worker *victim;
+    int k, n, from = -1, to = -1;
+    for (k = 1; k < workerNum && from < 0; k++) {
+        victim = &workers[(w->id + k) % workerNum];
+        pthread_mutex_lock(&victim->lock);
+        n = victim->bottom - victim->top;
+        if (n > 0) {
+            to = victim->bottom;
+            from = to - (n + 1) / 2;
+            victim->bottom = from;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    if (from < 0)
+        return FALSE;
+    pthread_mutex_lock(&w->lock);
+    w->top = from;
+    w->bottom = to;
+    pthread_mutex_unlock(&w->lock);
+    return TRUE;
+}
+
+/*编译一个文件，清单写到内存中*/
+static void runJob(BatchJob *job) {
+    double start = now();
+    listing = open_memstream(&job->log, &job->logSize);
+    source = fopen(job->file, "r");
+    if (source == NULL) {
+        outPuts(outOpen(listing), "File not found\n");
+        job->ok = FALSE;
+    } else {
+        job->ok = compileSource(job->file, FALSE);
+        job->quadNum = curIndex;
+        fclose(source);
+    }
+    outClose(listing);
+    fclose(listing);
+    job->ms = (now() - start) * 1000;
+}
+
+static void *workerMain(void *arg) {
+    Worker *w = (Worker *) arg;
+    int job;
+    memcpy(traceLevel, mainTraceLevel, sizeof(mainTraceLevel));
+    Optimize = mainOptimize;
+    CollectStats = mainCollectStats;
+    for (;;) {
+        job = takeJob(w);
+        if (job < 0) {
+            if (!stealJobs(w))
+                break;
+            continue;
+        }
+        runJob(&jobs[job]);
+        pthread_mutex_lock(&doneLock);
+        jobs[job].done = TRUE;
+        pthread_cond_broadcast(&doneCond);
+        pthread_mutex_unlock(&doneLock);
+    }
+    return NULL;
+}
+
+/*批量编译，返回失败的文件数*/
+int batchCompile(BatchList *list, int threads) {
+    OutBuf *out = outOpen(stdout);
+    double start = now();
+    int i, failed = 0;
+    if (list->num == 0)
+        return 0;
+    workerNum = threads < 1 ? 1 : threads > list->num ? list->num : threads;
+    jobs = (BatchJob *) calloc(list->num, sizeof(BatchJob));
+    workers = (Worker *) calloc(workerNum, sizeof(Worker));
+    for (i = 0; i < list->num; i++)
+        jobs[i].file = list->files[i];
+    memcpy(mainTraceLevel, traceLevel, sizeof(mainTraceLevel));
+    mainOptimize = Optimize;
+    mainCollectStats = CollectStats;
+    /*开始时每个线程分到连续的一段文件*/
+    for (i = 0; i < workerNum; i++) {
+        workers[i].id = i;
+        workers[i].top = (int) ((long) list->num * i / workerNum);
+        workers[i].bottom = (int) ((long) list->num * (i + 1) / workerNum);
+        pthread_mutex_init(&workers[i].lock, NULL);
+    }
+    for (i = 0; i < workerNum; i++)
+        pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]);
+    /*按文件的顺序输出结果，不受完成先后的影响*/
+    for (i = 0; i < list->num; i++) {
+        pthread_mutex_lock(&doneLock);
+        while (!jobs[i].done)
+            pthread_cond_wait(&doneCond, &doneLock);
+        pthread_mutex_unlock(&doneLock);
+        outWrite(out, jobs[i].log, jobs[i].logSize);
+        if (jobs[i].logSize > 0 && jobs[i].log[jobs[i].logSize - 1] != '\n')
+            outChar(out, '\n');
+        outPuts(out, jobs[i].file);
+        if (jobs[i].ok) {
+            outPuts(out, ": ok, ");
+            outInt(out, jobs[i].quadNum);
+            outPuts(out, " quadruples, ");
+            outInt(out, (long) (jobs[i].ms * 1000));
+            outPuts(out, " us\n");
+        } else {
+            outPuts(out, ": failed\n");
+            failed++;
+        }
+        free(jobs[i].log);
+    }
+    for (i = 0; i < workerNum; i++)
+        pthread_join(workers[i].thread, NULL);
+    for (i = 0; i < workerNum; i++)
+        pthread_mutex_destroy(&workers[i].lock);
+    outInt(out, list->num);
+    outPuts(out, " files, ");
+    outInt(out, failed);
+    outPuts(out, " failed, ");
+    outInt(out, workerNum);
+    outPuts(out, " threads, ");
+    outInt(out, (long) ((now() - start) * 1000));
+    outPuts(out, " ms\n");
+    outFlush(out);
+    free(workers);
+    free(jobs);
+    return failed;
+}
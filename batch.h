@@ -0,0 +1,37 @@
+//
+// Created by liang on 2020/7/15.
+//
+
+#ifndef TINY_BATCH_H
+#define TINY_BATCH_H
+
+#include "globals.h"
+
+/*去掉pgm的扩展名后接上ext，返回malloc分配的新文件名*/
+char *outputName(const char *pgm, const char *ext);
+
+/*分析已经打开的源文件source并建立符号表，跟踪信息写到listing。有错误时释放语法树并返回NULL*/
+TreeNode *parseSource(void);
+
+/*编译已经打开的源文件source（文件名为pgm），清单写到listing，生成<name>.tm和<name>.tnb，
+ * emitC为TRUE时还生成<name>.c。没有错误时返回TRUE。编译状态都是线程局部的，可以在多个线程中同时调用*/
+int compileSource(const char *pgm, int emitC);
+
+/*批量编译的源文件列表*/
+typedef struct BatchListRec {
+    char **files;
+    int num;
+    int capacity;
+} BatchList;
+
+/*在列表末尾加一个源文件*/
+void batchAdd(BatchList *list, const char *file);
+
+/*读入清单文件，每行一个源文件，空行和#开头的行忽略。打不开时返回FALSE*/
+int batchAddManifest(BatchList *list, const char *manifest);
+
+/*用threads个工作线程编译列表中的所有文件。每个线程有一个任务队列，自己的队列空了就从
+ * 别的线程的队列尾部取走一半。每个文件的清单和结果按列表的顺序输出到stdout，返回失败的文件数*/
+int batchCompile(BatchList *list, int threads);
+
+#endif //TINY_BATCH_H
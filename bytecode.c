@@ -0,0 +1,234 @@
+//
+// Created by liang on 2020/7/11.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "bytecode.h"
+
+/*各操作码对应的四元式操作符*/
+static const char *opNames[] = {
+        ":=", "plus", "minus", "times", "over",
+        "j", "j=", "j<", "j>", "j<=", "j>=",
+        "IN", "OUT", "OUT", "HALT"
+};
+
+/*按8字节对齐*/
+#define ALIGN8(x) (((x) + 7u) & ~7u)
+
+/*写一节并补齐到8字节*/
+static void writeSection(FILE *file, const void *data, size_t size) {
+    static const char zeros[8] = {0};
+    if (size > 0)
+        fwrite(data, 1, size, file);
+    fwrite(zeros, 1, ALIGN8(size) - size, file);
+}
+
+/*把程序写成字节码文件，成功返回TRUE*/
+int bcWrite(VMProgram *prog, FILE *file) {
+    BCHeader h;
+    VMInstr *code = (VMInstr *) malloc((prog->codeNum + 1) * sizeof(VMInstr));
+    int i;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BC_MAGIC, 4);
+    h.version = BC_VERSION;
+    h.byteOrder = BC_BYTE_ORDER;
+    h.codeNum = prog->codeNum;
+    h.codeOff = ALIGN8(sizeof(BCHeader));
+    h.regNum = prog->regNum;
+    h.initOff = h.codeOff + ALIGN8(prog->codeNum * sizeof(VMInstr));
+    h.lineOff = h.initOff + ALIGN8(prog->regNum * sizeof(int32_t));
+    h.nameOff = h.lineOff + ALIGN8(prog->codeNum * sizeof(int32_t));
+    h.stringNum = prog->stringNum;
+    h.stringOff = h.nameOff + ALIGN8(prog->regNum * sizeof(int32_t));
+    h.poolSize = prog->poolSize;
+    h.poolOff = h.stringOff + ALIGN8(prog->stringNum * sizeof(int32_t));
+    h.size = h.poolOff + ALIGN8(prog->poolSize);
+    /*处理代码的地址只在本进程内有效，文件中清零*/
+    memcpy(code, prog->code, prog->codeNum * sizeof(VMInstr));
+    for (i = 0; i < prog->codeNum; i++)
+        code[i].u.reserved = 0;
+    writeSection(file, &h, sizeof(BCHeader));
+    writeSection(file, code, prog->codeNum * sizeof(VMInstr));
+    writeSection(file, prog->init, prog->regNum * sizeof(int32_t));
+    writeSection(file, prog->lines, prog->codeNum * sizeof(int32_t));
+    writeSection(file, prog->nameOff, prog->regNum * sizeof(int32_t));
+    writeSection(file, prog->stringOff, prog->stringNum * sizeof(int32_t));
+    writeSection(file, prog->pool, prog->poolSize);
+    free(code);
+    return !ferror(file);
+}
+
+/*检查第off字节起的num个大小为size的元素是否在文件内并且对齐*/
+static int sectionValid(BCHeader *h, uint32_t off, uint32_t num, size_t size) {
+    return off % 8 == 0 && off <= h->size && num <= (h->size - off) / size;
+}
+
+/*检查映射进来的文件，所有下标都不越界时返回NULL，否则返回原因*/
+static const char *validate(BCHeader *h, VMProgram *prog) {
+    int i, jumps;
+    VMInstr *ins;
+    if (!sectionValid(h, h->codeOff, h->codeNum, sizeof(VMInstr)) || h->codeNum == 0
+        || !sectionValid(h, h->initOff, h->regNum, sizeof(int32_t))
+        || !sectionValid(h, h->lineOff, h->codeNum, sizeof(int32_t))
+        || !sectionValid(h, h->nameOff, h->regNum, sizeof(int32_t))
+        || !sectionValid(h, h->stringOff, h->stringNum, sizeof(int32_t))
+        || !sectionValid(h, h->poolOff, h->poolSize, 1)
+        || (h->poolSize > 0 && prog->pool[h->poolSize - 1] != '\0'))
+        return "section out of range";
+    if (prog->code[prog->codeNum - 1].op != OP_HALT)
+        return "missing final HALT";
+    for (i = 0; i < prog->regNum; i++)
+        if (prog->nameOff[i] < 0 || prog->nameOff[i] >= prog->poolSize)
+            return "bad symbol name";
+    for (i = 0; i < prog->stringNum; i++)
+        if (prog->stringOff[i] < 0 || prog->stringOff[i] >= prog->poolSize)
+            return "bad string constant";
+    for (i = 0; i < prog->codeNum; i++) {
+        ins = &prog->code[i];
+        if (ins->op < OP_MOVE || ins->op > OP_HALT)
+            return "bad opcode";
+        jumps = ins->op >= OP_JMP && ins->op <= OP_JGE;
+        if (jumps && (ins->c < 0 || ins->c >= prog->codeNum))
+            return "bad jump target";
+        if (ins->op == OP_JMP || ins->op == OP_HALT)
+            continue;
+        if (ins->op == OP_IN || ins->op == OP_OUT || ins->op == OP_OUTS) {
+            if ((ins->op == OP_IN ? ins->c : ins->a) < 0
+                || (ins->op == OP_IN ? ins->c : ins->a) >= prog->regNum)
+                return "bad operand";
+            continue;
+        }
+        if (ins->a < 0 || ins->a >= prog->regNum
+            || (ins->op != OP_MOVE && (ins->b < 0 || ins->b >= prog->regNum))
+            || (!jumps && (ins->c < 0 || ins->c >= prog->regNum)))
+            return "bad operand";
+    }
+    return NULL;
+}
+
+/*映射字节码文件，不做解析，只检查文件头和各个下标是否越界*/
+VMProgram *bcMap(const char *fileName) {
+    struct stat st;
+    BCHeader *h;
+    VMProgram *prog;
+    const char *reason = NULL;
+    char *base;
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "File %s not found\n", fileName);
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(BCHeader)) {
+        fprintf(stderr, "%s: not a bytecode file\n", fileName);
+        close(fd);
+        return NULL;
+    }
+    /*私有可写映射：第一次线程化运行时填写的处理代码地址只写到本进程的副本*/
+    base = (char *) mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "%s: cannot map file\n", fileName);
+        return NULL;
+    }
+    h = (BCHeader *) base;
+    if (memcmp(h->magic, BC_MAGIC, 4) != 0 || h->byteOrder != BC_BYTE_ORDER)
+        reason = "not a bytecode file";
+    else if (h->version != BC_VERSION)
+        reason = "unsupported bytecode version";
+    else if (h->size != (uint32_t) st.st_size)
+        reason = "truncated file";
+    prog = (VMProgram *) calloc(1, sizeof(VMProgram));
+    prog->mapping = base;
+    prog->mappingSize = st.st_size;
+    if (reason == NULL) {
+        prog->code = (VMInstr *) (base + h->codeOff);
+        prog->codeNum = h->codeNum;
+        prog->init = (int32_t *) (base + h->initOff);
+        prog->regNum = h->regNum;
+        prog->lines = (int32_t *) (base + h->lineOff);
+        prog->nameOff = (int32_t *) (base + h->nameOff);
+        prog->stringOff = (int32_t *) (base + h->stringOff);
+        prog->stringNum = h->stringNum;
+        prog->pool = base + h->poolOff;
+        prog->poolSize = h->poolSize;
+        prog->in = stdin;
+        prog->out = stdout;
+        reason = validate(h, prog);
+    }
+    if (reason != NULL) {
+        fprintf(stderr, "%s: %s\n", fileName, reason);
+        vmFree(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+/*输出一个操作数，没有时为_*/
+static void printOperand(VMProgram *prog, OutBuf *out, int slot) {
+    outPuts(out, slot < 0 ? "_" : vmSlotName(prog, slot));
+}
+
+/*输出指令的操作数，格式与printQuadruple相同*/
+static void printOperands(VMProgram *prog, VMInstr *ins, OutBuf *out) {
+    switch (ins->op) {
+        case OP_HALT:
+            outPuts(out, "0,0,0");
+            break;
+        case OP_JMP:
+        case OP_JEQ:
+        case OP_JLT:
+        case OP_JGT:
+        case OP_JLE:
+        case OP_JGE:
+            printOperand(prog, out, ins->a);
+            outChar(out, ',');
+            printOperand(prog, out, ins->b);
+            outChar(out, ',');
+            outInt(out, ins->c);
+            break;
+        case OP_OUT:
+        case OP_OUTS:
+            outPuts(out, "_,_,");
+            printOperand(prog, out, ins->a);
+            break;
+        default:
+            printOperand(prog, out, ins->a);
+            outChar(out, ',');
+            printOperand(prog, out, ins->b);
+            outChar(out, ',');
+            printOperand(prog, out, ins->c);
+            break;
+    }
+}
+
+/*输出第i条指令对应的四元式，不带下标*/
+void bcPrintInstr(VMProgram *prog, int i, OutBuf *out) {
+    outPuts(out, opNames[prog->code[i].op]);
+    outChar(out, ' ');
+    printOperands(prog, &prog->code[i], out);
+}
+
+/*把程序反汇编为四元式文本，格式与printQuadruple相同*/
+void bcDisassemble(VMProgram *prog, FILE *file, int lines) {
+    OutBuf *out = outOpen(file);
+    int i;
+    for (i = 0; i < prog->codeNum; i++) {
+        outIntPad(out, i, 3);
+        outPuts(out, ":  ");
+        outStrPad(out, opNames[prog->code[i].op], 5);
+        outSpaces(out, 2);
+        printOperands(prog, &prog->code[i], out);
+        if (lines && prog->lines[i] > 0) {
+            outPuts(out, "    * line ");
+            outInt(out, prog->lines[i]);
+        }
+        outChar(out, '\n');
+    }
+    outFlush(out);
+}
@@ -0,0 +1,48 @@
+//
+// Created by liang on 2020/7/11.
+//
+
+#ifndef TINY_BYTECODE_H
+#define TINY_BYTECODE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "vm.h"
+#include "outbuf.h"
+
+/*字节码文件（.tnb）：文件头之后依次是指令记录、常量池、行号表、符号表、字符串常量表和字符串池，
+ * 每一节都按8字节对齐，数据使用本机字节序。映射进来后各节直接作为VMProgram的各个表使用*/
+#define BC_MAGIC "TNYB"
+#define BC_VERSION 1
+#define BC_BYTE_ORDER 0x01020304
+
+typedef struct BCHeaderRec {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;/*写入BC_BYTE_ORDER，字节序不同的机器上读出来不相等*/
+    uint32_t size;/*整个文件的字节数*/
+    uint32_t codeNum;
+    uint32_t codeOff;/*codeNum条VMInstr*/
+    uint32_t regNum;
+    uint32_t initOff;/*常量池：regNum个int32，寄存器的初值*/
+    uint32_t lineOff;/*行号表：codeNum个int32*/
+    uint32_t nameOff;/*符号表：regNum个int32，寄存器名在字符串池中的偏移*/
+    uint32_t stringNum;
+    uint32_t stringOff;/*字符串常量表：stringNum个int32，在字符串池中的偏移*/
+    uint32_t poolSize;
+    uint32_t poolOff;
+} BCHeader;
+
+/*把程序写成字节码文件，成功返回TRUE*/
+int bcWrite(VMProgram *prog, FILE *file);
+
+/*映射字节码文件，不做解析，只检查文件头和各个下标是否越界；失败时返回NULL并在stderr上说明原因*/
+VMProgram *bcMap(const char *fileName);
+
+/*把程序反汇编为四元式文本，lines为TRUE时在每行末尾注明源程序行号*/
+void bcDisassemble(VMProgram *prog, FILE *file, int lines);
+
+/*输出第i条指令对应的四元式，不带下标*/
+void bcPrintInstr(VMProgram *prog, int i, OutBuf *out);
+
+#endif //TINY_BYTECODE_H
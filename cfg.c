@@ -0,0 +1,407 @@
+//
+// Created by liang on 2020/7/4.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "translate.h"
+#include "cfg.h"
+
+/*求第i条四元式的跳转目标，非跳转返回-1*/
+static int jumpTarget(int i) {
+    if (!isJump(quadruples[i].operator) || quadruples[i].result == NULL)
+        return -1;
+    return atoi(quadruples[i].result);
+}
+
+/*寻找入口语句并把四元式划分为基本块*/
+static void splitBlocks(CFG *cfg) {
+    int i, target, b;
+    int n = curIndex;
+    char *leader = (char *) calloc(n + 1, sizeof(char));
+    if (n > 0)
+        leader[0] = TRUE;
+    for (i = 0; i < n; i++) {
+        target = jumpTarget(i);
+        if (target >= 0 && target < n)
+            leader[target] = TRUE;
+        if (target >= 0 || strcmp(quadruples[i].operator, "HALT") == 0)
+            leader[i + 1] = TRUE;
+    }
+    cfg->blockNum = 0;
+    for (i = 0; i < n; i++)
+        cfg->blockNum += leader[i];
+    cfg->blocks = (BasicBlock *) calloc(cfg->blockNum + 1, sizeof(BasicBlock));
+    cfg->blockOf = (int *) malloc((n + 1) * sizeof(int));
+    for (i = 0, b = -1; i < n; i++) {
+        if (leader[i]) {
+            b++;
+            cfg->blocks[b].start = i;
+            cfg->blocks[b].idom = -1;
+        }
+        cfg->blocks[b].end = i + 1;
+        cfg->blockOf[i] = b;
+    }
+    free(leader);
+}
+
+/*根据每个基本块的最后一条四元式连接后继和前驱*/
+static void linkBlocks(CFG *cfg) {
+    int b, k, s, last, target, offset;
+    BasicBlock *block;
+    for (b = 0; b < cfg->blockNum; b++) {
+        block = &cfg->blocks[b];
+        last = block->end - 1;
+        target = jumpTarget(last);
+        block->succNum = 0;
+        if (target >= 0 && target < curIndex)
+            block->succ[block->succNum++] = cfg->blockOf[target];
+        if ((target < 0 || isCondJump(quadruples[last].operator)) &&
+            strcmp(quadruples[last].operator, "HALT") != 0 && block->end < curIndex) {
+            /*条件跳转的两个后继可能相同，只保留一条边*/
+            if (block->succNum == 0 || block->succ[0] != b + 1)
+                block->succ[block->succNum++] = b + 1;
+        }
+        for (k = 0; k < block->succNum; k++)
+            cfg->blocks[block->succ[k]].predNum++;
+    }
+    /*所有前驱存放在一个数组中*/
+    offset = 0;
+    for (b = 0; b < cfg->blockNum; b++)
+        offset += cfg->blocks[b].predNum;
+    cfg->predArray = (int *) malloc((offset + 1) * sizeof(int));
+    offset = 0;
+    for (b = 0; b < cfg->blockNum; b++) {
+        cfg->blocks[b].pred = cfg->predArray + offset;
+        offset += cfg->blocks[b].predNum;
+        cfg->blocks[b].predNum = 0;
+    }
+    for (b = 0; b < cfg->blockNum; b++)
+        for (k = 0; k < cfg->blocks[b].succNum; k++) {
+            s = cfg->blocks[b].succ[k];
+            cfg->blocks[s].pred[cfg->blocks[s].predNum++] = b;
+        }
+}
+
+/*非递归的深度优先遍历，得到可达基本块的逆后序*/
+static void computeRPO(CFG *cfg) {
+    int n = cfg->blockNum;
+    int *stack = (int *) malloc((n + 1) * sizeof(int));
+    int *next = (int *) calloc(n + 1, sizeof(int));/*下一个要访问的后继*/
+    char *visited = (char *) calloc(n + 1, sizeof(char));
+    int top = 0, post = n, b, s;
+    cfg->rpo = (int *) malloc((n + 1) * sizeof(int));
+    if (n > 0) {
+        stack[top++] = 0;
+        visited[0] = TRUE;
+    }
+    while (top > 0) {
+        b = stack[top - 1];
+        if (next[b] < cfg->blocks[b].succNum) {
+            s = cfg->blocks[b].succ[next[b]++];
+            if (!visited[s]) {
+                visited[s] = TRUE;
+                stack[top++] = s;
+            }
+        } else {
+            cfg->rpo[--post] = b;
+            top--;
+        }
+    }
+    /*去掉不可达块留下的空位*/
+    cfg->rpoNum = n - post;
+    memmove(cfg->rpo, cfg->rpo + post, cfg->rpoNum * sizeof(int));
+    free(visited);
+    free(next);
+    free(stack);
+}
+
+/*Cooper-Harvey-Kennedy迭代算法求直接支配者*/
+static void computeDominators(CFG *cfg) {
+    int n = cfg->blockNum;
+    int *order = (int *) malloc((n + 1) * sizeof(int));/*基本块在逆后序中的位置*/
+    int i, k, b, p, newIdom, a, c, changed;
+    BasicBlock *blocks = cfg->blocks;
+    if (cfg->rpoNum == 0) {
+        free(order);
+        return;
+    }
+    for (i = 0; i < cfg->rpoNum; i++)
+        order[cfg->rpo[i]] = i;
+    blocks[cfg->rpo[0]].idom = cfg->rpo[0];
+    do {
+        changed = FALSE;
+        for (i = 1; i < cfg->rpoNum; i++) {
+            b = cfg->rpo[i];
+            newIdom = -1;
+            for (k = 0; k < blocks[b].predNum; k++) {
+                p = blocks[b].pred[k];
+                if (blocks[p].idom == -1)
+                    continue;
+                if (newIdom == -1) {
+                    newIdom = p;
+                    continue;
+                }
+                /*沿支配树向上求两者的最近公共支配者*/
+                a = p;
+                c = newIdom;
+                while (a != c) {
+                    while (order[a] > order[c])
+                        a = blocks[a].idom;
+                    while (order[c] > order[a])
+                        c = blocks[c].idom;
+                }
+                newIdom = a;
+            }
+            if (blocks[b].idom != newIdom) {
+                blocks[b].idom = newIdom;
+                changed = TRUE;
+            }
+        }
+    } while (changed);
+    free(order);
+}
+
+/*为支配树编先序和后序号*/
+static void numberDomTree(CFG *cfg) {
+    int n = cfg->blockNum;
+    int *childStart = (int *) calloc(n + 2, sizeof(int));
+    int *children = (int *) malloc((n + 1) * sizeof(int));
+    int *stack = (int *) malloc((n + 1) * sizeof(int));
+    int *next = (int *) malloc((n + 1) * sizeof(int));
+    int b, d, top = 0, pre = 0, post = 0;
+    cfg->domPre = (int *) malloc((n + 1) * sizeof(int));
+    cfg->domPost = (int *) malloc((n + 1) * sizeof(int));
+    for (b = 0; b < n; b++) {
+        cfg->domPre[b] = -1;
+        cfg->domPost[b] = -1;
+        d = cfg->blocks[b].idom;
+        if (d >= 0 && d != b)
+            childStart[d + 1]++;
+    }
+    for (b = 0; b < n; b++)
+        childStart[b + 1] += childStart[b];
+    for (b = 0; b < n; b++)
+        next[b] = childStart[b];
+    for (b = 0; b < n; b++) {
+        d = cfg->blocks[b].idom;
+        if (d >= 0 && d != b)
+            children[next[d]++] = b;
+    }
+    for (b = 0; b < n; b++)
+        next[b] = childStart[b];
+    if (cfg->rpoNum > 0) {
+        stack[top++] = cfg->rpo[0];
+        cfg->domPre[cfg->rpo[0]] = pre++;
+    }
+    while (top > 0) {
+        b = stack[top - 1];
+        if (next[b] < childStart[b + 1]) {
+            d = children[next[b]++];
+            cfg->domPre[d] = pre++;
+            stack[top++] = d;
+        } else {
+            cfg->domPost[b] = post++;
+            top--;
+        }
+    }
+    free(next);
+    free(stack);
+    free(children);
+    free(childStart);
+}
+
+/*判断基本块a是否支配基本块b*/
+int dominates(CFG *cfg, int a, int b) {
+    if (cfg->domPre[a] < 0 || cfg->domPre[b] < 0)
+        return FALSE;
+    return cfg->domPre[a] <= cfg->domPre[b] && cfg->domPost[b] <= cfg->domPost[a];
+}
+
+/*按循环体大小降序比较，用于求循环嵌套*/
+static THREAD_LOCAL CFG *sortingCFG;
+
+static int compareLoopSize(const void *a, const void *b) {
+    return sortingCFG->loops[*(const int *) b].blockNum - sortingCFG->loops[*(const int *) a].blockNum;
+}
+
+/*循环体中加入基本块，容量为2的幂，满时倍增*/
+static void addLoopBlock(Loop *loop, int b) {
+    if (loop->blockNum == 0 || (loop->blockNum & (loop->blockNum - 1)) == 0)
+        loop->blocks = (int *) realloc(loop->blocks, 2 * (loop->blockNum + 1) * sizeof(int));
+    loop->blocks[loop->blockNum++] = b;
+}
+
+/*寻找回边并求自然循环，同一个header的回边合并为一个循环*/
+static void findLoops(CFG *cfg) {
+    int n = cfg->blockNum;
+    int *loopOf = (int *) malloc((n + 1) * sizeof(int));/*以该块为header的循环*/
+    int *mark = (int *) malloc((n + 1) * sizeof(int));/*已加入的循环*/
+    int *stack = (int *) malloc((n + 1) * sizeof(int));
+    int capacity = 4, b, k, h, l, p, x, top, i, j;
+    Loop *loop;
+    cfg->loops = (Loop *) malloc(capacity * sizeof(Loop));
+    cfg->loopNum = 0;
+    for (b = 0; b < n; b++) {
+        loopOf[b] = -1;
+        mark[b] = -1;
+    }
+    /*按逆后序收集回边，外层循环的header先被发现*/
+    for (i = 0; i < cfg->rpoNum; i++) {
+        b = cfg->rpo[i];
+        for (k = 0; k < cfg->blocks[b].succNum; k++) {
+            h = cfg->blocks[b].succ[k];
+            if (!dominates(cfg, h, b))
+                continue;
+            if (loopOf[h] == -1) {
+                if (cfg->loopNum == capacity) {
+                    capacity *= 2;
+                    cfg->loops = (Loop *) realloc(cfg->loops, capacity * sizeof(Loop));
+                }
+                loopOf[h] = cfg->loopNum;
+                loop = &cfg->loops[cfg->loopNum++];
+                loop->header = h;
+                loop->blocks = NULL;
+                loop->blockNum = 0;
+                loop->latches = NULL;
+                loop->latchNum = 0;
+                loop->parent = -1;
+            }
+            loop = &cfg->loops[loopOf[h]];
+            loop->latches = (int *) realloc(loop->latches, (loop->latchNum + 1) * sizeof(int));
+            loop->latches[loop->latchNum++] = b;
+        }
+    }
+    /*从回边的起点逆向寻找不经过header能到达的块*/
+    for (l = 0; l < cfg->loopNum; l++) {
+        loop = &cfg->loops[l];
+        mark[loop->header] = l;
+        addLoopBlock(loop, loop->header);
+        top = 0;
+        for (k = 0; k < loop->latchNum; k++)
+            if (mark[loop->latches[k]] != l) {
+                mark[loop->latches[k]] = l;
+                stack[top++] = loop->latches[k];
+            }
+        while (top > 0) {
+            x = stack[--top];
+            addLoopBlock(loop, x);
+            for (j = 0; j < cfg->blocks[x].predNum; j++) {
+                p = cfg->blocks[x].pred[j];
+                if (mark[p] != l && cfg->blocks[p].idom != -1) {
+                    mark[p] = l;
+                    stack[top++] = p;
+                }
+            }
+        }
+    }
+    /*循环嵌套：按循环体从大到小处理，header所在的已处理的最小循环即为外层循环*/
+    for (l = 0; l < cfg->loopNum; l++)
+        for (j = 0; j < cfg->loops[l].blockNum; j++)
+            cfg->blocks[cfg->loops[l].blocks[j]].loopDepth++;
+    for (b = 0; b < n; b++)
+        loopOf[b] = -1;
+    for (l = 0; l < cfg->loopNum; l++)
+        stack[l] = l;
+    sortingCFG = cfg;
+    qsort(stack, cfg->loopNum, sizeof(int), compareLoopSize);
+    for (i = 0; i < cfg->loopNum; i++) {
+        loop = &cfg->loops[stack[i]];
+        loop->parent = loopOf[loop->header];
+        for (j = 0; j < loop->blockNum; j++)
+            loopOf[loop->blocks[j]] = stack[i];
+    }
+    free(stack);
+    free(mark);
+    free(loopOf);
+}
+
+/*根据当前的四元式构造控制流图*/
+CFG *buildCFG(void) {
+    CFG *cfg = (CFG *) calloc(1, sizeof(CFG));
+    splitBlocks(cfg);
+    linkBlocks(cfg);
+    computeRPO(cfg);
+    computeDominators(cfg);
+    numberDomTree(cfg);
+    findLoops(cfg);
+    return cfg;
+}
+
+/*释放控制流图*/
+void freeCFG(CFG *cfg) {
+    int l;
+    if (cfg == NULL)
+        return;
+    for (l = 0; l < cfg->loopNum; l++) {
+        free(cfg->loops[l].blocks);
+        free(cfg->loops[l].latches);
+    }
+    free(cfg->loops);
+    free(cfg->domPost);
+    free(cfg->domPre);
+    free(cfg->rpo);
+    free(cfg->predArray);
+    free(cfg->blockOf);
+    free(cfg->blocks);
+    free(cfg);
+}
+
+/*在DOT的标签中输出操作数：引号、反斜杠和记录标签中的特殊字符前加反斜杠，NULL输出为_*/
+static void dotOperand(FILE *file, const char *s) {
+    if (s == NULL) {
+        fputc('_', file);
+        return;
+    }
+    for (; *s != '\0'; s++) {
+        if (strchr("\"\\{}|<>", *s) != NULL)
+            fputc('\\', file);
+        fputc(*s, file);
+    }
+}
+
+/*以DOT格式输出控制流图*/
+void printCFGDot(CFG *cfg, FILE *file) {
+    int b, i, k;
+    Quadruple *q;
+    fprintf(file, "digraph CFG {\n");
+    fprintf(file, "    node [shape=box, fontname=\"monospace\"];\n");
+    for (b = 0; b < cfg->blockNum; b++) {
+        fprintf(file, "    B%d [label=\"B%d", b, b);
+        if (cfg->blocks[b].loopDepth > 0)
+            fprintf(file, " (loop depth %d)", cfg->blocks[b].loopDepth);
+        fprintf(file, "\\l");
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+            q = &quadruples[i];
+            fprintf(file, "%d: ", i);
+            dotOperand(file, q->operator);
+            fputc(' ', file);
+            dotOperand(file, q->arg1);
+            fputc(',', file);
+            dotOperand(file, q->arg2);
+            fputc(',', file);
+            dotOperand(file, q->result);
+            fprintf(file, "\\l");
+        }
+        fprintf(file, "\"");
+        if (cfg->blocks[b].idom == -1)
+            fprintf(file, ", style=dashed");
+        else if (cfg->blocks[b].loopDepth > 0)
+            fprintf(file, ", style=filled, fillcolor=\"lightyellow\"");
+        fprintf(file, "];\n");
+    }
+    for (b = 0; b < cfg->blockNum; b++)
+        for (k = 0; k < cfg->blocks[b].succNum; k++) {
+            fprintf(file, "    B%d -> B%d", b, cfg->blocks[b].succ[k]);
+            if (dominates(cfg, cfg->blocks[b].succ[k], b))
+                fprintf(file, " [color=red]");/*回边*/
+            fprintf(file, ";\n");
+        }
+    /*支配树用虚线表示*/
+    for (b = 0; b < cfg->blockNum; b++)
+        if (cfg->blocks[b].idom >= 0 && cfg->blocks[b].idom != b)
+            fprintf(file, "    B%d -> B%d [style=dotted, arrowhead=none, constraint=false];\n",
+                    cfg->blocks[b].idom, b);
+    fprintf(file, "}\n");
+}
@@ -0,0 +1,59 @@
+//
+// Created by liang on 2020/7/4.
+//
+
+#ifndef TINY_CFG_H
+#define TINY_CFG_H
+
+#include <stdio.h>
+
+/*基本块，包含逻辑地址为[start, end)的四元式*/
+typedef struct BasicBlockRec {
+    int start;
+    int end;
+    int succ[2];/*后继，条件跳转的第0个为跳转目标，第1个为顺序执行的下一块*/
+    int succNum;
+    int *pred;/*前驱，指向CFG中的predArray*/
+    int predNum;
+    int idom;/*直接支配者，入口块为自身，不可达块为-1*/
+    int loopDepth;/*所在自然循环的嵌套深度*/
+} BasicBlock;
+
+/*自然循环，由回边latch->header确定，同一header的回边合并为一个循环*/
+typedef struct LoopRec {
+    int header;
+    int *blocks;/*循环包含的基本块（含header）*/
+    int blockNum;
+    int *latches;/*回边的起点*/
+    int latchNum;
+    int parent;/*直接外层循环，没有时为-1*/
+} Loop;
+
+/*控制流图*/
+typedef struct CFGRec {
+    BasicBlock *blocks;
+    int blockNum;
+    int *blockOf;/*四元式所在的基本块*/
+    int *predArray;
+    int *rpo;/*可达基本块的逆后序*/
+    int rpoNum;
+    int *domPre;/*支配树的先序和后序编号，用于O(1)判断支配关系*/
+    int *domPost;
+    Loop *loops;
+    int loopNum;
+} CFG;
+
+/*根据当前的四元式构造控制流图，并计算支配关系和自然循环，
+ * 时间与四元式个数加循环体大小之和成线性（支配者迭代在可归约图上只需常数轮）*/
+CFG *buildCFG(void);
+
+/*释放控制流图*/
+void freeCFG(CFG *cfg);
+
+/*判断基本块a是否支配基本块b*/
+int dominates(CFG *cfg, int a, int b);
+
+/*以DOT格式输出控制流图，支配树和循环以注释和颜色标出*/
+void printCFGDot(CFG *cfg, FILE *file);
+
+#endif //TINY_CFG_H
@@ -0,0 +1,127 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "globals.h"
+#include "client.h"
+
+/*守护进程的套接字*/
+const char *clientSocketPath(void) {
+    const char *path = getenv("TINY_SOCKET");
+    return path != NULL && path[0] != '\0' ? path : DAEMON_SOCKET;
+}
+
+/*编译器的路径，argv0中没有目录时只返回tiny，由execvp在PATH中查找*/
+char *clientTinyPath(const char *argv0) {
+    const char *tiny = getenv("TINY"), *slash = strrchr(argv0, '/');
+    size_t dirLen = slash != NULL ? (size_t) (slash - argv0 + 1) : 0;
+    char *path;
+    if (tiny != NULL && tiny[0] != '\0')
+        return strdup(tiny);
+    path = (char *) malloc(dirLen + 5);
+    memcpy(path, argv0, dirLen);
+    strcpy(path + dirLen, "tiny");
+    return path;
+}
+
+/*读满n个字节，连接提前关闭时返回FALSE*/
+static int readAll(int fd, char *p, size_t n) {
+    ssize_t k;
+    while (n > 0) {
+        k = read(fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return FALSE;
+        p += k;
+        n -= k;
+    }
+    return TRUE;
+}
+
+/*用writev写出所有内容，失败时返回FALSE*/
+static int writeAll(int fd, struct iovec *iov, int num) {
+    ssize_t n;
+    while (num > 0) {
+        n = writev(fd, iov, num);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return FALSE;
+        while (num > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            num--;
+        }
+        if (num > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return TRUE;
+}
+
+/*请守护进程编译一个源程序*/
+int clientCompile(const char *path, const char *name, const char *text, size_t textLen,
+                  unsigned flags, ClientResult *result) {
+    struct sockaddr_un addr;
+    DaemonRequest request;
+    struct iovec iov[3];
+    size_t total = 0;
+    int fd, i, ok;
+    memset(result, 0, sizeof(ClientResult));
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return FALSE;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return FALSE;
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return FALSE;
+    }
+    memcpy(request.magic, DAEMON_REQUEST_MAGIC, 4);
+    request.flags = flags;
+    request.nameLen = (uint32_t) strlen(name);
+    request.sourceLen = (uint32_t) textLen;
+    iov[0].iov_base = &request;
+    iov[0].iov_len = sizeof(request);
+    iov[1].iov_base = (char *) name;
+    iov[1].iov_len = request.nameLen;
+    iov[2].iov_base = (char *) text;
+    iov[2].iov_len = textLen;
+    ok = writeAll(fd, iov, 3)
+         && readAll(fd, (char *) &result->header, sizeof(DaemonResponse))
+         && memcmp(result->header.magic, DAEMON_RESPONSE_MAGIC, 4) == 0
+         && result->header.status != DAEMON_BAD_REQUEST;
+    if (ok) {
+        for (i = 0; i < DAEMON_PARTS; i++)
+            total += result->header.size[i];
+        result->body = (char *) malloc(total + 1);
+        ok = readAll(fd, result->body, total);
+        total = 0;
+        for (i = 0; i < DAEMON_PARTS; i++) {
+            result->part[i] = result->body + total;
+            total += result->header.size[i];
+        }
+    }
+    close(fd);
+    if (!ok)
+        clientFree(result);
+    return ok;
+}
+
+/*释放回答*/
+void clientFree(ClientResult *result) {
+    free(result->body);
+    memset(result, 0, sizeof(ClientResult));
+}
@@ -0,0 +1,32 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_CLIENT_H
+#define TINY_CLIENT_H
+
+#include <stddef.h>
+#include "daemon.h"
+
+/*守护进程的一个回答，各部分连续存放在body中*/
+typedef struct ClientResultRec {
+    DaemonResponse header;
+    char *body;
+    char *part[DAEMON_PARTS];
+} ClientResult;
+
+/*守护进程的套接字：环境变量TINY_SOCKET，未设置时为DAEMON_SOCKET*/
+const char *clientSocketPath(void);
+
+/*编译器的路径：环境变量TINY，未设置时为与argv0同一目录下的tiny。返回malloc分配的字符串*/
+char *clientTinyPath(const char *argv0);
+
+/*请守护进程编译文件名为name、内容为text的源程序，flags为DAEMON_EMIT_C等选项。
+ * 连不上守护进程或者回答不完整时返回FALSE*/
+int clientCompile(const char *path, const char *name, const char *text, size_t textLen,
+                  unsigned flags, ClientResult *result);
+
+/*释放回答*/
+void clientFree(ClientResult *result);
+
+#endif //TINY_CLIENT_H
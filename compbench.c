@@ -0,0 +1,132 @@
+//
+// Created by liang on 2020/7/16.
+//
+/*编译器吞吐量测试：compbench [-r repeats] [-p] <filename>...
+ * 在进程内用tinyCompile编译每个文件，先预热一次，再重复repeats次（默认7），
+ * 每个阶段取各次时间的中位数，输出每个阶段的MB/s和语句数/s，spread为最大和最小时间相对中位数的差。
+ * -p：同时统计硬件计数，每个计数也取中位数*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "stats.h"
+#include "tiny.h"
+
+#define MAX_REPEATS 101
+
+static const char *phaseNames[PHASE_NUM] = {
+        "scan", "parse", "analyze", "codegen", "optimize", "output"
+};
+
+/*读入整个文件*/
+static char *readFile(const char *name, size_t *len) {
+    FILE *file = fopen(name, "rb");
+    char *text;
+    long size;
+    if (file == NULL)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+    text = (char *) malloc(size + 1);
+    *len = fread(text, 1, size, file);
+    fclose(file);
+    return text;
+}
+
+static double counters[PHASE_NUM][PERF_NUM][MAX_REPEATS];
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return x < y ? -1 : x > y;
+}
+
+static double median(double *times, int n) {
+    qsort(times, n, sizeof(double), compareDouble);
+    return n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+}
+
+/*一行结果，times已由median排好序*/
+static void printPhase(const char *name, double *times, int n, size_t bytes, long statements) {
+    double t = median(times, n);
+    printf("  %-10s %10.3f ms %10.2f MB/s %14.0f stmts/s  spread %5.1f%%\n", name, t * 1e3,
+           t > 0 ? bytes / t / 1e6 : 0.0, t > 0 ? statements / t : 0.0,
+           t > 0 ? (times[n - 1] - times[0]) * 100 / t : 0.0);
+}
+
+/*编译一次，返回是否成功*/
+static int compileOnce(const char *name, const char *text, size_t len) {
+    TinyOptions options = tinyDefaultOptions();
+    TinyResult *result;
+    int ok;
+    options.name = name;
+    result = tinyCompile(text, len, &options);
+    ok = result->ok;
+    tinyFree(result);
+    return ok;
+}
+
+static int benchFile(const char *name, int repeats) {
+    static double times[PHASE_NUM + 1][MAX_REPEATS];
+    long statements = 0;
+    size_t len;
+    char *text = readFile(name, &len);
+    int i, k, c;
+    if (text == NULL) {
+        fprintf(stderr, "File %s not found\n", name);
+        return FALSE;
+    }
+    if (!compileOnce(name, text, len)) {
+        fprintf(stderr, "%s: compilation failed\n", name);
+        free(text);
+        return FALSE;
+    }
+    for (i = 0; i <= TypeK; i++)
+        statements += stats.stmtNodes[i];
+    for (k = 0; k < repeats; k++) {
+        compileOnce(name, text, len);
+        times[PHASE_NUM][k] = 0;
+        for (i = 0; i < PHASE_NUM; i++) {
+            times[i][k] = stats.wall[i];
+            times[PHASE_NUM][k] += stats.wall[i];
+            for (c = 0; c < PERF_NUM; c++)
+                counters[i][c][k] = (double) stats.counters[i][c];
+        }
+    }
+    printf("%s: %lu bytes, %ld statements, %ld tokens, median of %d\n", name, (unsigned long) len, statements,
+           stats.tokens, repeats);
+    for (i = 0; i < PHASE_NUM; i++)
+        printPhase(phaseNames[i], times[i], repeats, len, statements);
+    printPhase("TOTAL", times[PHASE_NUM], repeats, len, statements);
+    if (CollectCounters) {
+        /*其他计数保留最后一次编译的值*/
+        for (i = 0; i < PHASE_NUM; i++)
+            for (c = 0; c < PERF_NUM; c++)
+                stats.counters[i][c] = (long long) median(counters[i][c], repeats);
+        statsPrintCounters(stdout);
+        printf("\n");
+    }
+    free(text);
+    return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+    int repeats = 7, i = 1, failed = 0;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            repeats = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0)
+            CollectCounters = TRUE;
+        else
+            break;
+    }
+    if (i == argc || argv[i][0] == '-' || repeats < 1 || repeats > MAX_REPEATS) {
+        fprintf(stderr, "usage: %s [-r repeats] [-p] <filename>...\n", argv[0]);
+        exit(1);
+    }
+    CollectStats = TRUE;
+    for (; i < argc; i++)
+        if (!benchFile(argv[i], repeats))
+            failed++;
+    return failed > 0;
+}
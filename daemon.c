@@ -0,0 +1,273 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "globals.h"
+#include "util.h"
+#include "translate.h"
+#include "outbuf.h"
+#include "batch.h"
+#include "daemon.h"
+
+/*请求中文件名和源程序的长度上限*/
+#define MAX_NAME_LEN 4096
+#define MAX_SOURCE_LEN (64 << 20)
+
+/*连接上读写的超时秒数，超时的客户端被断开，不阻塞后面的请求*/
+#define CLIENT_TIMEOUT 10
+
+/*结果缓存：按请求的散列值直接映射，总大小超过CACHE_LIMIT时不再加入新的结果*/
+#define CACHE_SLOTS 256
+#define CACHE_LIMIT (64 << 20)
+
+typedef struct CacheEntryRec {
+    unsigned hash;
+    uint32_t flags;
+    char *name;
+    char *text;
+    size_t textLen;
+    char *response;/*DaemonResponse和各部分，可以直接发送*/
+    size_t responseLen;
+} CacheEntry;
+
+static CacheEntry cache[CACHE_SLOTS];
+static size_t cacheBytes = 0;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void onSignal(int sig) {
+    (void) sig;
+    stopping = 1;
+}
+
+/*读满n个字节，连接提前关闭或超时时返回FALSE*/
+static int readAll(int fd, char *p, size_t n) {
+    ssize_t k;
+    while (n > 0) {
+        k = read(fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return FALSE;
+        p += k;
+        n -= k;
+    }
+    return TRUE;
+}
+
+/*写出n个字节，对方已经关闭连接或超时时放弃*/
+static void writeAll(int fd, const char *p, size_t n) {
+    ssize_t k;
+    while (n > 0) {
+        k = write(fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return;
+        p += k;
+        n -= k;
+    }
+}
+
+static unsigned requestHash(uint32_t flags, const char *name, const char *text, size_t textLen) {
+    unsigned h = 2166136261u ^ flags;
+    size_t i;
+    for (i = 0; name[i] != '\0'; i++)
+        h = (h ^ (unsigned char) name[i]) * 16777619u;
+    for (i = 0; i < textLen; i++)
+        h = (h ^ (unsigned char) text[i]) * 16777619u;
+    return h;
+}
+
+/*在缓存中查找相同的请求*/
+static CacheEntry *cacheFind(unsigned hash, uint32_t flags, const char *name, const char *text, size_t textLen) {
+    CacheEntry *e = &cache[hash % CACHE_SLOTS];
+    if (e->response != NULL && e->hash == hash && e->flags == flags && e->textLen == textLen
+        && strcmp(e->name, name) == 0 && memcmp(e->text, text, textLen) == 0)
+        return e;
+    return NULL;
+}
+
+/*把回答放进缓存，替换同一位置上原来的结果*/
+static void cacheStore(unsigned hash, uint32_t flags, const char *name, char *text, size_t textLen,
+                       char *response, size_t responseLen) {
+    CacheEntry *e = &cache[hash % CACHE_SLOTS];
+    if (e->response != NULL) {
+        cacheBytes -= e->textLen + e->responseLen;
+        free(e->name);
+        free(e->text);
+        free(e->response);
+        e->response = NULL;
+    }
+    if (cacheBytes + textLen + responseLen > CACHE_LIMIT) {
+        free(text);
+        free(response);
+        return;
+    }
+    e->hash = hash;
+    e->flags = flags;
+    e->name = copyString((char *) name);
+    e->text = text;
+    e->textLen = textLen;
+    e->response = response;
+    e->responseLen = responseLen;
+    cacheBytes += textLen + responseLen;
+}
+
+/*编译一个请求，返回DaemonResponse和各部分组成的回答*/
+static char *compileRequest(const char *name, char *text, size_t textLen, uint32_t flags, size_t *responseLen) {
+    char *part[DAEMON_PARTS] = {NULL, NULL, NULL, NULL}, *response, *p, *codeFile;
+    size_t size[DAEMON_PARTS] = {0, 0, 0, 0};
+    FILE *file[DAEMON_PARTS] = {NULL, NULL, NULL, NULL};
+    DaemonResponse header;
+    TreeNode *syntaxTree;
+    OutBuf *out;
+    int i;
+    source = textLen > 0 ? fmemopen(text, textLen, "r") : fopen("/dev/null", "r");
+    listing = file[DAEMON_LISTING] = open_memstream(&part[DAEMON_LISTING], &size[DAEMON_LISTING]);
+    out = outOpen(listing);
+    outPuts(out, "\nTINY COMPILATION: ");
+    outPuts(out, name);
+    outChar(out, '\n');
+    syntaxTree = parseSource();
+    if (syntaxTree != NULL) {
+        code = file[DAEMON_CODE] = open_memstream(&part[DAEMON_CODE], &size[DAEMON_CODE]);
+        binary = file[DAEMON_BINARY] = open_memstream(&part[DAEMON_BINARY], &size[DAEMON_BINARY]);
+        ccode = NULL;
+        if (flags & DAEMON_EMIT_C)
+            ccode = file[DAEMON_CCODE] = open_memstream(&part[DAEMON_CCODE], &size[DAEMON_CCODE]);
+        codeFile = outputName(name, ".tm");
+        codeGen(syntaxTree, codeFile);
+        free(codeFile);
+        freeTree(syntaxTree);
+        outClose(code);
+    }
+    outClose(listing);
+    for (i = 0; i < DAEMON_PARTS; i++)
+        if (file[i] != NULL)
+            fclose(file[i]);
+    fclose(source);
+
+    memcpy(header.magic, DAEMON_RESPONSE_MAGIC, 4);
+    header.status = syntaxTree != NULL && !Error ? DAEMON_OK : DAEMON_FAILED;
+    header.cached = FALSE;
+    *responseLen = sizeof(header);
+    for (i = 0; i < DAEMON_PARTS; i++) {
+        header.size[i] = (uint32_t) size[i];
+        *responseLen += size[i];
+    }
+    response = (char *) malloc(*responseLen);
+    memcpy(response, &header, sizeof(header));
+    p = response + sizeof(header);
+    for (i = 0; i < DAEMON_PARTS; i++) {
+        if (size[i] > 0)
+            memcpy(p, part[i], size[i]);
+        p += size[i];
+        free(part[i]);
+    }
+    return response;
+}
+
+/*处理一个连接上的请求*/
+static void serveRequest(int fd) {
+    DaemonRequest request;
+    DaemonResponse header;
+    CacheEntry *e;
+    char *name, *text, *response;
+    size_t responseLen;
+    unsigned hash;
+    if (!readAll(fd, (char *) &request, sizeof(request)))
+        return;
+    if (memcmp(request.magic, DAEMON_REQUEST_MAGIC, 4) != 0
+        || request.nameLen > MAX_NAME_LEN || request.sourceLen > MAX_SOURCE_LEN) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, DAEMON_RESPONSE_MAGIC, 4);
+        header.status = DAEMON_BAD_REQUEST;
+        writeAll(fd, (char *) &header, sizeof(header));
+        return;
+    }
+    name = (char *) malloc(request.nameLen + 1);
+    text = (char *) malloc(request.sourceLen + 1);
+    if (!readAll(fd, name, request.nameLen) || !readAll(fd, text, request.sourceLen)) {
+        free(name);
+        free(text);
+        return;
+    }
+    name[request.nameLen] = '\0';
+    hash = requestHash(request.flags & DAEMON_EMIT_C, name, text, request.sourceLen);
+    e = request.flags & DAEMON_NO_CACHE ? NULL
+        : cacheFind(hash, request.flags & DAEMON_EMIT_C, name, text, request.sourceLen);
+    if (e != NULL) {
+        writeAll(fd, e->response, e->responseLen);
+        free(name);
+        free(text);
+        return;
+    }
+    response = compileRequest(name, text, request.sourceLen, request.flags, &responseLen);
+    writeAll(fd, response, responseLen);
+    /*缓存中的回答都标记为来自缓存*/
+    ((DaemonResponse *) response)->cached = TRUE;
+    cacheStore(hash, request.flags & DAEMON_EMIT_C, name, text, request.sourceLen, response, responseLen);
+    free(name);
+}
+
+/*在套接字path上依次处理请求*/
+int serveDaemon(const char *path) {
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    struct stat st;
+    struct timeval timeout;
+    int fd, client;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s too long\n", path);
+        return FALSE;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    /*只删除上次留下的套接字，不覆盖其他文件*/
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "%s exists and is not a socket\n", path);
+            return FALSE;
+        }
+        if (unlink(path) < 0) {
+            fprintf(stderr, "Unable to remove %s: %s\n", path, strerror(errno));
+            return FALSE;
+        }
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+        fprintf(stderr, "Unable to listen on %s: %s\n", path, strerror(errno));
+        return FALSE;
+    }
+    /*不设置SA_RESTART，收到信号时accept返回EINTR*/
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    while (!stopping) {
+        client = accept(fd, NULL, NULL);
+        if (client < 0)
+            continue;
+        timeout.tv_sec = CLIENT_TIMEOUT;
+        timeout.tv_usec = 0;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serveRequest(client);
+        close(client);
+    }
+    close(fd);
+    unlink(path);
+    return TRUE;
+}
@@ -0,0 +1,54 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_DAEMON_H
+#define TINY_DAEMON_H
+
+#include <stdint.h>
+
+/*守护进程在Unix套接字上接受编译请求。每个连接发送一个请求：DaemonRequest之后是
+ * nameLen字节的文件名和sourceLen字节的源程序；守护进程回答DaemonResponse，之后依次是
+ * 清单、.tm、.tnb和.c四部分，长度在size中，然后关闭连接*/
+#define DAEMON_REQUEST_MAGIC "TNYQ"
+#define DAEMON_RESPONSE_MAGIC "TNYR"
+
+/*未设置TINY_SOCKET环境变量时使用的套接字*/
+#define DAEMON_SOCKET "/tmp/tiny.sock"
+
+/*请求的选项*/
+#define DAEMON_EMIT_C 1/*同时翻译为C，同tiny -c*/
+#define DAEMON_NO_CACHE 2/*不使用结果缓存，用于测量编译的延迟*/
+
+/*回答的各部分*/
+#define DAEMON_LISTING 0
+#define DAEMON_CODE 1
+#define DAEMON_BINARY 2
+#define DAEMON_CCODE 3
+#define DAEMON_PARTS 4
+
+/*回答的状态*/
+#define DAEMON_OK 0
+#define DAEMON_FAILED 1/*编译错误，只有清单*/
+#define DAEMON_BAD_REQUEST 2
+
+/*请求和回答的长度都按本机字节序传送，双方在同一台机器上*/
+typedef struct DaemonRequestRec {
+    char magic[4];
+    uint32_t flags;
+    uint32_t nameLen;
+    uint32_t sourceLen;
+} DaemonRequest;
+
+typedef struct DaemonResponseRec {
+    char magic[4];
+    uint32_t status;
+    uint32_t cached;/*结果来自缓存*/
+    uint32_t size[DAEMON_PARTS];
+} DaemonResponse;
+
+/*在套接字path上依次处理请求，收到SIGINT或SIGTERM时删除套接字并返回。
+ * 编译器的分配器、驻留字符串和结果缓存在请求之间保留。path已被其他文件占用或不能监听时返回FALSE*/
+int serveDaemon(const char *path);
+
+#endif //TINY_DAEMON_H
@@ -0,0 +1,123 @@
+//
+// Created by liang on 2020/7/16.
+//
+/*编译延迟测试：daemonbench <filename> [runs]
+ * 分别测量每次fork/exec一个tiny、向守护进程发送请求（不用缓存）和命中结果缓存时编译一个文件的平均时间。
+ * 守护进程由测试程序自己在临时套接字上启动，结束时停止*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "globals.h"
+#include "client.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*启动tiny并等待它结束，标准输出丢弃*/
+static void runTiny(char *argv[]) {
+    int status, fd;
+    pid_t pid = fork();
+    if (pid == 0) {
+        fd = open("/dev/null", O_WRONLY);
+        dup2(fd, 1);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    waitpid(pid, &status, 0);
+}
+
+/*读入整个文件*/
+static char *readFile(const char *name, size_t *len) {
+    FILE *file = fopen(name, "rb");
+    char *text;
+    long size;
+    if (file == NULL)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+    text = (char *) malloc(size + 1);
+    *len = fread(text, 1, size, file);
+    fclose(file);
+    return text;
+}
+
+/*平均每次请求的时间*/
+static double timeRequests(const char *path, const char *name, const char *text, size_t len,
+                           unsigned flags, int runs) {
+    ClientResult result;
+    double start = now();
+    int i;
+    for (i = 0; i < runs; i++) {
+        if (!clientCompile(path, name, text, len, flags, &result)) {
+            fprintf(stderr, "daemon request failed\n");
+            exit(1);
+        }
+        clientFree(&result);
+    }
+    return (now() - start) / runs;
+}
+
+int main(int argc, char *argv[]) {
+    char path[64], *text, *tiny, *args[4];
+    double forked, daemon, cached, start;
+    ClientResult result;
+    size_t len;
+    pid_t pid;
+    int runs, i;
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <filename> [runs]\n", argv[0]);
+        exit(1);
+    }
+    runs = argc > 2 ? atoi(argv[2]) : 100;
+    if (runs < 1)
+        runs = 1;
+    text = readFile(argv[1], &len);
+    if (text == NULL) {
+        fprintf(stderr, "File %s not found\n", argv[1]);
+        exit(1);
+    }
+    tiny = clientTinyPath(argv[0]);
+    sprintf(path, "/tmp/tiny-bench-%d.sock", (int) getpid());
+    pid = fork();
+    if (pid == 0) {
+        execlp(tiny, tiny, "-d", path, (char *) NULL);
+        _exit(127);
+    }
+    /*等待守护进程开始监听*/
+    for (i = 0; i < 1000 && !clientCompile(path, argv[1], text, len, DAEMON_NO_CACHE, &result); i++)
+        usleep(1000);
+    if (i == 1000) {
+        fprintf(stderr, "Unable to start %s -d %s\n", tiny, path);
+        kill(pid, SIGTERM);
+        exit(1);
+    }
+    clientFree(&result);
+
+    args[0] = tiny;
+    args[1] = argv[1];
+    args[2] = NULL;
+    runTiny(args);
+    start = now();
+    for (i = 0; i < runs; i++)
+        runTiny(args);
+    forked = (now() - start) / runs;
+    daemon = timeRequests(path, argv[1], text, len, DAEMON_NO_CACHE, runs);
+    cached = timeRequests(path, argv[1], text, len, 0, runs);
+    printf("%-24s fork/exec %9.3f ms  daemon %9.3f ms  speedup %6.2fx  cached %9.3f ms  speedup %6.2fx\n",
+           argv[1], forked * 1e3, daemon * 1e3, daemon > 0 ? forked / daemon : 0.0,
+           cached * 1e3, cached > 0 ? forked / cached : 0.0);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    free(text);
+    free(tiny);
+    return 0;
+}
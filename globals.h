@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include "heap.h"
 
 #ifndef FALSE
 #define FALSE 0
@@ -25,6 +26,12 @@
 /* MAXRESERVED = the number of reserved words */
 #define MAXRESERVED 18
 
+/* THREAD_LOCAL marks the state of one compilation;
+ * each worker thread of a batch compilation has its own copy
+ * 批量编译时每个工作线程各有一份编译状态
+ */
+#define THREAD_LOCAL __thread
+
 typedef enum
 /* book-keeping tokens */
 {
@@ -38,11 +45,13 @@ typedef enum
     ASSIGN, EQ, LT, GT, LTE, GTE, PLUS, MINUS, TIMES, OVER, LPAREN, RPAREN, SEMI, COMMA, SQM
 } TokenType;
 
-extern FILE *source; /* source code text file */
-extern FILE *listing; /* listing output text file */
-extern FILE *code; /* code text file for TM simulator */
+extern THREAD_LOCAL FILE *source; /* source code text file */
+extern THREAD_LOCAL FILE *listing; /* listing output text file */
+extern THREAD_LOCAL FILE *code; /* code text file for TM simulator */
+extern THREAD_LOCAL FILE *binary; /* bytecode file, NULL when not written */
+extern THREAD_LOCAL FILE *ccode; /* C translation unit, NULL when not written */
 
-extern int lineno; /* source line number for listing */
+extern THREAD_LOCAL int lineno; /* source line number for listing */
 
 /**************************************************/
 /***********   Syntax tree for parsing ************/
@@ -92,39 +101,53 @@ typedef struct treeNode {
 /***********   Flags for tracing       ************/
 /**************************************************/
 
-/* EchoSource = TRUE causes the source program to
- * be echoed to the listing file with line numbers
- * during parsing
- */
 /***  Error **/
 #define MAX_ERROR 6
-extern int errorCode;
+extern THREAD_LOCAL int errorCode;
 extern char *errorMsg[MAX_ERROR];
 
-extern int EchoSource;
-
-/* TraceScan = TRUE causes token information to be
- * printed to the listing file as each token is
- * recognized by the scanner
+/* Tracing is selected per subsystem: traceLevel[s] = 0
+ * turns subsystem s off, 1 writes its trace to the
+ * listing file, 2 also records binary events in the
+ * trace ring (see trace.h)
+ *   TRACE_SOURCE   echo the source lines with line numbers
+ *   TRACE_SCAN     print each token as it is recognized
+ *   TRACE_PARSE    print the syntax tree
+ *   TRACE_ANALYZE  print the symbol table
+ *   TRACE_CODE     comments in the TM code, the quadruples
+ *   TRACE_CFG      the control flow graph in DOT format
+ *   TRACE_OPT      the SSA form and peephole statistics
+ * Compiling with -DNO_TRACE removes all the checks.
+ * The levels, Optimize and CollectStats belong to the
+ * thread, so each compilation can use its own options
  */
-extern int TraceScan;
+typedef enum {
+    TRACE_SOURCE, TRACE_SCAN, TRACE_PARSE, TRACE_ANALYZE, TRACE_CODE, TRACE_CFG, TRACE_OPT, TRACE_NUM
+} TraceSubsystem;
+
+extern THREAD_LOCAL int traceLevel[TRACE_NUM];
+
+#ifdef NO_TRACE
+#define TRACING(subsystem, level) 0
+#else
+#define TRACING(subsystem, level) (traceLevel[subsystem] >= (level))
+#endif
 
-/* TraceParse = TRUE causes the syntax tree to be
- * printed to the listing file in linearized form
- * (using indents for children)
+/* Optimize = TRUE causes the quadruples to be
+ * optimized before they are written to the code file
  */
-extern int TraceParse;
+extern THREAD_LOCAL int Optimize;
 
-/* TraceAnalyze = TRUE causes symbol table inserts
- * and lookups to be reported to the listing file
+/* CollectStats = TRUE causes the time spent in each
+ * phase to be measured for -ftime-report and -fstats-json
  */
-extern int TraceAnalyze;
+extern THREAD_LOCAL int CollectStats;
 
-/* TraceCode = TRUE causes comments to be written
- * to the TM code file as code is generated
+/* CollectCounters = TRUE also reads the hardware
+ * performance counters (see perf.h) for each phase
  */
-extern int TraceCode;
+extern THREAD_LOCAL int CollectCounters;
 
 /* Error = TRUE prevents further passes if an error occurs */
-extern int Error;
+extern THREAD_LOCAL int Error;
 #endif
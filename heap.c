@@ -0,0 +1,219 @@
+//
+// Created by liang on 2020/7/16.
+//
+#define HEAP_IMPLEMENTATION
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "globals.h"
+#include "heap.h"
+
+/*分配点，用文件名字符串的地址和行号识别*/
+typedef struct HeapSiteRec {
+    const char *file;
+    int line;
+    const char *func;
+    long allocs;
+    long frees;
+    size_t bytes;/*分配的总字节数*/
+    size_t live;/*当前未释放的字节数*/
+    size_t peak;/*live的最大值*/
+} HeapSite;
+
+/*一块未释放的内存*/
+typedef struct HeapBlockRec {
+    void *ptr;
+    size_t size;
+    HeapSite *site;
+    struct HeapBlockRec *next;
+} HeapBlock;
+
+#define MAX_SITES 1024 /* 必须是2的幂 */
+#define BLOCK_BUCKETS (1 << 16)
+#define SIZE_CLASSES 24 /* 第i类为(2^(i-1), 2^i]字节，最后一类包括更大的分配 */
+
+static HeapSite sites[MAX_SITES];
+static int siteNum = 0;
+static HeapBlock *blocks[BLOCK_BUCKETS];
+static HeapBlock *freeBlocks = NULL;/*回收的HeapBlock*/
+static size_t liveBytes = 0, peakBytes = 0;
+static long sizeCounts[SIZE_CLASSES];
+static size_t sizeBytes[SIZE_CLASSES];
+/*批量编译时多个线程同时分配*/
+static pthread_mutex_t heapLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*找到分配点，没有时加入。调用时已加锁*/
+static HeapSite *findSite(const char *file, int line, const char *func) {
+    unsigned h = (unsigned) (((size_t) file >> 3) * 31 + line) & (MAX_SITES - 1);
+    while (sites[h].file != NULL) {
+        if (sites[h].file == file && sites[h].line == line)
+            return &sites[h];
+        h = (h + 1) & (MAX_SITES - 1);
+    }
+    /*留一个空位，保证查找能够结束*/
+    if (siteNum == MAX_SITES - 1)
+        return NULL;
+    siteNum++;
+    sites[h].file = file;
+    sites[h].line = line;
+    sites[h].func = func;
+    return &sites[h];
+}
+
+static unsigned blockHash(const void *ptr) {
+    return (unsigned) ((size_t) ptr >> 4) & (BLOCK_BUCKETS - 1);
+}
+
+static int sizeClass(size_t size) {
+    int c = 0;
+    while (c < SIZE_CLASSES - 1 && ((size_t) 1 << c) < size)
+        c++;
+    return c;
+}
+
+/*记下一次分配。调用时已加锁*/
+static void track(void *ptr, size_t size, const char *file, int line, const char *func) {
+    HeapSite *site = findSite(file, line, func);
+    HeapBlock *b;
+    int c = sizeClass(size);
+    unsigned h = blockHash(ptr);
+    if (site == NULL)
+        return;
+    if (freeBlocks != NULL) {
+        b = freeBlocks;
+        freeBlocks = b->next;
+    } else
+        b = (HeapBlock *) malloc(sizeof(HeapBlock));
+    b->ptr = ptr;
+    b->size = size;
+    b->site = site;
+    b->next = blocks[h];
+    blocks[h] = b;
+    site->allocs++;
+    site->bytes += size;
+    site->live += size;
+    if (site->live > site->peak)
+        site->peak = site->live;
+    liveBytes += size;
+    if (liveBytes > peakBytes)
+        peakBytes = liveBytes;
+    sizeCounts[c]++;
+    sizeBytes[c] += size;
+}
+
+/*记下一次释放，ptr不是统计过的分配时什么也不做。调用时已加锁*/
+static void untrack(void *ptr) {
+    HeapBlock **p = &blocks[blockHash(ptr)], *b;
+    for (; *p != NULL; p = &(*p)->next)
+        if ((*p)->ptr == ptr) {
+            b = *p;
+            *p = b->next;
+            b->site->frees++;
+            b->site->live -= b->size;
+            liveBytes -= b->size;
+            b->next = freeBlocks;
+            freeBlocks = b;
+            return;
+        }
+}
+
+void *heapMalloc(size_t size, const char *file, int line, const char *func) {
+    void *ptr = malloc(size);
+    if (ptr != NULL) {
+        pthread_mutex_lock(&heapLock);
+        track(ptr, size, file, line, func);
+        pthread_mutex_unlock(&heapLock);
+    }
+    return ptr;
+}
+
+void *heapCalloc(size_t num, size_t size, const char *file, int line, const char *func) {
+    void *ptr = calloc(num, size);
+    if (ptr != NULL) {
+        pthread_mutex_lock(&heapLock);
+        track(ptr, num * size, file, line, func);
+        pthread_mutex_unlock(&heapLock);
+    }
+    return ptr;
+}
+
+/*realloc算作在这里释放原来的内存并重新分配*/
+void *heapRealloc(void *ptr, size_t size, const char *file, int line, const char *func) {
+    void *p;
+    pthread_mutex_lock(&heapLock);
+    if (ptr != NULL)
+        untrack(ptr);
+    p = realloc(ptr, size);
+    if (p != NULL)
+        track(p, size, file, line, func);
+    pthread_mutex_unlock(&heapLock);
+    return p;
+}
+
+void heapFree(void *ptr) {
+    if (ptr == NULL)
+        return;
+    pthread_mutex_lock(&heapLock);
+    untrack(ptr);
+    pthread_mutex_unlock(&heapLock);
+    free(ptr);
+}
+
+int heapProfiling(void) {
+#ifdef HEAP_PROFILE
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+static int compareSites(const void *a, const void *b) {
+    const HeapSite *x = *(const HeapSite **) a, *y = *(const HeapSite **) b;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+/*输出统计*/
+void heapReport(FILE *file) {
+    HeapSite *sorted[MAX_SITES];
+    char name[64];
+    long allocs = 0, frees = 0;
+    size_t bytes = 0, live = 0;
+    int i, num = 0;
+    if (!heapProfiling()) {
+        fprintf(file, "\nHeap profile unavailable: rebuild with make clean; make CFLAGS=-DHEAP_PROFILE\n");
+        return;
+    }
+    pthread_mutex_lock(&heapLock);
+    for (i = 0; i < MAX_SITES; i++)
+        if (sites[i].file != NULL)
+            sorted[num++] = &sites[i];
+    qsort(sorted, num, sizeof(HeapSite *), compareSites);
+    fprintf(file, "\nHeap profile by allocation site\n");
+    fprintf(file, " %-40s %10s %10s %12s %12s %12s\n", "site", "allocs", "frees", "bytes", "peak live",
+            "live at exit");
+    for (i = 0; i < num; i++) {
+        snprintf(name, sizeof(name), "%s:%d %s", sorted[i]->file, sorted[i]->line, sorted[i]->func);
+        fprintf(file, " %-40s %10ld %10ld %12lu %12lu %12lu\n", name, sorted[i]->allocs, sorted[i]->frees,
+                (unsigned long) sorted[i]->bytes, (unsigned long) sorted[i]->peak, (unsigned long) sorted[i]->live);
+        allocs += sorted[i]->allocs;
+        frees += sorted[i]->frees;
+        bytes += sorted[i]->bytes;
+        live += sorted[i]->live;
+    }
+    fprintf(file, " %-40s %10ld %10ld %12lu %12lu %12lu\n", "TOTAL", allocs, frees, (unsigned long) bytes,
+            (unsigned long) peakBytes, (unsigned long) live);
+
+    fprintf(file, "\nAllocation sizes\n %-16s %10s %12s\n", "bytes", "allocs", "total");
+    for (i = 0; i < SIZE_CLASSES; i++) {
+        if (sizeCounts[i] == 0)
+            continue;
+        if (i == SIZE_CLASSES - 1)
+            snprintf(name, sizeof(name), "> %lu", (unsigned long) 1 << (i - 1));
+        else
+            snprintf(name, sizeof(name), "%lu-%lu", i == 0 ? 0ul : ((unsigned long) 1 << (i - 1)) + 1,
+                     (unsigned long) 1 << i);
+        fprintf(file, " %-16s %10ld %12lu\n", name, sizeCounts[i], (unsigned long) sizeBytes[i]);
+    }
+    pthread_mutex_unlock(&heapLock);
+}
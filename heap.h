@@ -0,0 +1,36 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_HEAP_H
+#define TINY_HEAP_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*堆分配统计：用-DHEAP_PROFILE编译时，包含globals.h的文件中的malloc、calloc、realloc和free
+ * 都换成下面的函数，每次分配记下所在的文件、行和函数。按分配点统计次数、字节数、
+ * 峰值和结束时仍未释放的字节数，另外按大小统计分配次数。
+ * 不是由这些函数分配的内存（比如open_memstream的缓冲区）也可以用free释放，不计入统计*/
+void *heapMalloc(size_t size, const char *file, int line, const char *func);
+
+void *heapCalloc(size_t num, size_t size, const char *file, int line, const char *func);
+
+void *heapRealloc(void *ptr, size_t size, const char *file, int line, const char *func);
+
+void heapFree(void *ptr);
+
+/*是否在统计分配，即是否用-DHEAP_PROFILE编译*/
+int heapProfiling(void);
+
+/*输出各分配点的统计，按分配的总字节数从大到小排列，以及分配大小的直方图*/
+void heapReport(FILE *file);
+
+#if defined(HEAP_PROFILE) && !defined(HEAP_IMPLEMENTATION)
+#define malloc(size) heapMalloc(size, __FILE__, __LINE__, __func__)
+#define calloc(num, size) heapCalloc(num, size, __FILE__, __LINE__, __func__)
+#define realloc(ptr, size) heapRealloc(ptr, size, __FILE__, __LINE__, __func__)
+#define free(ptr) heapFree(ptr)
+#endif
+
+#endif //TINY_HEAP_H
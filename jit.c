@@ -0,0 +1,443 @@
+//
+// Created by liang on 2020/7/12.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "translate.h"
+#include "jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+
+/*x86-64寄存器编号*/
+#define RAX 0
+#define RCX 1
+#define RBX 3
+#define RSI 6
+#define RDI 7
+
+/*用来缓存变量的寄存器，r8到r11在调用辅助函数时会被破坏*/
+#define CACHE_NUM 7
+static const int cacheRegs[CACHE_NUM] = {8, 9, 10, 11, 13, 14, 15};
+#define CALLER_SAVED(r) ((r) < 12)
+
+/*每条指令最多生成的字节数（写回全部缓存加上指令本身）*/
+#define MAX_INSTR_BYTES 256
+
+static THREAD_LOCAL unsigned char *buf;
+static THREAD_LOCAL int pos;
+
+/*缓存状态：cacheSlot[k]为第k个缓存寄存器中的变量，slotCache[s]为变量s所在的缓存寄存器*/
+static THREAD_LOCAL int cacheSlot[CACHE_NUM];
+static THREAD_LOCAL int cacheDirty[CACHE_NUM];
+static THREAD_LOCAL int cacheStamp[CACHE_NUM];
+static THREAD_LOCAL int *slotCache;
+static THREAD_LOCAL int stamp;
+static THREAD_LOCAL char *isConst;
+static THREAD_LOCAL VMProgram *curProg;
+
+/*需要回填的跳转：buf[at]起的rel32跳到第target条指令*/
+typedef struct {
+    int at;
+    int target;
+} Fixup;
+
+static THREAD_LOCAL Fixup *fixups;
+static THREAD_LOCAL int fixupNum;
+static THREAD_LOCAL int *labels;/*每条指令的代码偏移*/
+static THREAD_LOCAL int epilogue;
+
+static void emit(int b) {
+    buf[pos++] = (unsigned char) b;
+}
+
+static void emit32(int v) {
+    memcpy(buf + pos, &v, 4);
+    pos += 4;
+}
+
+/*寄存器到寄存器的32位运算，op为操作码（0x0f开头的两字节操作码写作0x0fxx）*/
+static void emitRR(int op, int reg, int rm) {
+    int rex = 0x40 | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40)
+        emit(rex);
+    if (op > 0xff)
+        emit(op >> 8);
+    emit(op & 0xff);
+    emit(0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/*寄存器与帧中变量[rbx+4*slot]之间的32位运算*/
+static void emitRM(int op, int reg, int slot) {
+    if (reg >= 8)
+        emit(0x44);
+    emit(op);
+    emit(0x80 | ((reg & 7) << 3) | RBX);
+    emit32(slot * 4);
+}
+
+/*mov reg, imm32*/
+static void emitMovImm(int reg, int imm) {
+    if (reg >= 8)
+        emit(0x41);
+    emit(0xb8 | (reg & 7));
+    emit32(imm);
+}
+
+/*跳到第target条指令，op为0xe9（jmp）或0x0f8x（jcc）*/
+static void emitJump(int op, int target) {
+    if (op > 0xff)
+        emit(op >> 8);
+    emit(op & 0xff);
+    fixups[fixupNum].at = pos;
+    fixups[fixupNum++].target = target;
+    emit32(0);
+}
+
+/*调用辅助函数，参数已放在rdi、rsi中*/
+static void emitCall(void *fn) {
+    emit(0x48);
+    emit(0xb8);/*mov rax, imm64*/
+    memcpy(buf + pos, &fn, 8);
+    pos += 8;
+    emit(0xff);
+    emit(0xd0);/*call rax*/
+}
+
+/*mov rdi, r12：辅助函数的第一个参数为程序*/
+static void emitProgArg(void) {
+    emit(0x4c);
+    emit(0x89);
+    emit(0xe7);
+}
+
+/*把脏的缓存写回帧，callerSaved为TRUE时同时放弃r8到r11中的缓存，all为TRUE时放弃全部缓存*/
+static void flushCache(int all, int callerSaved) {
+    int k;
+    for (k = 0; k < CACHE_NUM; k++) {
+        if (cacheSlot[k] < 0)
+            continue;
+        if (cacheDirty[k]) {
+            emitRM(0x89, cacheRegs[k], cacheSlot[k]);
+            cacheDirty[k] = FALSE;
+        }
+        if (all || (callerSaved && CALLER_SAVED(cacheRegs[k]))) {
+            slotCache[cacheSlot[k]] = -1;
+            cacheSlot[k] = -1;
+        }
+    }
+}
+
+/*为变量分配一个缓存寄存器，没有空闲的时候换出最久未用的*/
+static int allocCache(int slot) {
+    int k, victim = -1;
+    for (k = 0; k < CACHE_NUM; k++) {
+        if (cacheSlot[k] < 0) {
+            victim = k;
+            break;
+        }
+        if (victim < 0 || cacheStamp[k] < cacheStamp[victim])
+            victim = k;
+    }
+    if (cacheSlot[victim] >= 0) {
+        if (cacheDirty[victim])
+            emitRM(0x89, cacheRegs[victim], cacheSlot[victim]);
+        slotCache[cacheSlot[victim]] = -1;
+    }
+    cacheSlot[victim] = slot;
+    cacheDirty[victim] = FALSE;
+    cacheStamp[victim] = ++stamp;
+    slotCache[slot] = victim;
+    return victim;
+}
+
+/*读变量：返回保存它的寄存器，常量放到scratch中*/
+static int useSlot(int slot, int scratch) {
+    int k;
+    if (isConst[slot]) {
+        emitMovImm(scratch, curProg->init[slot]);
+        return scratch;
+    }
+    k = slotCache[slot];
+    if (k < 0) {
+        k = allocCache(slot);
+        emitRM(0x8b, cacheRegs[k], slot);
+    }
+    cacheStamp[k] = ++stamp;
+    return cacheRegs[k];
+}
+
+/*写变量：返回保存新值的缓存寄存器并标记为脏*/
+static int defSlot(int slot) {
+    int k = slotCache[slot];
+    if (k < 0)
+        k = allocCache(slot);
+    cacheDirty[k] = TRUE;
+    cacheStamp[k] = ++stamp;
+    return cacheRegs[k];
+}
+
+/*a放到eax中，返回b所在的寄存器*/
+static int loadOperands(VMInstr *ins) {
+    int ra = useSlot(ins->a, RAX);
+    if (ra != RAX)
+        emitRR(0x89, ra, RAX);
+    return useSlot(ins->b, RCX);
+}
+
+static int jitIn(VMProgram *prog, int32_t *dst) {
+    return fscanf(prog->in, "%d", dst) == 1 ? VM_OK : VM_BAD_INPUT;
+}
+
+static void jitOut(VMProgram *prog, int value) {
+    fprintf(prog->out, "%d\n", value);
+}
+
+static void jitOutString(VMProgram *prog, int value) {
+    if (value >= 0 && value < prog->stringNum)
+        fprintf(prog->out, "%s\n", vmString(prog, value));
+    else
+        fprintf(prog->out, "%d\n", value);
+}
+
+/*翻译一条指令*/
+static void compileInstr(VMInstr *ins) {
+    static const int jcc[] = {0, 0x0f84, 0x0f8c, 0x0f8f, 0x0f8e, 0x0f8d};/*je jl jg jle jge*/
+    int r, rb;
+    switch (ins->op) {
+        case OP_MOVE:
+            if (isConst[ins->a]) {
+                emitMovImm(defSlot(ins->c), curProg->init[ins->a]);
+                break;
+            }
+            r = useSlot(ins->a, RAX);
+            if (ins->a != ins->c)
+                emitRR(0x89, r, defSlot(ins->c));
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+            rb = loadOperands(ins);
+            if (ins->op == OP_ADD)
+                emitRR(0x01, rb, RAX);
+            else if (ins->op == OP_SUB)
+                emitRR(0x29, rb, RAX);
+            else
+                emitRR(0x0faf, RAX, rb);
+            emitRR(0x89, RAX, defSlot(ins->c));
+            break;
+        case OP_DIV:
+            rb = loadOperands(ins);
+            if (rb != RCX)
+                emitRR(0x89, rb, RCX);
+            emitRR(0x85, RCX, RCX);/*test ecx, ecx*/
+            emit(0x0f);
+            emit(0x84);/*jz 除零*/
+            emit32(0);
+            r = pos;
+            emit(0x83);
+            emit(0xf9);
+            emit(0xff);/*cmp ecx, -1*/
+            emit(0x75);
+            emit(4);/*jne idiv*/
+            emit(0xf7);
+            emit(0xd8);/*neg eax*/
+            emit(0xeb);
+            emit(3);/*jmp 结束*/
+            emit(0x99);/*cdq*/
+            emit(0xf7);
+            emit(0xf9);/*idiv ecx*/
+            /*除零时返回VM_DIV_ZERO*/
+            emit(0xeb);
+            emit(10);
+            memcpy(buf + r - 4, &(int) {pos - r}, 4);
+            emitMovImm(RAX, VM_DIV_ZERO);
+            emit(0xe9);
+            emit32(epilogue - (pos + 4));
+            emitRR(0x89, RAX, defSlot(ins->c));
+            break;
+        case OP_JMP:
+            flushCache(TRUE, TRUE);
+            emitJump(0xe9, ins->c);
+            break;
+        case OP_JEQ:
+        case OP_JLT:
+        case OP_JGT:
+        case OP_JLE:
+        case OP_JGE:
+            rb = loadOperands(ins);
+            emitRR(0x39, rb, RAX);/*cmp eax, rb*/
+            /*mov不改变标志位，写回缓存后再跳转*/
+            flushCache(TRUE, TRUE);
+            emitJump(jcc[ins->op - OP_JMP], ins->c);
+            break;
+        case OP_IN:
+            flushCache(FALSE, TRUE);
+            if (slotCache[ins->c] >= 0) {
+                cacheSlot[slotCache[ins->c]] = -1;
+                slotCache[ins->c] = -1;
+            }
+            emitProgArg();
+            emit(0x48);
+            emit(0x8d);
+            emit(0xb3);
+            emit32(ins->c * 4);/*lea rsi, [rbx+4*c]*/
+            emitCall((void *) jitIn);
+            emitRR(0x85, RAX, RAX);
+            emit(0x0f);
+            emit(0x85);/*jnz 返回错误*/
+            emit32(epilogue - (pos + 4));
+            break;
+        case OP_OUT:
+        case OP_OUTS:
+            r = useSlot(ins->a, RSI);
+            if (r != RSI)
+                emitRR(0x89, r, RSI);
+            flushCache(FALSE, TRUE);
+            emitProgArg();
+            emitCall(ins->op == OP_OUT ? (void *) jitOut : (void *) jitOutString);
+            break;
+        case OP_HALT:
+        default:
+            emitRR(0x31, RAX, RAX);/*xor eax, eax*/
+            emit(0xe9);
+            emit32(epilogue - (pos + 4));
+            break;
+    }
+}
+
+int jitAvailable(void) {
+    return TRUE;
+}
+
+/*把程序翻译为x86-64代码*/
+JITCode *jitCompile(VMProgram *prog) {
+    int n = prog->codeNum, i, k, size;
+    char *leader = (char *) calloc(n + 1, sizeof(char));
+    JITCode *jit;
+    VMInstr *ins;
+    size = 64 + n * MAX_INSTR_BYTES;
+    buf = (unsigned char *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        free(leader);
+        return NULL;
+    }
+    curProg = prog;
+    pos = 0;
+    stamp = 0;
+    fixupNum = 0;
+    fixups = (Fixup *) malloc((n + 1) * sizeof(Fixup));
+    labels = (int *) malloc((n + 1) * sizeof(int));
+    slotCache = (int *) malloc((prog->regNum + 1) * sizeof(int));
+    isConst = (char *) malloc(prog->regNum + 1);
+    for (i = 0; i < prog->regNum; i++) {
+        slotCache[i] = -1;
+        isConst[i] = isConstant(vmSlotName(prog, i));
+    }
+    for (k = 0; k < CACHE_NUM; k++)
+        cacheSlot[k] = -1;
+    /*基本块的首指令：跳转目标和跳转之后的指令，进入时缓存为空*/
+    for (i = 0; i < n; i++) {
+        ins = &prog->code[i];
+        if (ins->op >= OP_JMP && ins->op <= OP_JGE) {
+            leader[ins->c] = TRUE;
+            leader[i + 1] = TRUE;
+        }
+    }
+
+    /*结尾：恢复被调用者保存的寄存器后返回eax*/
+    epilogue = pos;
+    emit(0x41);
+    emit(0x5f);/*pop r15*/
+    emit(0x41);
+    emit(0x5e);/*pop r14*/
+    emit(0x41);
+    emit(0x5d);/*pop r13*/
+    emit(0x41);
+    emit(0x5c);/*pop r12*/
+    emit(0x5b);/*pop rbx*/
+    emit(0xc3);/*ret*/
+    /*入口：保存寄存器（5次压栈后栈按16字节对齐），rbx为帧，r12为程序*/
+    k = pos;
+    emit(0x53);/*push rbx*/
+    emit(0x41);
+    emit(0x54);/*push r12*/
+    emit(0x41);
+    emit(0x55);/*push r13*/
+    emit(0x41);
+    emit(0x56);/*push r14*/
+    emit(0x41);
+    emit(0x57);/*push r15*/
+    emit(0x48);
+    emit(0x89);
+    emit(0xfb);/*mov rbx, rdi*/
+    emit(0x49);
+    emit(0x89);
+    emit(0xf4);/*mov r12, rsi*/
+    for (i = 0; i < n; i++) {
+        if (leader[i])
+            flushCache(TRUE, TRUE);
+        labels[i] = pos;
+        compileInstr(&prog->code[i]);
+    }
+    labels[n] = pos;
+    for (i = 0; i < fixupNum; i++) {
+        int rel = labels[fixups[i].target] - (fixups[i].at + 4);
+        memcpy(buf + fixups[i].at, &rel, 4);
+    }
+    /*不允许把可写的内存改为可执行时（W^X）放弃，由虚拟机执行*/
+    if (mprotect(buf, size, PROT_READ | PROT_EXEC) == 0) {
+        jit = (JITCode *) malloc(sizeof(JITCode));
+        jit->mem = buf;
+        jit->size = size;
+        jit->entry = (int (*)(int32_t *, VMProgram *)) (void *) (buf + k);
+    } else {
+        munmap(buf, size);
+        jit = NULL;
+    }
+    free(isConst);
+    free(slotCache);
+    free(labels);
+    free(fixups);
+    free(leader);
+    return jit;
+}
+
+/*释放本机代码*/
+void jitFree(JITCode *jit) {
+    if (jit == NULL)
+        return;
+    munmap(jit->mem, jit->size);
+    free(jit);
+}
+
+#else
+
+int jitAvailable(void) {
+    return FALSE;
+}
+
+JITCode *jitCompile(VMProgram *prog) {
+    (void) prog;
+    return NULL;
+}
+
+void jitFree(JITCode *jit) {
+    (void) jit;
+}
+
+#endif
+
+/*执行本机代码，每次执行都从寄存器的初值开始*/
+int jitRun(JITCode *jit, VMProgram *prog) {
+    int status;
+    int32_t *frame = (int32_t *) malloc((prog->regNum + 1) * sizeof(int32_t));
+    memcpy(frame, prog->init, prog->regNum * sizeof(int32_t));
+    status = jit->entry(frame, prog);
+    fflush(prog->out);
+    free(frame);
+    return status;
+}
@@ -0,0 +1,30 @@
+//
+// Created by liang on 2020/7/12.
+//
+
+#ifndef TINY_JIT_H
+#define TINY_JIT_H
+
+#include "vm.h"
+
+/*即时编译得到的本机代码*/
+typedef struct JITCodeRec {
+    void *mem;/*mmap得到的可执行缓冲区*/
+    size_t size;
+    int (*entry)(int32_t *frame, VMProgram *prog);/*frame为变量数组，返回VM_OK或运行错误*/
+} JITCode;
+
+/*是否支持即时编译（x86-64 Linux）*/
+int jitAvailable(void);
+
+/*把程序翻译为x86-64代码：变量放在帧数组中，基本块内用寄存器缓存，
+ * IN和OUT调用辅助函数。不支持或不能把代码设为可执行时返回NULL*/
+JITCode *jitCompile(VMProgram *prog);
+
+/*执行本机代码，每次执行都从寄存器的初值开始*/
+int jitRun(JITCode *jit, VMProgram *prog);
+
+/*释放本机代码*/
+void jitFree(JITCode *jit);
+
+#endif //TINY_JIT_H
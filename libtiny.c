@@ -0,0 +1,174 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "translate.h"
+#include "outbuf.h"
+#include "batch.h"
+#include "trace.h"
+#include "tiny.h"
+
+/* allocate global variables */
+THREAD_LOCAL int lineno = 0;
+THREAD_LOCAL FILE *source;
+THREAD_LOCAL FILE *listing;
+THREAD_LOCAL FILE *code;
+THREAD_LOCAL FILE *binary = NULL;
+THREAD_LOCAL FILE *ccode = NULL;
+
+/* allocate and set tracing levels, the defaults of tiny */
+THREAD_LOCAL int traceLevel[TRACE_NUM] = {1, 1, 1, 1, 1, 1, 1};
+
+THREAD_LOCAL int Optimize = TRUE;
+THREAD_LOCAL int CollectStats = FALSE;
+THREAD_LOCAL int CollectCounters = FALSE;
+
+THREAD_LOCAL int Error = FALSE;
+
+/*结果中的字符串按块分配，和结果一起释放*/
+#define ARENA_BLOCK_SIZE 4096
+typedef struct ArenaBlockRec {
+    struct ArenaBlockRec *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaBlock;
+
+static void *arenaAlloc(TinyResult *result, size_t size) {
+    ArenaBlock *b = (ArenaBlock *) result->arena;
+    size = (size + 7) & ~(size_t) 7;
+    if (b == NULL || b->used + size > b->size) {
+        size_t blockSize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        b = (ArenaBlock *) malloc(sizeof(ArenaBlock) + blockSize);
+        b->size = blockSize;
+        b->used = 0;
+        b->next = (ArenaBlock *) result->arena;
+        result->arena = b;
+    }
+    b->used += size;
+    return b->data + b->used - size;
+}
+
+static const char *arenaString(TinyResult *result, const char *s) {
+    if (s == NULL)
+        return NULL;
+    return strcpy((char *) arenaAlloc(result, strlen(s) + 1), s);
+}
+
+/*返回默认选项*/
+TinyOptions tinyDefaultOptions(void) {
+    TinyOptions options = {"input.tny", TRUE, FALSE, 0};
+    return options;
+}
+
+/*把符号表中的一个名字复制到结果中*/
+static void copySymbol(BucketList bucket, void *arg) {
+    TinyResult *result = (TinyResult *) arg;
+    TinySymbol *symbol = &result->symbols[result->symbolNum++];
+    LineList line;
+    int *lines, n = 0;
+    for (line = bucket->lines; line != NULL; line = line->next)
+        n++;
+    lines = (int *) arenaAlloc(result, n * sizeof(int));
+    symbol->name = arenaString(result, bucket->name);
+    symbol->location = bucket->memloc;
+    symbol->lines = lines;
+    symbol->lineNum = n;
+    for (line = bucket->lines; line != NULL; line = line->next)
+        *lines++ = line->lineno;
+}
+
+static void countSymbol(BucketList bucket, void *arg) {
+    (void) bucket;
+    (*(int *) arg)++;
+}
+
+/*复制四元式和符号表*/
+static void copyProgram(TinyResult *result) {
+    int i, num = 0;
+    result->quads = (TinyQuad *) malloc((curIndex + 1) * sizeof(TinyQuad));
+    for (i = 0; i < curIndex; i++) {
+        result->quads[i].op = arenaString(result, quadruples[i].operator);
+        result->quads[i].arg1 = arenaString(result, quadruples[i].arg1);
+        result->quads[i].arg2 = arenaString(result, quadruples[i].arg2);
+        result->quads[i].result = arenaString(result, quadruples[i].result);
+        result->quads[i].line = quadruples[i].lineno;
+    }
+    result->quadNum = curIndex;
+    symTabVisit(countSymbol, &num);
+    result->symbols = (TinySymbol *) malloc((num + 1) * sizeof(TinySymbol));
+    symTabVisit(copySymbol, result);
+}
+
+/*在内存中编译一个源程序*/
+TinyResult *tinyCompile(const char *text, size_t size, const TinyOptions *options) {
+    TinyOptions defaults = tinyDefaultOptions();
+    TinyResult *result = (TinyResult *) calloc(1, sizeof(TinyResult));
+    int savedLevel[TRACE_NUM], savedOptimize = Optimize, i;
+    TreeNode *syntaxTree;
+    char *codeFile;
+    if (options == NULL)
+        options = &defaults;
+    memcpy(savedLevel, traceLevel, sizeof(savedLevel));
+    traceSetAll(options->trace);
+    Optimize = options->optimize;
+
+    source = fmemopen(text != NULL ? (void *) text : "", size, "r");
+    listing = open_memstream(&result->listing, &result->listingSize);
+    syntaxTree = parseSource();
+    if (syntaxTree != NULL) {
+        code = open_memstream(&result->code, &result->codeSize);
+        binary = open_memstream((char **) &result->bytecode, &result->bytecodeSize);
+        ccode = options->emitC ? open_memstream(&result->ccode, &result->ccodeSize) : NULL;
+        codeFile = outputName(options->name != NULL ? options->name : defaults.name, ".tm");
+        codeGen(syntaxTree, codeFile);
+        free(codeFile);
+        copyProgram(result);
+        freeTree(syntaxTree);
+        outClose(code);
+        fclose(code);
+        fclose(binary);
+        if (ccode != NULL)
+            fclose(ccode);
+        result->ok = !Error;
+    }
+    outClose(listing);
+    fclose(listing);
+    fclose(source);
+    code = binary = ccode = listing = source = NULL;
+
+    result->diagnostics = (TinyDiagnostic *) malloc((diagnosticNum + 1) * sizeof(TinyDiagnostic));
+    for (i = 0; i < diagnosticNum; i++) {
+        result->diagnostics[i].line = diagnostics[i].lineno;
+        result->diagnostics[i].message = arenaString(result, diagnostics[i].message);
+    }
+    result->diagnosticNum = diagnosticNum;
+    memcpy(traceLevel, savedLevel, sizeof(savedLevel));
+    Optimize = savedOptimize;
+    return result;
+}
+
+/*释放编译结果*/
+void tinyFree(TinyResult *result) {
+    ArenaBlock *b;
+    if (result == NULL)
+        return;
+    while (result->arena != NULL) {
+        b = (ArenaBlock *) result->arena;
+        result->arena = b->next;
+        free(b);
+    }
+    free(result->quads);
+    free(result->symbols);
+    free(result->diagnostics);
+    free(result->code);
+    free(result->bytecode);
+    free(result->ccode);
+    free(result->listing);
+    free(result);
+}
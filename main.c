@@ -5,6 +5,7 @@
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <unistd.h>
 #include "globals.h"
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
@@ -14,6 +15,15 @@
 #include "util.h"
 #include "analyze.h"
 #include "translate.h"
+#include "vm.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "outbuf.h"
+#include "batch.h"
+#include "daemon.h"
+#include "stats.h"
+#include "trace.h"
+#include "profile.h"
 
 #if NO_PARSE
 #include "scan.h"
@@ -23,72 +33,233 @@
 
 #endif
 
-/* allocate global variables */
-int lineno = 0;
-FILE *source;
-FILE *listing;
-FILE *code;
+/* global variables are allocated in libtiny.c */
 
-/* allocate and set tracing flags */
-int EchoSource = TRUE;
-int TraceScan = TRUE;
-int TraceParse = TRUE;
-int TraceAnalyze = TRUE;
-int TraceCode = TRUE;
+/*运行方式：不运行、虚拟机解释执行、即时编译后执行*/
+#define RUN_NONE 0
+#define RUN_VM 1
+#define RUN_JIT 2
 
-int Error = FALSE;
+/*运行程序并报告运行错误，返回进程的退出码。不支持即时编译时退回虚拟机，
+ * profile不为NULL时用计数的虚拟机执行*/
+static int runProgram(VMProgram *prog, int run, VMProfile *profile) {
+    int status;
+    JITCode *jit = run == RUN_JIT ? jitCompile(prog) : NULL;
+    if (jit != NULL) {
+        status = jitRun(jit, prog);
+        jitFree(jit);
+    } else if (profile != NULL)
+        status = vmRunProfiled(prog, profile);
+    else
+        status = vmRun(prog, TRUE);
+    if (status == VM_DIV_ZERO)
+        fprintf(stderr, "Runtime error: division by zero\n");
+    else if (status == VM_BAD_INPUT)
+        fprintf(stderr, "Runtime error: bad input\n");
+    return status;
+}
+
+/*映射字节码文件，运行它或者输出带行号的反汇编*/
+static int loadBytecode(char *fileName, int run) {
+    int status = 0;
+    VMProgram *prog = bcMap(fileName);
+    if (prog == NULL)
+        return 1;
+    if (run != RUN_NONE)
+        status = runProgram(prog, run, NULL);
+    else
+        bcDisassemble(prog, stdout, TRUE);
+    vmFree(prog);
+    return status;
+}
+
+/*批量编译：tiny -b [-t threads] <file | @manifest>...，@开头的参数是清单文件*/
+static int batchMain(int argc, char *argv[]) {
+    BatchList list = {NULL, 0, 0};
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 2;
+    if (argc > 3 && strcmp(argv[2], "-t") == 0) {
+        threads = atoi(argv[3]);
+        i = 4;
+    }
+    for (; i < argc; i++)
+        if (argv[i][0] != '@')
+            batchAdd(&list, argv[i]);
+        else if (!batchAddManifest(&list, argv[i] + 1)) {
+            fprintf(stderr, "File %s not found\n", argv[i] + 1);
+            exit(1);
+        }
+    if (list.num == 0) {
+        fprintf(stderr, "usage: %s -b [-t threads] <file | @manifest>...\n", argv[0]);
+        exit(1);
+    }
+    /*批量编译时只报告错误*/
+    listing = stderr;
+    traceSetAll(0);
+    return batchCompile(&list, (int) threads) > 0;
+}
+
+/*编译守护进程：tiny -d [socket]，清单和跟踪与tiny <filename>相同*/
+static int daemonMain(int argc, char *argv[]) {
+    const char *path = argc > 2 ? argv[2] : getenv("TINY_SOCKET");
+    if (argc > 3) {
+        fprintf(stderr, "usage: %s -d [socket]\n", argv[0]);
+        exit(1);
+    }
+    return !serveDaemon(path != NULL && path[0] != '\0' ? path : DAEMON_SOCKET);
+}
+
+/*输出-ftime-report的表格和-fstats-json的JSON文件*/
+static void reportStats(const char *pgm, int timeReport, const char *statsFile) {
+    FILE *file;
+    outFlushAll();
+    if (timeReport)
+        statsPrint(stderr);
+    if (timeReport && CollectCounters)
+        statsPrintCounters(stderr);
+    if (statsFile == NULL)
+        return;
+    file = strcmp(statsFile, "-") == 0 ? stdout : fopen(statsFile, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open %s\n", statsFile);
+        return;
+    }
+    statsPrintJSON(file, pgm);
+    if (file != stdout)
+        fclose(file);
+}
+
+/*程序结束时输出堆分配统计*/
+static void reportHeap(void) {
+    outFlushAll();
+    heapReport(stderr);
+}
 
 int main(int argc, char *argv[]) {
-    TreeNode *syntaxTree;
-    char pgm[120]; /* source code file name */
-    if (argc != 2) {
-        fprintf(stderr, "usage: %s <filename>\n", argv[0]);
+    OutBuf *out;
+    char *pgm; /* source code file name */
+    int ok;
+    int run = RUN_NONE; /* -r：编译后在虚拟机上运行，-j：即时编译后运行 */
+    int emitC = FALSE; /* -c：同时把程序翻译为C写入<name>.c */
+    int timeReport = FALSE; /* -ftime-report：在stderr上输出各阶段的时间和计数 */
+    char *statsFile = NULL; /* -fstats-json=<file>：把同样的统计以JSON写入file */
+    int perfCounters = FALSE; /* -fperf-counters：同时统计各阶段的硬件计数 */
+    int heapProfile = FALSE; /* -fheap-report：结束时在stderr上输出各分配点的堆分配统计 */
+    char *profileOut = NULL; /* -fprofile-generate[=<file>]：在虚拟机上运行并把剖析写入file */
+    char *profileIn = NULL; /* -fprofile-use[=<file>]：按file中的剖析重排基本块 */
+    char *traceSpec = NULL; /* -trace=scan=2,code=0：各子系统的跟踪级别 */
+    int status = 0, i;
+    if (argc >= 2 && strcmp(argv[1], "-b") == 0)
+        return batchMain(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "-d") == 0)
+        return daemonMain(argc, argv);
+    for (i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-r") == 0 && run == RUN_NONE && !emitC)
+            run = RUN_VM;
+        else if (strcmp(argv[i], "-j") == 0 && run == RUN_NONE && !emitC)
+            run = RUN_JIT;
+        else if (strcmp(argv[i], "-c") == 0 && run == RUN_NONE)
+            emitC = TRUE;
+        else if (strcmp(argv[i], "-O0") == 0)
+            Optimize = FALSE;
+        else if (strcmp(argv[i], "-ftime-report") == 0)
+            timeReport = TRUE;
+        else if (strncmp(argv[i], "-fstats-json=", 13) == 0 && argv[i][13] != '\0')
+            statsFile = argv[i] + 13;
+        else if (strcmp(argv[i], "-fperf-counters") == 0)
+            perfCounters = TRUE;
+        else if (strcmp(argv[i], "-fheap-report") == 0)
+            heapProfile = TRUE;
+        else if (strcmp(argv[i], "-fprofile-generate") == 0 || strncmp(argv[i], "-fprofile-generate=", 19) == 0)
+            profileOut = argv[i] + 18;
+        else if (strcmp(argv[i], "-fprofile-use") == 0 || strncmp(argv[i], "-fprofile-use=", 14) == 0)
+            profileIn = argv[i] + 13;
+        else if (strncmp(argv[i], "-trace=", 7) == 0 && traceParseSpec(argv[i] + 7))
+            traceSpec = argv[i] + 7;
+        else
+            break;
+    }
+    if (argc < 2 || i != argc - 1) {
+        fprintf(stderr, "usage: %s [-r | -j | -c] [-O0] [-ftime-report] [-fstats-json=<file>] [-fperf-counters]\n"
+                        "       [-fheap-report] [-fprofile-generate[=<file>]] [-fprofile-use[=<file>]]\n"
+                        "       [-trace=<spec>] <filename>\n",
+                argv[0]);
+        fprintf(stderr, "       spec: <subsystem>=<level>,... subsystem: all source scan parse analyze code cfg opt\n");
+        fprintf(stderr, "       %s -b [-t threads] <file | @manifest>...\n", argv[0]);
+        fprintf(stderr, "       %s -d [socket]\n", argv[0]);
         exit(1);
     }
-    strcpy(pgm, argv[1]);
+    /*只给出-fperf-counters时在stderr上输出计数*/
+    if (perfCounters && statsFile == NULL)
+        timeReport = TRUE;
+    CollectStats = timeReport || statsFile != NULL;
+    CollectCounters = perfCounters;
+    if (heapProfile)
+        atexit(reportHeap);
+    /*取剖析只能在虚拟机上运行*/
+    if (profileOut != NULL)
+        run = RUN_VM;
+    pgm = (char *) malloc(strlen(argv[argc - 1]) + 5);
+    strcpy(pgm, argv[argc - 1]);
+    if (strlen(pgm) > 4 && strcmp(pgm + strlen(pgm) - 4, ".tnb") == 0)
+        return loadBytecode(pgm, run);
     if (strchr(pgm, '.') == NULL)
         strcat(pgm, ".tny");
+    /*剖析文件默认为<name>.prof*/
+    if (profileOut != NULL)
+        profileOut = *profileOut == '=' ? profileOut + 1 : outputName(pgm, ".prof");
+    if (profileIn != NULL) {
+        profileIn = *profileIn == '=' ? profileIn + 1 : outputName(pgm, ".prof");
+        if (!profileLoad(profileIn)) {
+            fprintf(stderr, "Unable to read profile %s\n", profileIn);
+            exit(1);
+        }
+    }
     source = fopen(pgm, "r");
     if (source == NULL) {
         fprintf(stderr, "File %s not found\n", pgm);
         exit(1);
     }
     listing = stdout; /* send listing to screen */
-    fprintf(listing, "\nTINY COMPILATION: %s\n", pgm);
+    if (run) {
+        /*运行模式下标准输出留给程序，只在stderr上报告错误*/
+        listing = stderr;
+        traceSetAll(0);
+    }
+    if (traceSpec != NULL)
+        traceParseSpec(traceSpec);
+    /*清单经过缓冲区输出*/
+    out = outOpen(listing);
+    if (!run) {
+        outPuts(out, "\nTINY COMPILATION: ");
+        outPuts(out, pgm);
+        outChar(out, '\n');
+    }
 #if NO_PARSE
+    initScanner();
     while (getToken() != ENDFILE);
 #else
-    syntaxTree = parse();
-    if (TraceParse) {
-        fprintf(listing, "\nSyntax tree:\n");
-        printTree(syntaxTree);
-    }
-#endif
-    if (!Error) {
-        if (TraceAnalyze)
-            fprintf(listing, "\nBuilding Symbol Table...\n");
-        buildSymTab(syntaxTree);
-        /*if (TraceAnalyze)
-            fprintf(listing, "\nChecking Types...\n");
-        typeCheck(syntaxTree);
-        if (TraceAnalyze)
-            fprintf(listing, "\nType Checking Finished\n");*/
+    ok = compileSource(pgm, emitC);
+    if (traceRecording()) {
+        outFlushAll();
+        traceDump(listing);
     }
-    if (!Error) {
-        char *codeFile;
-        int fnlen = strcspn(pgm, ".");
-        codeFile = (char *) calloc(fnlen + 4, sizeof(char));
-        strncpy(codeFile, pgm, fnlen);
-        strcat(codeFile, ".tm");
-        code = fopen(codeFile, "w");
-        if (code == NULL) {
-            printf("Unable to open %s\n", codeFile);
-            exit(1);
+    if (CollectStats)
+        reportStats(pgm, timeReport, statsFile);
+    if (ok) {
+        if (run) {
+            VMProgram *prog = vmLoad();
+            VMProfile *profile = profileOut != NULL ? vmProfileNew(prog) : NULL;
+            outFlushAll();
+            status = runProgram(prog, run, profile);
+            if (profile != NULL && !profileWrite(profileOut, profile))
+                fprintf(stderr, "Unable to write profile %s\n", profileOut);
+            vmProfileFree(profile);
+            vmFree(prog);
         }
-        codeGen(syntaxTree, codeFile);
-        fclose(code);
-    }
+    } else if (run != RUN_NONE)
+        status = 1;
+#endif
     fclose(source);
-    return 0;
+    return status;
 }
-
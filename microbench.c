@@ -0,0 +1,338 @@
+//
+// Created by liang on 2020/7/16.
+//
+/*编译器组件的微基准测试：microbench [-r repeats] [-p] [name]
+ * 每个测试用固定种子生成的输入重复运行repeats次（默认5），输出每次操作的中位数时间（ns/op）。
+ * 给出name时只运行名字以name开头的测试。-p：同时输出所有重复中的IPC、每次操作的分支预测失败和L1缓存缺失*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "symtab.h"
+#include "translate.h"
+#include "outbuf.h"
+#include "batch.h"
+#include "trace.h"
+#include "perf.h"
+
+#define MAX_REPEATS 101
+#define TEXT_SIZE (1 << 20)
+#define MAX_NAMES 10000
+
+static unsigned long seed;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*每个测试从同一个种子开始，输入和测试的顺序无关*/
+static void resetRandom(unsigned long s) {
+    seed = s * 2654435761ul + 1;
+}
+
+static int randomInt(int n) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (int) (seed % (unsigned long) n);
+}
+
+/*生成的源程序和名字*/
+static char *text;
+static size_t textSize;
+static char *names[MAX_NAMES];
+static FILE *devNull;
+
+/*按种类生成扫描用的源程序，每行不超过80个字符*/
+static void makeScanText(int kind) {
+    static const char *words[] = {"if", "then", "end", "repeat", "until", "read", "write", "and", "or", "not"};
+    size_t len = 0, line = 0;
+    int i, n;
+    resetRandom(kind + 1);
+    while (len < TEXT_SIZE - 100) {
+        switch (kind) {
+            case 0:/*标识符和保留字*/
+                if (randomInt(4) == 0)
+                    n = sprintf(text + len, "%s ", words[randomInt(10)]);
+                else {
+                    n = 0;
+                    for (i = randomInt(12) + 1; i > 0; i--)
+                        text[len + n++] = (char) ('a' + randomInt(26));
+                    text[len + n++] = ' ';
+                }
+                break;
+            case 1:/*数*/
+                n = sprintf(text + len, "%d ", randomInt(1000000));
+                break;
+            case 2:/*注释*/
+                n = sprintf(text + len, "{ comment %d with some words } x ", randomInt(1000));
+                break;
+            default:/*字符串*/
+                n = sprintf(text + len, "'string literal %d' ", randomInt(1000));
+        }
+        len += n;
+        line += n;
+        if (line > 80) {
+            text[len++] = '\n';
+            line = 0;
+        }
+    }
+    textSize = len;
+}
+
+/*扫描整个源程序，返回单词数*/
+static long scanText(void) {
+    long tokens = 0;
+    source = fmemopen(text, textSize, "r");
+    initScanner();
+    while (getToken() != ENDFILE)
+        tokens++;
+    fclose(source);
+    return tokens;
+}
+
+/*以下每个测试函数运行一次，返回完成的操作数*/
+static long benchReserved(void) {
+    static char *words[] = {"if", "then", "while", "do", "x", "count", "string", "total", "bool", "sum"};
+    long i;
+    int found = 0;
+    for (i = 0; i < 1000000; i++)
+        found += reservedLookup(words[i % 10]) == ID;
+    return found > 0 ? i : 0;
+}
+
+/*名字v0、v1……，symtab中保存名字的指针，所以一直保留*/
+static void makeNames(void) {
+    char buf[16];
+    int i;
+    for (i = 0; i < MAX_NAMES; i++) {
+        sprintf(buf, "v%d", i);
+        names[i] = copyString(buf);
+    }
+}
+
+static int occupancy;
+
+static long benchSymTabInsert(void) {
+    int i, k, rounds = MAX_NAMES / occupancy;
+    for (k = 0; k < rounds; k++) {
+        symTabClear();
+        for (i = 0; i < occupancy; i++)
+            symTabInsert(names[i], i, i);
+    }
+    symTabClear();
+    return (long) rounds * occupancy;
+}
+
+/*符号表中已有occupancy个名字，随机查找其中的名字*/
+static long benchSymTabLookUp(void) {
+    long i, sum = 0;
+    resetRandom(7);
+    for (i = 0; i < 1000000; i++)
+        sum += symTabLookUp(names[randomInt(occupancy)]);
+    return sum >= 0 ? i : 0;
+}
+
+static int chainLength;
+
+/*和翻译a or b or ...一样，把新的链表合并到前面的链表之后，最后回填*/
+static long benchBackPatch(void) {
+    QuaLinkList *list;
+    int i, k, rounds = 100000 / chainLength;
+    reserveQuadruples(chainLength);
+    curIndex = chainLength;
+    for (k = 0; k < rounds; k++) {
+        list = NULL;
+        for (i = 0; i < chainLength; i++)
+            list = merge(list, makeList(i));
+        backPatch(list, chainLength);
+    }
+    curIndex = 0;
+    return (long) rounds * chainLength;
+}
+
+static long benchAddQuadruple(void) {
+    int i;
+    curIndex = 0;
+    for (i = 0; i < 100000; i++)
+        addQuadruple("plus", names[i % 100], names[(i + 1) % 100], names[i % 1000]);
+    curIndex = 0;
+    return i;
+}
+
+/*语法树和四元式*/
+static TreeNode *tree;
+static long treeNodes, quadNum;
+
+static void countNodes(TreeNode *t) {
+    int i;
+    for (; t != NULL; t = t->sibling) {
+        treeNodes++;
+        for (i = 0; i < MAXCHILDREN; i++)
+            countNodes(t->child[i]);
+    }
+}
+
+/*生成赋值、条件和循环语句组成的程序，语法分析并翻译为四元式*/
+static void makeProgram(void) {
+    size_t len = 0;
+    int i;
+    resetRandom(11);
+    len += sprintf(text, "int v0");
+    for (i = 1; i < 32; i++)
+        len += sprintf(text + len, ", v%d", i);
+    len += sprintf(text + len, ";\n");
+    while (len < TEXT_SIZE / 4) {
+        switch (randomInt(4)) {
+            case 0:
+                len += sprintf(text + len, "if v%d < v%d and v%d > %d then v%d := v%d + %d; else write v%d; end;\n",
+                               randomInt(32), randomInt(32), randomInt(32), randomInt(100), randomInt(32),
+                               randomInt(32), randomInt(100), randomInt(32));
+                break;
+            case 1:
+                len += sprintf(text + len, "repeat v%d := v%d - 1; until v%d <= 0 or v%d = %d;\n",
+                               randomInt(32), randomInt(32), randomInt(32), randomInt(32), randomInt(100));
+                break;
+            default:
+                len += sprintf(text + len, "v%d := v%d * (v%d + %d) - v%d / %d;\n", randomInt(32), randomInt(32),
+                               randomInt(32), randomInt(100), randomInt(32), randomInt(9) + 1);
+        }
+    }
+    textSize = len;
+    source = fmemopen(text, textSize, "r");
+    tree = parseSource();
+    fclose(source);
+    if (tree == NULL) {
+        fprintf(stderr, "generated program has errors\n");
+        exit(1);
+    }
+    countNodes(tree);
+    Optimize = FALSE;
+    code = devNull;
+    codeGen(tree, "/dev/null");
+    quadNum = curIndex;
+}
+
+static long benchPrintTree(void) {
+    printTree(tree);
+    outFlush(outOpen(listing));
+    return treeNodes;
+}
+
+static long benchPrintQuadruple(void) {
+    printQuadruple(devNull);
+    outFlush(outOpen(devNull));
+    return quadNum;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return x < y ? -1 : x > y;
+}
+
+static const char *filter = "";
+static int repeats = 5;
+static int counting = FALSE;
+
+/*可用时输出计数，否则输出n/a*/
+static void printPerOp(PerfCounter counter, double value) {
+    if (perfAvailable(counter))
+        printf("  %s %8.3f", perfNames[counter], value);
+    else
+        printf("  %s %8s", perfNames[counter], "n/a");
+}
+
+/*预热一次后运行repeats次，输出每次操作的中位数时间*/
+static void run(const char *name, long (*bench)(void)) {
+    double times[MAX_REPEATS], start, total = 0;
+    long long before[PERF_NUM], after[PERF_NUM];
+    long ops;
+    int k;
+    if (strncmp(name, filter, strlen(filter)) != 0)
+        return;
+    ops = bench();
+    if (counting)
+        perfRead(before);
+    for (k = 0; k < repeats; k++) {
+        start = now();
+        ops = bench();
+        times[k] = (now() - start) * 1e9 / (ops > 0 ? ops : 1);
+        total += ops;
+    }
+    qsort(times, repeats, sizeof(double), compareDouble);
+    printf("%-28s %10ld ops %10.2f ns/op  min %10.2f  max %10.2f", name, ops,
+           repeats % 2 ? times[repeats / 2] : (times[repeats / 2 - 1] + times[repeats / 2]) / 2,
+           times[0], times[repeats - 1]);
+    if (counting) {
+        perfRead(after);
+        if (perfAvailable(PERF_CYCLES) && perfAvailable(PERF_INSTRUCTIONS) && after[PERF_CYCLES] > before[PERF_CYCLES])
+            printf("  IPC %5.2f", (double) (after[PERF_INSTRUCTIONS] - before[PERF_INSTRUCTIONS]) /
+                                  (after[PERF_CYCLES] - before[PERF_CYCLES]));
+        else
+            printf("  IPC %5s", "n/a");
+        printPerOp(PERF_BRANCH_MISSES, (after[PERF_BRANCH_MISSES] - before[PERF_BRANCH_MISSES]) / total);
+        printPerOp(PERF_L1D_MISSES, (after[PERF_L1D_MISSES] - before[PERF_L1D_MISSES]) / total);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const char *scanNames[] = {"scan/ident", "scan/number", "scan/comment", "scan/string"};
+    static const int occupancies[] = {10, 100, 1000, 10000};
+    static const int chains[] = {4, 64, 1024};
+    char name[64];
+    int i = 1, k;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            repeats = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0)
+            counting = TRUE;
+        else
+            break;
+    }
+    if (i < argc && argv[i][0] != '-')
+        filter = argv[i++];
+    if (i < argc || repeats < 1 || repeats > MAX_REPEATS) {
+        fprintf(stderr, "usage: %s [-r repeats] [-p] [name]\n", argv[0]);
+        exit(1);
+    }
+    if (counting && perfOpen() == 0)
+        fprintf(stderr, "Hardware counters unavailable (see /proc/sys/kernel/perf_event_paranoid)\n");
+    traceSetAll(0);
+    devNull = fopen("/dev/null", "w");
+    listing = devNull;
+    text = (char *) malloc(TEXT_SIZE);
+    makeNames();
+
+    for (i = 0; i < 4; i++) {
+        makeScanText(i);
+        run(scanNames[i], scanText);
+    }
+    run("reservedLookup", benchReserved);
+    for (i = 0; i < 4; i++) {
+        occupancy = occupancies[i];
+        sprintf(name, "symTabInsert/%d", occupancy);
+        run(name, benchSymTabInsert);
+        for (k = 0; k < occupancy; k++)
+            symTabInsert(names[k], k, k);
+        sprintf(name, "symTabLookUp/%d", occupancy);
+        run(name, benchSymTabLookUp);
+        symTabClear();
+    }
+    for (i = 0; i < 3; i++) {
+        chainLength = chains[i];
+        sprintf(name, "backPatch/%d", chainLength);
+        run(name, benchBackPatch);
+    }
+    run("addQuadruple", benchAddQuadruple);
+    makeProgram();
+    run("printTree", benchPrintTree);
+    run("printQuadruple", benchPrintQuadruple);
+    freeTree(tree);
+    return 0;
+}
@@ -0,0 +1,64 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "nametab.h"
+
+static unsigned nameHash(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s)
+        h = (h ^ (unsigned char) *s++) * 16777619u;
+    return h;
+}
+
+/*名字所在或应当插入的位置*/
+static int probe(NameTable *table, const char *name) {
+    int h = (int) (nameHash(name) & (table->capacity - 1));
+    while (table->names[h] != NULL && strcmp(table->names[h], name) != 0)
+        h = (h + 1) & (table->capacity - 1);
+    return h;
+}
+
+/*容量加倍并重新插入所有名字*/
+static void growTable(NameTable *table) {
+    char **oldNames = table->names;
+    int *oldValues = table->values;
+    int i, h, oldCapacity = table->capacity;
+    table->capacity = oldCapacity == 0 ? 256 : oldCapacity * 2;
+    table->names = (char **) calloc(table->capacity, sizeof(char *));
+    table->values = (int *) malloc(table->capacity * sizeof(int));
+    for (i = 0; i < oldCapacity; i++)
+        if (oldNames[i] != NULL) {
+            h = probe(table, oldNames[i]);
+            table->names[h] = oldNames[i];
+            table->values[h] = oldValues[i];
+        }
+    free(oldNames);
+    free(oldValues);
+}
+
+int nameTableFind(NameTable *table, const char *name) {
+    int h;
+    if (table->num == 0)
+        return -1;
+    h = probe(table, name);
+    return table->names[h] == NULL ? -1 : table->values[h];
+}
+
+void nameTableInsert(NameTable *table, char *name, int value) {
+    int h;
+    if ((table->num + 1) * 2 > table->capacity)
+        growTable(table);
+    h = probe(table, name);
+    table->names[h] = name;
+    table->values[h] = value;
+    table->num++;
+}
+
+void nameTableClear(NameTable *table) {
+    if (table->num > 0)
+        memset(table->names, 0, table->capacity * sizeof(char *));
+    table->num = 0;
+}
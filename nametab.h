@@ -0,0 +1,27 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_NAMETAB_H
+#define TINY_NAMETAB_H
+
+/*名字表：把四元式中的名字映射为编号，优化和SSA的变量表使用。
+ * 开放地址散列，容量为2的幂，装填因子达到1/2时加倍，查找和插入的时间与名字的个数无关。
+ * 表中只保存名字的指针，名字由调用者保留*/
+typedef struct NameTableRec {
+    char **names;
+    int *values;
+    int capacity;
+    int num;
+} NameTable;
+
+/*名字对应的编号，不存在时返回-1*/
+int nameTableFind(NameTable *table, const char *name);
+
+/*加入不在表中的名字*/
+void nameTableInsert(NameTable *table, char *name, int value);
+
+/*清空，保留已分配的容量*/
+void nameTableClear(NameTable *table);
+
+#endif //TINY_NAMETAB_H
@@ -0,0 +1,1284 @@
+//
+// Created by liang on 2020/7/2.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "globals.h"
+#include "translate.h"
+#include "optimize.h"
+#include "cfg.h"
+#include "peephole.h"
+#include "ssa.h"
+#include "nametab.h"
+#include "trace.h"
+
+/*变量表，将四元式中出现的变量（包括临时变量）映射为连续的编号*/
+static THREAD_LOCAL NameTable varTable;
+static THREAD_LOCAL int varNum = 0;
+static THREAD_LOCAL char **varNames = NULL;/*编号对应的变量名*/
+static THREAD_LOCAL int varCapacity = 0;
+
+/*常量传播使用的格：未定义、常量、非常量*/
+typedef enum {
+    UNDEF, CONST, NAC
+} ValueKind;
+
+typedef struct {
+    ValueKind kind;
+    char *val;/*kind为CONST时的常量值*/
+} Value;
+
+/*查找变量的编号，insert为TRUE时不存在则插入*/
+static int varIndex(char *name, int insert) {
+    int index = nameTableFind(&varTable, name);
+    if (index >= 0 || !insert)
+        return index;
+    if (varNum == varCapacity) {
+        varCapacity = varCapacity == 0 ? 256 : varCapacity * 2;
+        varNames = (char **) realloc(varNames, varCapacity * sizeof(char *));
+    }
+    varNames[varNum] = name;
+    nameTableInsert(&varTable, name, varNum);
+    return varNum++;
+}
+
+/*编号为index的变量名*/
+static char *varTableName(int index) {
+    return varNames[index];
+}
+
+/*清空变量表*/
+static void clearVarTable(void) {
+    nameTableClear(&varTable);
+    varNum = 0;
+}
+
+/*收集四元式中出现的所有变量*/
+static void buildVarTable(void) {
+    int i;
+    Quadruple *q;
+    clearVarTable();
+    for (i = 0; i < curIndex; i++) {
+        q = &quadruples[i];
+        if (isVariable(q->arg1))
+            varIndex(q->arg1, TRUE);
+        if (isVariable(q->arg2))
+            varIndex(q->arg2, TRUE);
+        if (!isJump(q->operator) && isVariable(q->result))
+            varIndex(q->result, TRUE);
+    }
+}
+
+/*折叠算术运算，无法折叠时返回NULL。
+ * 按补码回绕计算，除数为0或结果溢出的除法留到运行时*/
+static char *foldArith(char *operator, char *arg1, char *arg2) {
+    int x, y;
+    if (!isNumber(arg1) || !isNumber(arg2))
+        return NULL;
+    x = atoi(arg1);
+    y = atoi(arg2);
+    if (strcmp(operator, "plus") == 0)
+        return intToChar((int) ((unsigned) x + (unsigned) y));
+    if (strcmp(operator, "minus") == 0)
+        return intToChar((int) ((unsigned) x - (unsigned) y));
+    if (strcmp(operator, "times") == 0)
+        return intToChar((int) ((unsigned) x * (unsigned) y));
+    if (y == 0 || (x == INT_MIN && y == -1))
+        return NULL;
+    return intToChar(x / y);
+}
+
+/*折叠关系跳转，条件成立返回1，不成立返回0，无法确定返回-1*/
+static int foldRelation(char *operator, char *arg1, char *arg2) {
+    int x, y;
+    char *rel = operator + 1;
+    if (isNumber(arg1) && isNumber(arg2)) {
+        x = atoi(arg1);
+        y = atoi(arg2);
+        if (strcmp(rel, "=") == 0)
+            return x == y;
+        if (strcmp(rel, "<") == 0)
+            return x < y;
+        if (strcmp(rel, ">") == 0)
+            return x > y;
+        if (strcmp(rel, "<=") == 0)
+            return x <= y;
+        if (strcmp(rel, ">=") == 0)
+            return x >= y;
+    } else if (strcmp(rel, "=") == 0 && isConstant(arg1) && isConstant(arg2))
+        return strcmp(arg1, arg2) == 0;
+    return -1;
+}
+
+/*将from合并到to上，to发生变化时返回TRUE*/
+static int meet(Value *to, Value from) {
+    if (from.kind == UNDEF || to->kind == NAC)
+        return FALSE;
+    if (to->kind == UNDEF) {
+        *to = from;
+        return TRUE;
+    }
+    if (from.kind == NAC || strcmp(to->val, from.val) != 0) {
+        to->kind = NAC;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*值编号表达式表的大小*/
+#define EXPR_SIZE 211
+
+/*值编号表达式表，记录支配者中已计算过的(操作符,操作数编号,操作数编号)*/
+typedef struct ExprListRec {
+    char *operator;
+    int vn1, vn2;
+    int vn;/*表达式的值编号*/
+    struct ExprListRec *next;
+} *ExprList;
+
+static THREAD_LOCAL ExprList exprTable[EXPR_SIZE];
+
+/*清空表达式表*/
+static void clearExprTable(void) {
+    int i;
+    ExprList l, temp;
+    for (i = 0; i < EXPR_SIZE; i++) {
+        l = exprTable[i];
+        while (l != NULL) {
+            temp = l;
+            l = l->next;
+            free(temp);
+        }
+        exprTable[i] = NULL;
+    }
+}
+
+/*在表达式表中查找(operator,vn1,vn2)，不存在时插入并返回-1，插入的链表下标存入*bucket，找到时*bucket不变*/
+static int lookupExpr(char *operator, int vn1, int vn2, int vn, int *bucket) {
+    int h = (int) (((unsigned) vn1 * 31u + (unsigned) vn2 * 17u + (unsigned char) operator[0]) % EXPR_SIZE);
+    ExprList l = exprTable[h];
+    while (l != NULL && !(l->vn1 == vn1 && l->vn2 == vn2 && strcmp(l->operator, operator) == 0))
+        l = l->next;
+    if (l != NULL)
+        return l->vn;
+    l = (ExprList) malloc(sizeof(struct ExprListRec));
+    l->operator = operator;
+    l->vn1 = vn1;
+    l->vn2 = vn2;
+    l->vn = vn;
+    l->next = exprTable[h];
+    exprTable[h] = l;
+    *bucket = h;
+    return -1;
+}
+
+/*SSA名字或常量操作数的值*/
+static Value nameValue(Value *values, int name, char *text) {
+    Value v;
+    v.kind = NAC;
+    v.val = NULL;
+    if (name >= 0)
+        return values[name];
+    if (isConstant(text)) {
+        v.kind = CONST;
+        v.val = text;
+    }
+    return v;
+}
+
+/*求第i条四元式定值的值*/
+static Value evaluate(SSA *ssa, Value *values, int i) {
+    Quadruple *q = &quadruples[i];
+    Value a, b, r;
+    char *folded;
+    r.kind = NAC;
+    r.val = NULL;
+    if (strcmp(q->operator, ":=") == 0)
+        return nameValue(values, ssa->use[3 * i], q->arg1);
+    if (isArith(q->operator)) {
+        a = nameValue(values, ssa->use[3 * i], q->arg1);
+        b = nameValue(values, ssa->use[3 * i + 1], q->arg2);
+        if (a.kind == UNDEF || b.kind == UNDEF)
+            r.kind = UNDEF;
+        else if (a.kind == CONST && b.kind == CONST && (folded = foldArith(q->operator, a.val, b.val)) != NULL) {
+            r.kind = CONST;
+            r.val = folded;
+        }
+    }
+    return r;
+}
+
+/*稀疏条件常量传播使用的状态*/
+static THREAD_LOCAL Value *values;/*每个SSA名字的值*/
+static THREAD_LOCAL int *edgeExec;/*CFG的边是否可能执行，下标为边在predArray中的位置*/
+static THREAD_LOCAL int *edgeBlock;/*边的终点*/
+static THREAD_LOCAL int *blockExec;
+static THREAD_LOCAL int *edgeWork, edgeTop;
+static THREAD_LOCAL int *nameWork, nameTop;
+
+/*边b->s在predArray中的位置*/
+static int edgeIndex(CFG *cfg, int b, int s) {
+    int k;
+    for (k = 0; k < cfg->blocks[s].predNum; k++)
+        if (cfg->blocks[s].pred[k] == b)
+            return (int) (cfg->blocks[s].pred - cfg->predArray) + k;
+    return -1;
+}
+
+static void markEdge(CFG *cfg, int b, int s) {
+    int e = edgeIndex(cfg, b, s);
+    if (e >= 0 && !edgeExec[e]) {
+        edgeExec[e] = TRUE;
+        edgeWork[edgeTop++] = e;
+    }
+}
+
+static void lowerName(int name, Value v) {
+    if (meet(&values[name], v))
+        nameWork[nameTop++] = name;
+}
+
+/*φ的值为所有可能执行的入边上参数的值的合并*/
+static void visitPhi(SSA *ssa, int f) {
+    CFG *cfg = ssa->cfg;
+    Phi *phi = &ssa->phis[f];
+    BasicBlock *block = &cfg->blocks[phi->block];
+    int k, offset = (int) (block->pred - cfg->predArray);
+    Value r;
+    r.kind = UNDEF;
+    r.val = NULL;
+    for (k = 0; k < block->predNum; k++)
+        if (edgeExec[offset + k] && phi->args[k] >= 0)
+            meet(&r, values[phi->args[k]]);
+    if (phi->block == 0)
+        meet(&r, values[phi->args[block->predNum]]);
+    lowerName(phi->name, r);
+}
+
+/*求四元式定值的值，条件跳转按操作数的值决定可能执行的出边*/
+static void visitQuadruple(SSA *ssa, int i) {
+    CFG *cfg = ssa->cfg;
+    Quadruple *q = &quadruples[i];
+    int b = cfg->blockOf[i], k, rel;
+    Value a, c;
+    if (ssa->def[i] >= 0)
+        lowerName(ssa->def[i], evaluate(ssa, values, i));
+    else if (isCondJump(q->operator)) {
+        a = nameValue(values, ssa->use[3 * i], q->arg1);
+        c = nameValue(values, ssa->use[3 * i + 1], q->arg2);
+        if (a.kind == UNDEF || c.kind == UNDEF)
+            return;
+        rel = a.kind == CONST && c.kind == CONST ? foldRelation(q->operator, a.val, c.val) : -1;
+        if (rel == 1)
+            markEdge(cfg, b, cfg->blockOf[atoi(q->result)]);
+        else if (rel == 0)
+            markEdge(cfg, b, b + 1);
+        else
+            for (k = 0; k < cfg->blocks[b].succNum; k++)
+                markEdge(cfg, b, cfg->blocks[b].succ[k]);
+    }
+}
+
+/*块第一次可能执行时求其中所有φ和四元式的值*/
+static void visitBlock(SSA *ssa, int b) {
+    CFG *cfg = ssa->cfg;
+    int i, f, k;
+    blockExec[b] = TRUE;
+    for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++)
+        visitPhi(ssa, f);
+    for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+        visitQuadruple(ssa, i);
+    if (!isCondJump(quadruples[cfg->blocks[b].end - 1].operator))
+        for (k = 0; k < cfg->blocks[b].succNum; k++)
+            markEdge(cfg, b, cfg->blocks[b].succ[k]);
+}
+
+/*稀疏条件常量传播（Wegman-Zadeck）：CFG边和SSA定值-使用边两个工作表，
+ * 每个名字的值最多下降两次，每条边只加入一次，时间与SSA形式的大小成线性。
+ * 之后把值为常量的使用替换为常量，结果确定的条件跳转改为无条件跳转或删除，
+ * 删除不会执行的块*/
+static void sparseConstantPropagation(SSA *ssa) {
+    CFG *cfg = ssa->cfg;
+    int n = curIndex, nb = cfg->blockNum, edgeNum = 0;
+    int i, k, b, f, x, site, target, taken, fall;
+    int *sites, *siteStart;
+    Quadruple *q;
+
+    for (b = 0; b < nb; b++)
+        edgeNum += cfg->blocks[b].predNum;
+    values = (Value *) calloc(ssa->nameNum + 1, sizeof(Value));
+    edgeExec = (int *) calloc(edgeNum + 1, sizeof(int));
+    edgeBlock = (int *) malloc((edgeNum + 1) * sizeof(int));
+    blockExec = (int *) calloc(nb + 1, sizeof(int));
+    edgeWork = (int *) malloc((edgeNum + 1) * sizeof(int));
+    nameWork = (int *) malloc((2 * ssa->nameNum + 1) * sizeof(int));
+    for (b = 0; b < nb; b++)
+        for (k = 0; k < cfg->blocks[b].predNum; k++)
+            edgeBlock[cfg->blocks[b].pred - cfg->predArray + k] = b;
+    /*程序入口处变量的值未知*/
+    for (x = 0; x < ssa->nameNum; x++)
+        values[x].kind = ssa->nameDef[x] == -1 ? NAC : UNDEF;
+
+    sites = ssaUses(ssa, &siteStart);
+
+    edgeTop = 0;
+    nameTop = 0;
+    if (nb > 0)
+        visitBlock(ssa, 0);
+    while (edgeTop > 0 || nameTop > 0) {
+        while (edgeTop > 0) {
+            b = edgeBlock[edgeWork[--edgeTop]];
+            if (!blockExec[b])
+                visitBlock(ssa, b);
+            else
+                for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++)
+                    visitPhi(ssa, f);
+        }
+        while (nameTop > 0) {
+            x = nameWork[--nameTop];
+            for (k = siteStart[x]; k < siteStart[x + 1]; k++) {
+                site = sites[k];
+                if (site >= 0) {
+                    if (blockExec[cfg->blockOf[site]])
+                        visitQuadruple(ssa, site);
+                } else if (blockExec[ssa->phis[-1 - site].block])
+                    visitPhi(ssa, -1 - site);
+            }
+        }
+    }
+
+    /*按求得的值改写*/
+    for (b = 0; b < nb; b++) {
+        if (!blockExec[b]) {
+            ssa->executable[b] = FALSE;
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+                ssa->removed[i] = ssa->removed[i] || i != n - 1;
+            continue;
+        }
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+            q = &quadruples[i];
+            if (ssa->removed[i])
+                continue;
+            for (k = 0; k < 3; k++) {
+                x = ssa->use[3 * i + k];
+                if (x < 0 || values[x].kind != CONST)
+                    continue;
+                if (k == 0)
+                    q->arg1 = values[x].val;
+                else if (k == 1)
+                    q->arg2 = values[x].val;
+                else
+                    q->result = values[x].val;
+                ssa->use[3 * i + k] = -1;
+            }
+            if (ssa->def[i] >= 0 && values[ssa->def[i]].kind == CONST) {
+                q->operator = ":=";
+                q->arg1 = values[ssa->def[i]].val;
+                q->arg2 = NULL;
+                ssa->use[3 * i] = -1;
+                ssa->use[3 * i + 1] = -1;
+            } else if (isCondJump(q->operator)) {
+                target = cfg->blockOf[atoi(q->result)];
+                if (target == b + 1)
+                    continue;
+                taken = edgeExec[edgeIndex(cfg, b, target)];
+                fall = b + 1 < nb && edgeExec[edgeIndex(cfg, b, b + 1)];
+                if (taken && !fall) {
+                    q->operator = "j";
+                    q->arg1 = NULL;
+                    q->arg2 = NULL;
+                    ssa->use[3 * i] = -1;
+                    ssa->use[3 * i + 1] = -1;
+                } else if (!taken && fall)
+                    ssa->removed[i] = TRUE;
+            }
+        }
+    }
+    free(siteStart);
+    free(sites);
+    free(nameWork);
+    free(edgeWork);
+    free(blockExec);
+    free(edgeBlock);
+    free(edgeExec);
+    free(values);
+}
+
+/*名字x的定值可以在结果不被使用时删除。不可执行的块中的定值不参加计数，也不删除*/
+static int removableDef(SSA *ssa, int x) {
+    int i = ssa->nameDef[x];
+    if (i <= -2)
+        return !ssa->phis[-2 - i].removed && ssa->executable[ssa->phis[-2 - i].block];
+    if (i < 0 || ssa->removed[i] || !ssa->executable[ssa->cfg->blockOf[i]])
+        return FALSE;
+    return strcmp(quadruples[i].operator, ":=") == 0 || isArith(quadruples[i].operator);
+}
+
+/*稀疏死代码删除：结果不被使用的复制、算术运算和φ被删除，
+ * 其操作数的使用计数随之减少，计数变为0的定值继续删除*/
+static void deadCodeElimination(SSA *ssa) {
+    CFG *cfg = ssa->cfg;
+    int i, k, b, f, x, u, top = 0, argNum;
+    int *count = (int *) calloc(ssa->nameNum + 1, sizeof(int));
+    int *stack = (int *) malloc((ssa->nameNum + 1) * sizeof(int));
+    Phi *phi;
+    for (b = 0; b < cfg->blockNum; b++) {
+        if (!ssa->executable[b])
+            continue;
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            for (k = 0; k < 3 && !ssa->removed[i]; k++)
+                if ((u = ssa->use[3 * i + k]) >= 0)
+                    count[u]++;
+        for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++) {
+            argNum = cfg->blocks[b].predNum + (b == 0);
+            for (k = 0; k < argNum; k++)
+                if ((u = ssa->phis[f].args[k]) >= 0)
+                    count[u]++;
+        }
+    }
+    for (x = 0; x < ssa->nameNum; x++)
+        if (count[x] == 0 && removableDef(ssa, x))
+            stack[top++] = x;
+    while (top > 0) {
+        x = stack[--top];
+        if (!removableDef(ssa, x))
+            continue;
+        i = ssa->nameDef[x];
+        if (i <= -2) {
+            phi = &ssa->phis[-2 - i];
+            phi->removed = TRUE;
+            argNum = cfg->blocks[phi->block].predNum + (phi->block == 0);
+            for (k = 0; k < argNum; k++)
+                if ((u = phi->args[k]) >= 0 && --count[u] == 0)
+                    stack[top++] = u;
+        } else {
+            ssa->removed[i] = TRUE;
+            for (k = 0; k < 3; k++)
+                if ((u = ssa->use[3 * i + k]) >= 0 && --count[u] == 0)
+                    stack[top++] = u;
+        }
+    }
+    free(stack);
+    free(count);
+}
+
+/*全局值编号的操作数编号：名字用其代表名字，常量排在所有名字之后*/
+static int operandKey(SSA *ssa, int *leader, int name, char *text) {
+    if (name >= 0)
+        return leader[name];
+    return ssa->nameNum + varIndex(text, TRUE);
+}
+
+/*基于支配树的全局值编号：沿支配树先序遍历，表达式表随子树进出，
+ * 支配者中已计算过的表达式改为复制其结果；复制和参数相同的φ使名字与来源同值，
+ * 四元式中对名字的使用都改为使用代表名字（支配它的最早的同值名字）。
+ * φ的参数保持不变，使流入φ的复制留在原处，离开SSA形式时不必在边上复制*/
+static void globalValueNumbering(SSA *ssa) {
+    CFG *cfg = ssa->cfg;
+    int nb = cfg->blockNum;
+    int b, c, i, k, j, f, x, u, l, same, k1, k2, vn, bucket, top = 0, scopeTop = 0, argNum;
+    int *leader = (int *) malloc((ssa->nameNum + 1) * sizeof(int));
+    int *stack = (int *) malloc((nb + 1) * sizeof(int));
+    int *next = (int *) malloc((nb + 1) * sizeof(int));
+    int *scope = (int *) malloc((curIndex + 1) * sizeof(int));/*插入表达式表的链表下标*/
+    int *scopeMark = (int *) malloc((nb + 1) * sizeof(int));
+    ExprList e;
+    Quadruple *q;
+    Phi *phi;
+
+    for (x = 0; x < ssa->nameNum; x++)
+        leader[x] = x;
+    clearVarTable();
+    clearExprTable();
+    if (nb > 0) {
+        stack[top++] = 0;
+        next[0] = -1;
+    }
+    while (top > 0) {
+        b = stack[top - 1];
+        if (next[b] == -1) {
+            next[b] = ssa->domChildStart[b];
+            scopeMark[b] = scopeTop;
+            /*参数（不计自身）都相同的φ与该参数同值*/
+            argNum = cfg->blocks[b].predNum + (b == 0);
+            for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++) {
+                phi = &ssa->phis[f];
+                if (phi->removed)
+                    continue;
+                l = -1;
+                same = TRUE;
+                for (k = 0; k < argNum && same; k++) {
+                    if (phi->args[k] < 0 || leader[phi->args[k]] == phi->name ||
+                        (k < cfg->blocks[b].predNum && !ssaEdgeLive(ssa, cfg->blocks[b].pred[k], b)))
+                        continue;
+                    if (l == -1)
+                        l = leader[phi->args[k]];
+                    else
+                        same = l == leader[phi->args[k]];
+                }
+                if (same && l >= 0)
+                    leader[phi->name] = l;
+            }
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+                q = &quadruples[i];
+                if (ssa->removed[i])
+                    continue;
+                for (k = 0; k < 3; k++)
+                    if (ssa->use[3 * i + k] >= 0)
+                        ssa->use[3 * i + k] = leader[ssa->use[3 * i + k]];
+                if ((x = ssa->def[i]) < 0)
+                    continue;
+                if (strcmp(q->operator, ":=") == 0) {
+                    /*临时变量复制给用户变量时保留用户变量，以便窥孔优化合并这条复制*/
+                    u = ssa->use[3 * i];
+                    if (u >= 0 && !(isTemp(ssa->varNames[ssa->nameVar[u]]) &&
+                                    !isTemp(ssa->varNames[ssa->nameVar[x]])))
+                        leader[x] = u;
+                }
+                else if (isArith(q->operator)) {
+                    k1 = operandKey(ssa, leader, ssa->use[3 * i], q->arg1);
+                    k2 = operandKey(ssa, leader, ssa->use[3 * i + 1], q->arg2);
+                    if ((strcmp(q->operator, "plus") == 0 || strcmp(q->operator, "times") == 0) && k1 > k2) {
+                        j = k1;
+                        k1 = k2;
+                        k2 = j;
+                    }
+                    bucket = -1;
+                    vn = lookupExpr(q->operator, k1, k2, x, &bucket);
+                    if (bucket >= 0)/*新插入的表达式在离开子树时撤销*/
+                        scope[scopeTop++] = bucket;
+                    if (vn >= 0) {
+                        /*表达式已由支配者计算过，改为复制*/
+                        leader[x] = vn;
+                        q->operator = ":=";
+                        q->arg2 = NULL;
+                        ssa->use[3 * i] = vn;
+                        ssa->use[3 * i + 1] = -1;
+                    }
+                }
+            }
+        }
+        if (next[b] < ssa->domChildStart[b + 1]) {
+            c = ssa->domChildren[next[b]++];
+            next[c] = -1;
+            stack[top++] = c;
+        } else {
+            /*离开子树时撤销其中加入的表达式*/
+            while (scopeTop > scopeMark[b]) {
+                bucket = scope[--scopeTop];
+                e = exprTable[bucket];
+                exprTable[bucket] = e->next;
+                free(e);
+            }
+            top--;
+        }
+    }
+    free(scopeMark);
+    free(scope);
+    free(next);
+    free(stack);
+    free(leader);
+    clearVarTable();
+}
+
+/*在SSA形式上执行稀疏的全局优化*/
+void ssaOptimize(void) {
+    SSA *ssa = buildSSA(buildCFG());
+    sparseConstantPropagation(ssa);
+    globalValueNumbering(ssa);
+    deadCodeElimination(ssa);
+    if (TRACING(TRACE_OPT, 1)) {
+        fprintf(listing, "\nSSA form:\n");
+        printSSA(ssa, listing);
+    }
+    destroySSA(ssa);
+}
+
+/*标记从入口不可达的四元式（保留最后的HALT），返回标记的个数*/
+static int markUnreachable(int *removed) {
+    int n = curIndex, top = 0, i, target, count = 0;
+    char *reached = (char *) calloc(n + 1, sizeof(char));
+    int *stack = (int *) malloc((n + 1) * sizeof(int));
+    if (n > 0) {
+        reached[0] = TRUE;
+        stack[top++] = 0;
+    }
+    while (top > 0) {
+        i = stack[--top];
+        if (isJump(quadruples[i].operator)) {
+            target = atoi(quadruples[i].result);
+            if (target >= 0 && target < n && !reached[target]) {
+                reached[target] = TRUE;
+                stack[top++] = target;
+            }
+            if (strcmp(quadruples[i].operator, "j") == 0)
+                continue;
+        } else if (strcmp(quadruples[i].operator, "HALT") == 0)
+            continue;
+        if (i + 1 < n && !reached[i + 1]) {
+            reached[i + 1] = TRUE;
+            stack[top++] = i + 1;
+        }
+    }
+    for (i = 0; i < n - 1; i++)
+        if (!reached[i] && !removed[i]) {
+            removed[i] = TRUE;
+            count++;
+        }
+    free(stack);
+    free(reached);
+    return count;
+}
+
+/*求从第i条四元式开始沿无条件跳转链最终到达的位置，
+ * dest记录已求出的结果（-1未求，-2正在求，用于发现跳转环）*/
+static int finalTarget(int i, int *dest) {
+    int j = i, k, next;
+    /*沿链前进直到遇到非无条件跳转、已求出的位置或环*/
+    while (dest[j] == -1 && strcmp(quadruples[j].operator, "j") == 0) {
+        next = atoi(quadruples[j].result);
+        if (next < 0 || next >= curIndex)
+            break;
+        dest[j] = -2;
+        j = next;
+    }
+    if (dest[j] >= 0)
+        k = dest[j];
+    else if (dest[j] == -2)
+        k = j;/*跳转环，停在环上*/
+    else {
+        k = j;
+        dest[j] = j;
+    }
+    /*路径压缩*/
+    for (j = i; dest[j] == -2; j = atoi(quadruples[j].result))
+        dest[j] = k;
+    return k;
+}
+
+/*跳转线程化：跳转到无条件跳转的跳转直接改为跳转到最终目标，
+ * 删除跳转到下一条四元式的跳转和因此不可达的四元式，重复直到没有变化*/
+void jumpThreading(void) {
+    int i, target, changed;
+    int *dest, *removed;
+    Quadruple *q;
+    do {
+        changed = FALSE;
+        dest = (int *) malloc((curIndex + 1) * sizeof(int));
+        removed = (int *) calloc(curIndex + 1, sizeof(int));
+        for (i = 0; i < curIndex; i++)
+            dest[i] = -1;
+        for (i = 0; i < curIndex; i++) {
+            q = &quadruples[i];
+            if (!isJump(q->operator))
+                continue;
+            target = atoi(q->result);
+            if (target < 0 || target >= curIndex)
+                continue;
+            target = finalTarget(target, dest);
+            if (target != atoi(q->result)) {
+                q->result = intToChar(target);
+                changed = TRUE;
+            }
+        }
+        for (i = 0; i < curIndex; i++) {
+            q = &quadruples[i];
+            /*条件跳转的操作数没有副作用，跳转到下一条时两个出口相同*/
+            if (isJump(q->operator) && atoi(q->result) == i + 1) {
+                removed[i] = TRUE;
+                changed = TRUE;
+            }
+        }
+        if (markUnreachable(removed) > 0)
+            changed = TRUE;
+        removeQuadruples(removed);
+        free(removed);
+        free(dest);
+    } while (changed);
+}
+
+/*合并复制：op a,b,t之后紧跟:= t,_,x且t只在此处使用时，
+ * 改为op a,b,x并删除复制，两条四元式必须在同一基本块中*/
+static void coalesceCopies(void) {
+    int i, v;
+    int *uses, *removed;
+    Quadruple *q, *next;
+    CFG *cfg = buildCFG();
+    buildVarTable();
+    uses = (int *) calloc(varNum + 1, sizeof(int));
+    removed = (int *) calloc(curIndex + 1, sizeof(int));
+    for (i = 0; i < curIndex; i++) {
+        q = &quadruples[i];
+        if (isVariable(q->arg1))
+            uses[varIndex(q->arg1, FALSE)]++;
+        if (isVariable(q->arg2))
+            uses[varIndex(q->arg2, FALSE)]++;
+        if (strcmp(q->operator, "OUT") == 0 && isVariable(q->result))
+            uses[varIndex(q->result, FALSE)]++;
+    }
+    for (i = 0; i + 1 < curIndex; i++) {
+        q = &quadruples[i];
+        next = &quadruples[i + 1];
+        if (removed[i] || cfg->blockOf[i] != cfg->blockOf[i + 1])
+            continue;
+        if (!(isArith(q->operator) || strcmp(q->operator, ":=") == 0) || !isTemp(q->result))
+            continue;
+        if (strcmp(next->operator, ":=") != 0 || next->arg1 == NULL || strcmp(next->arg1, q->result) != 0)
+            continue;
+        v = varIndex(q->result, FALSE);
+        if (uses[v] != 1)
+            continue;
+        q->result = next->result;
+        removed[i + 1] = TRUE;
+    }
+    removeQuadruples(removed);
+    free(removed);
+    free(uses);
+    freeCFG(cfg);
+    clearVarTable();
+}
+
+/*线性扫描使用的以区间终点为键的最小堆*/
+static void heapPush(int *heap, int *size, int t, int *end) {
+    int i = (*size)++, p;
+    while (i > 0 && end[heap[p = (i - 1) / 2]] > end[t]) {
+        heap[i] = heap[p];
+        i = p;
+    }
+    heap[i] = t;
+}
+
+static int heapPop(int *heap, int *size, int *end) {
+    int top = heap[0], t = heap[--(*size)], i = 0, c;
+    while ((c = 2 * i + 1) < *size) {
+        if (c + 1 < *size && end[heap[c + 1]] < end[heap[c]])
+            c++;
+        if (end[heap[c]] >= end[t])
+            break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    if (*size > 0)
+        heap[i] = t;
+    return top;
+}
+
+/*临时变量分配：合并复制后用活跃分析求每个临时变量的活跃区间，
+ * 再按线性扫描为区间分配槽位，互不重叠的临时变量共享同一个名字。
+ * 只在一个基本块内先定值后使用的临时变量直接取其出现的范围，
+ * 其余临时变量按基本块做活跃分析（位向量）*/
+void allocateTemps(void) {
+    int i, b, k, t, v, w, changed, tempNum, globalNum, words, slot, slotNum;
+    int activeNum, freeNum, occurrence;
+    int *tempOf, *blockOf, *globalOf, *start, *end, *order, *bucket;
+    int *active, *freeSlots, *slotOf;
+    unsigned long *use, *def, *in, *out, bit, old;
+    char **slotName, *operand[3], name[sizeof(TEMP_PREFIX) + 11];
+    Quadruple *q;
+    CFG *cfg;
+
+    coalesceCopies();
+    cfg = buildCFG();
+    buildVarTable();
+    /*为临时变量编号，并判断是否只在一个基本块内先定值后使用*/
+    tempOf = (int *) malloc((varNum + 1) * sizeof(int));
+    for (v = 0; v < varNum; v++)
+        tempOf[v] = -1;
+    tempNum = 0;
+    for (v = 0; v < varNum; v++)
+        if (isTemp(varTableName(v)))
+            tempOf[v] = tempNum++;
+    blockOf = (int *) malloc((tempNum + 1) * sizeof(int));
+    globalOf = (int *) malloc((tempNum + 1) * sizeof(int));
+    start = (int *) malloc((tempNum + 1) * sizeof(int));
+    end = (int *) malloc((tempNum + 1) * sizeof(int));
+    for (t = 0; t < tempNum; t++) {
+        blockOf[t] = -1;
+        globalOf[t] = -1;
+        start[t] = curIndex;
+        end[t] = -1;
+    }
+    globalNum = 0;
+    for (i = 0; i < curIndex; i++) {
+        q = &quadruples[i];
+        operand[0] = q->arg1;
+        operand[1] = q->arg2;
+        operand[2] = isJump(q->operator) ? NULL : q->result;
+        for (k = 0; k < 3; k++) {
+            if (!isTemp(operand[k]))
+                continue;
+            t = tempOf[varIndex(operand[k], FALSE)];
+            if (start[t] > i)
+                start[t] = i;
+            if (end[t] < i)
+                end[t] = i;
+            /*首次出现是使用或出现在多个块中的临时变量需要做活跃分析*/
+            occurrence = k == 2 && strcmp(q->operator, "OUT") != 0;
+            if (blockOf[t] == -1 && !occurrence)
+                blockOf[t] = -2;
+            if (blockOf[t] == -1)
+                blockOf[t] = cfg->blockOf[i];
+            else if (blockOf[t] != cfg->blockOf[i] && globalOf[t] == -1)
+                globalOf[t] = globalNum++;
+            if (blockOf[t] == -2 && globalOf[t] == -1)
+                globalOf[t] = globalNum++;
+        }
+    }
+
+    /*对跨块的临时变量做活跃分析*/
+    words = (globalNum + 63) / 64;
+    use = (unsigned long *) calloc((size_t) cfg->blockNum * words + 1, sizeof(unsigned long));
+    def = (unsigned long *) calloc((size_t) cfg->blockNum * words + 1, sizeof(unsigned long));
+    in = (unsigned long *) calloc((size_t) cfg->blockNum * words + 1, sizeof(unsigned long));
+    out = (unsigned long *) calloc((size_t) cfg->blockNum * words + 1, sizeof(unsigned long));
+    if (globalNum > 0) {
+        for (b = 0; b < cfg->blockNum; b++)
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+                q = &quadruples[i];
+                operand[0] = q->arg1;
+                operand[1] = q->arg2;
+                operand[2] = strcmp(q->operator, "OUT") == 0 ? q->result : NULL;
+                for (k = 0; k < 3; k++)
+                    if (isTemp(operand[k]) && (t = globalOf[tempOf[varIndex(operand[k], FALSE)]]) >= 0) {
+                        bit = 1UL << (t % 64);
+                        if (!(def[(size_t) b * words + t / 64] & bit))
+                            use[(size_t) b * words + t / 64] |= bit;
+                    }
+                if (!isJump(q->operator) && strcmp(q->operator, "OUT") != 0 && isTemp(q->result) &&
+                    (t = globalOf[tempOf[varIndex(q->result, FALSE)]]) >= 0)
+                    def[(size_t) b * words + t / 64] |= 1UL << (t % 64);
+            }
+        do {
+            changed = FALSE;
+            for (k = cfg->rpoNum - 1; k >= 0; k--) {
+                b = cfg->rpo[k];
+                for (w = 0; w < words; w++) {
+                    old = out[(size_t) b * words + w];
+                    bit = 0;
+                    for (i = 0; i < cfg->blocks[b].succNum; i++)
+                        bit |= in[(size_t) cfg->blocks[b].succ[i] * words + w];
+                    out[(size_t) b * words + w] = bit;
+                    in[(size_t) b * words + w] = use[(size_t) b * words + w] |
+                                                 (bit & ~def[(size_t) b * words + w]);
+                    if (bit != old)
+                        changed = TRUE;
+                }
+            }
+        } while (changed);
+        /*活跃区间覆盖活跃的块入口和出口*/
+        for (t = 0; t < tempNum; t++) {
+            if ((k = globalOf[t]) < 0)
+                continue;
+            bit = 1UL << (k % 64);
+            for (b = 0; b < cfg->blockNum; b++) {
+                if (in[(size_t) b * words + k / 64] & bit && start[t] > cfg->blocks[b].start)
+                    start[t] = cfg->blocks[b].start;
+                if (out[(size_t) b * words + k / 64] & bit && end[t] < cfg->blocks[b].end - 1)
+                    end[t] = cfg->blocks[b].end - 1;
+            }
+        }
+    }
+
+    /*按区间起点做计数排序*/
+    bucket = (int *) calloc(curIndex + 2, sizeof(int));
+    order = (int *) malloc((tempNum + 1) * sizeof(int));
+    for (t = 0; t < tempNum; t++)
+        bucket[start[t] + 1]++;
+    for (i = 0; i < curIndex; i++)
+        bucket[i + 1] += bucket[i];
+    for (t = 0; t < tempNum; t++)
+        order[bucket[start[t]]++] = t;
+
+    /*线性扫描：区间终点不晚于当前起点的槽位可以复用，
+     * 同一条四元式先读操作数再写结果，所以终点等于起点时也可复用*/
+    active = (int *) malloc((tempNum + 1) * sizeof(int));
+    freeSlots = (int *) malloc((tempNum + 1) * sizeof(int));
+    slotOf = (int *) malloc((tempNum + 1) * sizeof(int));
+    activeNum = 0;
+    freeNum = 0;
+    slotNum = 0;
+    for (k = 0; k < tempNum; k++) {
+        t = order[k];
+        while (activeNum > 0 && end[active[0]] <= start[t])
+            freeSlots[freeNum++] = slotOf[heapPop(active, &activeNum, end)];
+        slotOf[t] = freeNum > 0 ? freeSlots[--freeNum] : slotNum++;
+        heapPush(active, &activeNum, t, end);
+    }
+
+    /*按槽位重命名临时变量*/
+    slotName = (char **) malloc((slotNum + 1) * sizeof(char *));
+    for (slot = 0; slot < slotNum; slot++) {
+        sprintf(name, TEMP_PREFIX "%d", slot);
+        slotName[slot] = poolString(name);
+    }
+    for (i = 0; i < curIndex; i++) {
+        q = &quadruples[i];
+        if (isTemp(q->arg1))
+            q->arg1 = slotName[slotOf[tempOf[varIndex(q->arg1, FALSE)]]];
+        if (isTemp(q->arg2))
+            q->arg2 = slotName[slotOf[tempOf[varIndex(q->arg2, FALSE)]]];
+        if (!isJump(q->operator) && isTemp(q->result))
+            q->result = slotName[slotOf[tempOf[varIndex(q->result, FALSE)]]];
+    }
+
+    free(slotName);
+    free(slotOf);
+    free(freeSlots);
+    free(active);
+    free(order);
+    free(bucket);
+    free(out);
+    free(in);
+    free(def);
+    free(use);
+    free(end);
+    free(start);
+    free(globalOf);
+    free(blockOf);
+    free(tempOf);
+    freeCFG(cfg);
+    clearVarTable();
+}
+
+/*循环优化中插入的四元式，before为TRUE时放在at之前（作为前置块），否则放在at之后*/
+typedef struct {
+    int at;
+    int before;
+    int loop;/*前置块所属的循环*/
+    Quadruple quad;
+} Insertion;
+
+static THREAD_LOCAL Insertion *insertions;
+static THREAD_LOCAL int insertionNum;
+static THREAD_LOCAL int insertionCapacity;
+
+static void addInsertion(int at, int before, int loop, char *operator, char *arg1, char *arg2, char *result) {
+    Insertion *ins;
+    if (insertionNum == insertionCapacity) {
+        insertionCapacity = insertionCapacity == 0 ? 16 : insertionCapacity * 2;
+        insertions = (Insertion *) realloc(insertions, insertionCapacity * sizeof(Insertion));
+    }
+    ins = &insertions[insertionNum++];
+    ins->at = at;
+    ins->before = before;
+    ins->loop = loop;
+    ins->quad.operator = operator;
+    ins->quad.arg1 = arg1;
+    ins->quad.arg2 = arg2;
+    ins->quad.result = result;
+    ins->quad.lineno = at >= 0 && at < curIndex ? quadruples[at].lineno : 0;
+}
+
+/*按插入记录和删除标记重建四元式数组。跳转到带前置块的循环header时，
+ * 来自循环外的跳转改为跳到前置块，来自循环内（loopOfBlock相同）的跳转仍跳到header*/
+static void applyInsertions(CFG *cfg, int *removed, int *loopOfBlock) {
+    int n = curIndex, total = curIndex + insertionNum;
+    int i, k, pos, target, loop;
+    int *bucket = (int *) calloc(n + 2, sizeof(int));
+    int *order = (int *) malloc((insertionNum + 1) * sizeof(int));
+    int *newPos = (int *) malloc((n + 1) * sizeof(int));
+    int *preStart = (int *) malloc((n + 1) * sizeof(int));
+    int *preLoop = (int *) malloc((n + 1) * sizeof(int));
+    int *fromOld = (int *) malloc((total + 1) * sizeof(int));/*新位置上的原四元式，插入的为-1*/
+    Quadruple *result = (Quadruple *) malloc((total + 1) * sizeof(Quadruple));
+    /*按位置稳定排序插入记录*/
+    for (k = 0; k < insertionNum; k++)
+        bucket[insertions[k].at + 1]++;
+    for (i = 0; i < n; i++)
+        bucket[i + 1] += bucket[i];
+    for (k = 0; k < insertionNum; k++)
+        order[bucket[insertions[k].at]++] = k;
+    pos = 0;
+    for (i = 0, k = 0; i < n; i++) {
+        preStart[i] = pos;
+        preLoop[i] = -1;
+        for (; k < insertionNum && insertions[order[k]].at == i && insertions[order[k]].before; k++) {
+            preLoop[i] = insertions[order[k]].loop;
+            fromOld[pos] = -1;
+            result[pos++] = insertions[order[k]].quad;
+        }
+        newPos[i] = pos;
+        if (!removed[i]) {
+            fromOld[pos] = i;
+            result[pos++] = quadruples[i];
+        }
+        for (; k < insertionNum && insertions[order[k]].at == i; k++) {
+            fromOld[pos] = -1;
+            result[pos++] = insertions[order[k]].quad;
+        }
+    }
+    newPos[n] = pos;
+    preStart[n] = pos;
+    /*修正跳转目标*/
+    for (i = 0; i < pos; i++) {
+        if (fromOld[i] < 0 || !isJump(result[i].operator))
+            continue;
+        target = atoi(result[i].result);
+        if (target < 0 || target > n)
+            continue;
+        loop = preLoop[target];
+        if (loop >= 0 && loopOfBlock[cfg->blockOf[fromOld[i]]] != loop)
+            result[i].result = intToChar(preStart[target]);
+        else
+            result[i].result = intToChar(newPos[target]);
+    }
+    reserveQuadruples(pos);
+    memcpy(quadruples, result, pos * sizeof(Quadruple));
+    curIndex = pos;
+    free(result);
+    free(fromOld);
+    free(preLoop);
+    free(preStart);
+    free(newPos);
+    free(order);
+    free(bucket);
+}
+
+/*按循环体大小升序比较，内层循环在前*/
+static THREAD_LOCAL CFG *sortingCFG;
+
+static int compareLoopSize(const void *a, const void *b) {
+    return sortingCFG->loops[*(const int *) a].blockNum - sortingCFG->loops[*(const int *) b].blockNum;
+}
+
+/*归纳变量的步长：数值常量或在当前循环中没有定值的变量*/
+static int isLoopStep(char *s, int *defCount) {
+    int v;
+    if (isNumber(s))
+        return TRUE;
+    return isVariable(s) && (v = varIndex(s, FALSE)) >= 0 && defCount[v] == 0;
+}
+
+/*循环不变量外提与归纳变量强度削弱，一轮只处理互不嵌套的循环，
+ * 外提到内层循环前置块中的四元式在下一轮还可以继续外提到外层循环之外*/
+static int loopRound(void) {
+    CFG *cfg = buildCFG();
+    int l, k, b, i, j, v, t, u, changed, loopChanged, count, header, exitDominated, ok;
+    int *sorted, *loopOfBlock, *defCount, *defAt, *invariant, *removed, *exitBlocks, exitNum;
+    char *iv, *factor, *delta, *s, *d, **operand;
+    Quadruple *q;
+    Loop *loop;
+
+    buildVarTable();
+    loopOfBlock = (int *) malloc((cfg->blockNum + 1) * sizeof(int));
+    for (b = 0; b < cfg->blockNum; b++)
+        loopOfBlock[b] = -1;
+    sorted = (int *) malloc((cfg->loopNum + 1) * sizeof(int));
+    for (l = 0; l < cfg->loopNum; l++)
+        sorted[l] = l;
+    sortingCFG = cfg;
+    qsort(sorted, cfg->loopNum, sizeof(int), compareLoopSize);
+    defCount = (int *) calloc(varNum + 1, sizeof(int));
+    defAt = (int *) malloc((varNum + 1) * sizeof(int));
+    invariant = (int *) calloc(curIndex + 1, sizeof(int));
+    removed = (int *) calloc(curIndex + 1, sizeof(int));
+    exitBlocks = (int *) malloc((cfg->blockNum + 1) * sizeof(int));
+    insertionNum = 0;
+    changed = FALSE;
+
+    for (k = 0; k < cfg->loopNum; k++) {
+        loop = &cfg->loops[sorted[k]];
+        header = cfg->blocks[loop->header].start;
+        /*与已处理的循环有重叠时留到下一轮*/
+        ok = TRUE;
+        for (j = 0; j < loop->blockNum; j++)
+            if (loopOfBlock[loop->blocks[j]] != -1)
+                ok = FALSE;
+        /*header之前的四元式在循环内且会顺序执行到header时无法放置前置块*/
+        if (header > 0 && !isJump(quadruples[header - 1].operator) &&
+            strcmp(quadruples[header - 1].operator, "HALT") != 0) {
+            for (j = 0; j < loop->blockNum; j++)
+                if (loop->blocks[j] == cfg->blockOf[header - 1])
+                    ok = FALSE;
+        }
+        if (!ok)
+            continue;
+        for (j = 0; j < loop->blockNum; j++)
+            loopOfBlock[loop->blocks[j]] = sorted[k];
+        loopChanged = FALSE;
+
+        /*统计循环中每个变量的定值次数，并找出循环的出口块*/
+        exitNum = 0;
+        for (j = 0; j < loop->blockNum; j++) {
+            b = loop->blocks[j];
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+                q = &quadruples[i];
+                if (!isJump(q->operator) && strcmp(q->operator, "OUT") != 0 && isVariable(q->result)) {
+                    v = varIndex(q->result, FALSE);
+                    defCount[v]++;
+                    defAt[v] = i;
+                }
+            }
+            for (i = 0; i < cfg->blocks[b].succNum; i++)
+                if (loopOfBlock[cfg->blocks[b].succ[i]] != sorted[k]) {
+                    exitBlocks[exitNum++] = b;
+                    break;
+                }
+        }
+
+        /*反复寻找操作数都不在循环中改变（或由已外提的四元式定值）的算术运算*/
+        do {
+            count = 0;
+            for (j = 0; j < loop->blockNum; j++) {
+                b = loop->blocks[j];
+                for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+                    q = &quadruples[i];
+                    if (invariant[i] || !isArith(q->operator) || !isVariable(q->result))
+                        continue;
+                    v = varIndex(q->result, FALSE);
+                    if (defCount[v] != 1)
+                        continue;
+                    operand = &q->arg1;
+                    ok = TRUE;
+                    for (t = 0; t < 2; t++) {
+                        s = operand[t];
+                        if (isVariable(s) && defCount[u = varIndex(s, FALSE)] > 0 && !invariant[defAt[u]])
+                            ok = FALSE;
+                    }
+                    /*除法只在除数为非零常量时外提，避免提前触发除零*/
+                    if (strcmp(q->operator, "over") == 0 && !(isNumber(q->arg2) && atoi(q->arg2) != 0))
+                        ok = FALSE;
+                    if (!ok)
+                        continue;
+                    /*循环中对结果的使用都必须在此定值之后*/
+                    exitDominated = TRUE;
+                    for (t = 0; t < exitNum; t++)
+                        if (!dominates(cfg, b, exitBlocks[t]))
+                            exitDominated = FALSE;
+                    for (t = 0; t < loop->blockNum && ok; t++) {
+                        int c = loop->blocks[t];
+                        for (u = cfg->blocks[c].start; u < cfg->blocks[c].end; u++) {
+                            Quadruple *p = &quadruples[u];
+                            if (!((p->arg1 != NULL && strcmp(p->arg1, q->result) == 0) ||
+                                  (p->arg2 != NULL && strcmp(p->arg2, q->result) == 0) ||
+                                  (strcmp(p->operator, "OUT") == 0 && strcmp(p->result, q->result) == 0)))
+                                continue;
+                            if (c == b ? u <= i : !dominates(cfg, b, c))
+                                ok = FALSE;
+                        }
+                    }
+                    /*用户变量在循环后可能被使用，要求定值在每次离开循环前都会执行*/
+                    if (!isTemp(q->result) && !exitDominated)
+                        ok = FALSE;
+                    if (!ok)
+                        continue;
+                    invariant[i] = TRUE;
+                    removed[i] = TRUE;
+                    addInsertion(header, TRUE, sorted[k], q->operator, q->arg1, q->arg2, q->result);
+                    count++;
+                }
+            }
+            loopChanged |= count > 0;
+        } while (count > 0);
+
+        /*强度削弱：基本归纳变量i在循环中只有一次定值i:=i±c（c为数值常量或循环中不变的变量），
+         * 对times i,k,t（k在循环中不变）引入s=i*k，前置块中初始化，每次i改变后s加上c*k*/
+        for (j = 0; j < loop->blockNum; j++) {
+            b = loop->blocks[j];
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+                q = &quadruples[i];
+                if (invariant[i] || strcmp(q->operator, "times") != 0)
+                    continue;
+                for (t = 0; t < 2; t++) {
+                    iv = t == 0 ? q->arg1 : q->arg2;
+                    factor = t == 0 ? q->arg2 : q->arg1;
+                    if (!isVariable(iv) || defCount[v = varIndex(iv, FALSE)] != 1)
+                        continue;
+                    if (isVariable(factor) && defCount[varIndex(factor, FALSE)] > 0)
+                        continue;
+                    if (!isNumber(factor) && !isVariable(factor))
+                        continue;
+                    /*归纳变量的更新必须是plus iv,c,iv、plus c,iv,iv或minus iv,c,iv，c为不变的步长*/
+                    Quadruple *update = &quadruples[defAt[v]];
+                    delta = NULL;
+                    if (strcmp(update->operator, "plus") == 0 && strcmp(update->result, iv) == 0) {
+                        if (strcmp(update->arg1, iv) == 0 && isLoopStep(update->arg2, defCount))
+                            delta = update->arg2;
+                        else if (strcmp(update->arg2, iv) == 0 && isLoopStep(update->arg1, defCount))
+                            delta = update->arg1;
+                    } else if (strcmp(update->operator, "minus") == 0 && strcmp(update->result, iv) == 0 &&
+                               strcmp(update->arg1, iv) == 0 && isLoopStep(update->arg2, defCount))
+                        delta = update->arg2;
+                    if (delta == NULL)
+                        continue;
+                    s = newVar();
+                    addInsertion(header, TRUE, sorted[k], "times", iv, factor, s);
+                    if (isNumber(factor) && isNumber(delta))
+                        d = intToChar((int) ((unsigned) atoi(delta) * (unsigned) atoi(factor)));
+                    else if (isNumber(delta) && atoi(delta) == 1)
+                        d = factor;
+                    else {
+                        d = newVar();
+                        addInsertion(header, TRUE, sorted[k], "times", delta, factor, d);
+                    }
+                    addInsertion(defAt[v], FALSE, sorted[k], update->operator, s, d, s);
+                    q->operator = ":=";
+                    q->arg1 = s;
+                    q->arg2 = NULL;
+                    loopChanged = TRUE;
+                    break;
+                }
+            }
+        }
+        /*没有改变的循环不占用它的基本块，外层循环可以在本轮处理*/
+        if (loopChanged)
+            changed = TRUE;
+        else
+            for (j = 0; j < loop->blockNum; j++)
+                loopOfBlock[loop->blocks[j]] = -1;
+        /*恢复定值计数供下一个循环使用*/
+        for (j = 0; j < loop->blockNum; j++) {
+            b = loop->blocks[j];
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+                q = &quadruples[i];
+                if (!isJump(q->operator) && strcmp(q->operator, "OUT") != 0 && isVariable(q->result))
+                    defCount[varIndex(q->result, FALSE)] = 0;
+            }
+        }
+    }
+    if (changed)
+        applyInsertions(cfg, removed, loopOfBlock);
+
+    free(exitBlocks);
+    free(removed);
+    free(invariant);
+    free(defAt);
+    free(defCount);
+    free(sorted);
+    free(loopOfBlock);
+    freeCFG(cfg);
+    clearVarTable();
+    return changed;
+}
+
+/*循环优化：在自然循环上做不变量外提和归纳变量的强度削弱，
+ * 直到没有可以外提或削弱的四元式*/
+void loopOptimize(void) {
+    int rounds = 0;
+    while (loopRound() && ++rounds < 64);
+    free(insertions);
+    insertions = NULL;
+    insertionNum = 0;
+    insertionCapacity = 0;
+}
+
+/*对四元式依次执行各个优化阶段*/
+void optimize(void) {
+    int before = curIndex;
+    ssaOptimize();
+    TRACE_EVENT(TRACE_OPT, EV_OPT_PASS, 0, before, curIndex, "ssa");
+    before = curIndex;
+    jumpThreading();
+    TRACE_EVENT(TRACE_OPT, EV_OPT_PASS, 0, before, curIndex, "jump threading");
+    before = curIndex;
+    peephole();
+    TRACE_EVENT(TRACE_OPT, EV_OPT_PASS, 0, before, curIndex, "peephole");
+    before = curIndex;
+    loopOptimize();
+    TRACE_EVENT(TRACE_OPT, EV_OPT_PASS, 0, before, curIndex, "loop");
+    before = curIndex;
+    allocateTemps();
+    TRACE_EVENT(TRACE_OPT, EV_OPT_PASS, 0, before, curIndex, "allocate temps");
+}
@@ -0,0 +1,28 @@
+//
+// Created by liang on 2020/7/2.
+//
+
+#ifndef TINY_OPTIMIZE_H
+#define TINY_OPTIMIZE_H
+
+/*对四元式依次执行各个优化阶段*/
+void optimize(void);
+
+/*SSA形式上的全局优化：构造剪枝的SSA形式，依次执行稀疏条件常量传播
+ * （折叠常量、沿可能执行的边传播、删除不可达的四元式）、基于支配树的全局值编号
+ * 和死代码删除，最后离开SSA形式并重建四元式*/
+void ssaOptimize(void);
+
+/*跳转线程化：跳转到无条件跳转的跳转改为直接跳转到最终目标，
+ * 删除跳转到下一条四元式的跳转及不可达的四元式，并重新编号*/
+void jumpThreading(void);
+
+/*循环优化：在自然循环（repeat和do-while）上把循环不变的算术运算外提到前置块，
+ * 并把与基本归纳变量的乘法削弱为每次迭代的加法*/
+void loopOptimize(void);
+
+/*临时变量分配：把紧跟着复制给变量的临时变量合并到该变量，
+ * 再按活跃区间线性扫描重新编号，活跃区间不重叠的临时变量共用一个名字*/
+void allocateTemps(void);
+
+#endif //TINY_OPTIMIZE_H
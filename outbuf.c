@@ -0,0 +1,201 @@
+//
+// Created by liang on 2020/7/14.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "globals.h"
+#include "outbuf.h"
+
+/*本线程打开的缓冲区，按第一个目标文件查找*/
+static THREAD_LOCAL OutBuf **buffers = NULL;
+static THREAD_LOCAL int bufferNum = 0;
+static pthread_once_t exitOnce = PTHREAD_ONCE_INIT;
+
+/*把iov中的内容全部写到fd，处理只写了一部分的情况*/
+static void writeAll(int fd, struct iovec *iov, int num) {
+    ssize_t n;
+    while (num > 0) {
+        n = writev(fd, iov, num);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        while (num > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            num--;
+        }
+        if (num > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/*把缓冲区中的内容写到所有目标文件，没有文件描述符的文件（如open_memstream）用fwrite*/
+void outFlush(OutBuf *buf) {
+    struct iovec iov[OUT_MAX_CHUNKS], copy[OUT_MAX_CHUNKS];
+    int i, k, fd, num = buf->cur + 1;
+    if (buf->cur == 0 && buf->len == 0)
+        return;
+    for (i = 0; i < num; i++) {
+        iov[i].iov_base = buf->chunks[i];
+        iov[i].iov_len = i < buf->cur ? OUT_CHUNK_SIZE : buf->len;
+    }
+    for (i = 0; i < buf->targetNum; i++) {
+        /*先写出stdio中尚未写出的内容，保持先后顺序*/
+        fflush(buf->targets[i]);
+        fd = fileno(buf->targets[i]);
+        if (fd < 0) {
+            for (k = 0; k < num; k++)
+                fwrite(iov[k].iov_base, 1, iov[k].iov_len, buf->targets[i]);
+            continue;
+        }
+        memcpy(copy, iov, num * sizeof(struct iovec));
+        writeAll(fd, copy, num);
+    }
+    buf->cur = 0;
+    buf->len = 0;
+}
+
+/*写出本线程的所有缓冲区*/
+void outFlushAll(void) {
+    int i;
+    for (i = 0; i < bufferNum; i++)
+        outFlush(buffers[i]);
+}
+
+/*程序退出时写出主线程的缓冲区，工作线程在结束前自己关闭缓冲区*/
+static void registerExit(void) {
+    atexit(outFlushAll);
+}
+
+/*返回file对应的缓冲区，第一次调用时创建*/
+OutBuf *outOpen(FILE *file) {
+    OutBuf *buf;
+    int i;
+    for (i = 0; i < bufferNum; i++)
+        if (buffers[i]->targets[0] == file)
+            return buffers[i];
+    pthread_once(&exitOnce, registerExit);
+    buf = (OutBuf *) calloc(1, sizeof(OutBuf));
+    buf->targets[0] = file;
+    buf->targetNum = 1;
+    buf->chunks[0] = (char *) malloc(OUT_CHUNK_SIZE);
+    buffers = (OutBuf **) realloc(buffers, (bufferNum + 1) * sizeof(OutBuf *));
+    buffers[bufferNum++] = buf;
+    return buf;
+}
+
+/*增加一个目标文件*/
+void outAddTarget(OutBuf *buf, FILE *file) {
+    if (buf->targetNum < OUT_MAX_TARGETS)
+        buf->targets[buf->targetNum++] = file;
+}
+
+/*写出file对应的缓冲区并释放它*/
+void outClose(FILE *file) {
+    int i, k;
+    for (i = 0; i < bufferNum; i++)
+        if (buffers[i]->targets[0] == file) {
+            outFlush(buffers[i]);
+            for (k = 0; k < OUT_MAX_CHUNKS; k++)
+                free(buffers[i]->chunks[k]);
+            free(buffers[i]);
+            buffers[i] = buffers[--bufferNum];
+            return;
+        }
+}
+
+/*换到下一个块，所有块都满了时先写出*/
+static void nextChunk(OutBuf *buf) {
+    if (buf->cur + 1 == OUT_MAX_CHUNKS) {
+        outFlush(buf);
+        return;
+    }
+    buf->cur++;
+    buf->len = 0;
+    if (buf->chunks[buf->cur] == NULL)
+        buf->chunks[buf->cur] = (char *) malloc(OUT_CHUNK_SIZE);
+}
+
+/*追加n个字节*/
+void outWrite(OutBuf *buf, const char *s, size_t n) {
+    size_t k;
+    while (n > 0) {
+        if (buf->len == OUT_CHUNK_SIZE)
+            nextChunk(buf);
+        k = OUT_CHUNK_SIZE - buf->len;
+        if (k > n)
+            k = n;
+        memcpy(buf->chunks[buf->cur] + buf->len, s, k);
+        buf->len += k;
+        s += k;
+        n -= k;
+    }
+}
+
+/*追加一个字符串*/
+void outPuts(OutBuf *buf, const char *s) {
+    outWrite(buf, s, strlen(s));
+}
+
+/*追加一个字符*/
+void outChar(OutBuf *buf, char c) {
+    if (buf->len == OUT_CHUNK_SIZE)
+        nextChunk(buf);
+    buf->chunks[buf->cur][buf->len++] = c;
+}
+
+/*追加n个空格*/
+void outSpaces(OutBuf *buf, int n) {
+    static const char spaces[64] = "                                                                ";
+    while (n > 0) {
+        outWrite(buf, spaces, n < 64 ? n : 64);
+        n -= 64;
+    }
+}
+
+/*把v转换为十进制写在end之前，返回第一个字符的位置*/
+static char *formatInt(long v, char *end) {
+    unsigned long u = v < 0 ? 0ul - (unsigned long) v : (unsigned long) v;
+    do {
+        *--end = (char) ('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (v < 0)
+        *--end = '-';
+    return end;
+}
+
+/*追加一个十进制整数*/
+void outInt(OutBuf *buf, long v) {
+    char text[24], *s = formatInt(v, text + sizeof(text));
+    outWrite(buf, s, text + sizeof(text) - s);
+}
+
+/*按宽度追加n个字节*/
+static void writePad(OutBuf *buf, const char *s, int n, int width) {
+    if (width > n)
+        outSpaces(buf, width - n);
+    outWrite(buf, s, n);
+    if (-width > n)
+        outSpaces(buf, -width - n);
+}
+
+/*按宽度追加整数*/
+void outIntPad(OutBuf *buf, long v, int width) {
+    char text[24], *s = formatInt(v, text + sizeof(text));
+    writePad(buf, s, (int) (text + sizeof(text) - s), width);
+}
+
+/*按宽度追加字符串*/
+void outStrPad(OutBuf *buf, const char *s, int width) {
+    writePad(buf, s, (int) strlen(s), width);
+}
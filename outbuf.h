@@ -0,0 +1,61 @@
+//
+// Created by liang on 2020/7/14.
+//
+
+#ifndef TINY_OUTBUF_H
+#define TINY_OUTBUF_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*输出缓冲区：文本追加到若干个OUT_CHUNK_SIZE大小的块中，块用完或者调用outFlush时
+ * 用一次writev把所有块写到每个目标文件，所以同样的内容只格式化一次就可以写到多个文件*/
+#define OUT_CHUNK_SIZE 65536
+#define OUT_MAX_CHUNKS 16
+#define OUT_MAX_TARGETS 4
+
+typedef struct OutBufRec {
+    FILE *targets[OUT_MAX_TARGETS];
+    int targetNum;
+    char *chunks[OUT_MAX_CHUNKS];/*用过的块不释放，写出后重复使用*/
+    int cur;/*正在写的块，之前的块都是满的*/
+    size_t len;/*当前块已经写入的字节数*/
+} OutBuf;
+
+/*返回file对应的缓冲区，第一次调用时创建。缓冲区属于调用的线程，程序退出时自动写出主线程的缓冲区*/
+OutBuf *outOpen(FILE *file);
+
+/*增加一个目标文件，之后写出的内容同时写到这个文件*/
+void outAddTarget(OutBuf *buf, FILE *file);
+
+/*写出file对应的缓冲区并释放它，关闭file之前调用*/
+void outClose(FILE *file);
+
+/*把缓冲区中的内容写到所有目标文件。直接用fprintf写同一个文件之前必须先调用它*/
+void outFlush(OutBuf *buf);
+
+/*写出本线程的所有缓冲区*/
+void outFlushAll(void);
+
+/*追加n个字节*/
+void outWrite(OutBuf *buf, const char *s, size_t n);
+
+/*追加一个字符串*/
+void outPuts(OutBuf *buf, const char *s);
+
+/*追加一个字符*/
+void outChar(OutBuf *buf, char c);
+
+/*追加n个空格，一次写入*/
+void outSpaces(OutBuf *buf, int n);
+
+/*追加一个十进制整数*/
+void outInt(OutBuf *buf, long v);
+
+/*按宽度追加整数，width为正时右对齐（同%3d），为负时左对齐（同%-8d）*/
+void outIntPad(OutBuf *buf, long v, int width);
+
+/*按宽度追加字符串，width为正时右对齐（同%5s），为负时左对齐（同%-14s）*/
+void outStrPad(OutBuf *buf, const char *s, int width);
+
+#endif //TINY_OUTBUF_H
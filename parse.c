@@ -9,8 +9,9 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "outbuf.h"
 
-static TokenType token; /* holds current token */
+static THREAD_LOCAL TokenType token; /* holds current token */
 
 /* function prototypes for recursive calls */
 /*递归调用的函数原型*/
@@ -55,12 +56,31 @@ static TreeNode *notTerm(void);
 static TreeNode *boolFactor(void);
 
 /*判断是否是正则运算还是布尔运算，1时代表正则，0代表布尔*/
-static int inExp = 0;
+static THREAD_LOCAL int inExp = 0;
+
+/*记录语法错误，出错的单词接在"->"之后*/
+static void diagnose(const char *message) {
+    size_t len = strlen(message);
+    char *text = (char *) malloc(len + MAXTOKENLEN + 2);
+    strcpy(text, message);
+    while (len > 0 && isspace((unsigned char) text[len - 1]))
+        text[--len] = '\0';
+    if (len >= 2 && strcmp(text + len - 2, "->") == 0) {
+        text[len++] = ' ';
+        strcpy(text + len, tokenString);
+    }
+    addDiagnostic(lineno, text);
+    free(text);
+}
 
 /*输出语法错误*/
 static void syntaxError(char *message) {
-    fprintf(listing, "\n>>> ");
-    fprintf(listing, "Syntax error at line %d: %s", lineno, message);
+    OutBuf *out = outOpen(listing);
+    outPuts(out, "\n>>> Syntax error at line ");
+    outInt(out, lineno);
+    outPuts(out, ": ");
+    outPuts(out, message);
+    diagnose(message);
     Error = TRUE;
 }
 
@@ -70,7 +90,7 @@ static void match(TokenType expected) {
     else {
         syntaxError("unexpected token (from match)-> ");
         printToken(token, tokenString);
-        fprintf(listing, "      ");
+        outSpaces(outOpen(listing), 6);
     }
 }
 
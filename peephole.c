@@ -0,0 +1,367 @@
+//
+// Created by liang on 2020/7/8.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "util.h"
+#include "translate.h"
+#include "peephole.h"
+
+/*窗口中四元式的最大条数*/
+#define MAX_WINDOW 3
+/*模式变量$A~$Z、%A~%Z的个数*/
+#define MAX_BIND 26
+
+/* 规则的模式语言，每条四元式写成"操作符 参数1,参数2,结果"：
+ * 操作符：  普通字符串按字面匹配；@arith匹配plus/minus/times/over，
+ *          @rel匹配条件跳转，二者都会记住匹配到的操作符；
+ *          !rel只用于替换，表示取反后的条件跳转
+ * 操作数：  _匹配空；$X匹配任意操作数；%X只匹配临时变量；
+ *          同名的模式变量必须匹配相同的操作数；
+ *          .+n匹配跳转到窗口第一条之后第n条的目标；其余按字面匹配
+ * 窗口中第一条之后的四元式不能是跳转目标，保证窗口在一个基本块内 */
+typedef struct {
+    char *name;
+    char *pattern[MAX_WINDOW + 1];/*以NULL结尾*/
+    char *replacement[MAX_WINDOW + 1];
+    int singleUse;/*为TRUE时%X匹配到的临时变量只能在窗口中使用一次*/
+} PeepholeRule;
+
+static PeepholeRule rules[] = {
+        /*运算结果只复制给一个变量时直接写入该变量*/
+        {"forward-result", {"@arith $A,$B,%T", ":= %T,_,$X"},   {"@arith $A,$B,$X"}, TRUE},
+        {"forward-copy",   {":= $A,_,%T",      ":= %T,_,$X"},  {":= $A,_,$X"}, TRUE},
+        {"copy-back",      {":= %T,_,$X",      ":= $X,_,%T"},  {":= %T,_,$X"}, FALSE},
+        /*只使用一次的复制直接使用被复制的值*/
+        {"copy-arg1",      {":= $A,_,%T",      "@arith %T,$B,$R"}, {"@arith $A,$B,$R"}, TRUE},
+        {"copy-arg2",      {":= $A,_,%T",      "@arith $B,%T,$R"}, {"@arith $B,$A,$R"}, TRUE},
+        {"copy-rel1",      {":= $A,_,%T",      "@rel %T,$B,$L"}, {"@rel $A,$B,$L"}, TRUE},
+        {"copy-rel2",      {":= $A,_,%T",      "@rel $B,%T,$L"}, {"@rel $B,$A,$L"}, TRUE},
+        {"copy-out",       {":= $A,_,%T",      "OUT _,_,%T"},  {"OUT _,_,$A"}, TRUE},
+        /*条件跳转越过一条无条件跳转时取反条件，去掉一次跳转*/
+        {"invert-branch",  {"@rel $A,$B,.+2",  "j _,_,$L"},    {"!rel $A,$B,$L"}, FALSE},
+        /*自身复制*/
+        {"self-copy",      {":= $X,_,$X"},                     {NULL}, FALSE},
+        /*算术恒等式*/
+        {"times-one",      {"times $X,1,$R"},                  {":= $X,_,$R"}, FALSE},
+        {"one-times",      {"times 1,$X,$R"},                  {":= $X,_,$R"}, FALSE},
+        {"times-zero",     {"times $X,0,$R"},                  {":= 0,_,$R"}, FALSE},
+        {"zero-times",     {"times 0,$X,$R"},                  {":= 0,_,$R"}, FALSE},
+        {"plus-zero",      {"plus $X,0,$R"},                   {":= $X,_,$R"}, FALSE},
+        {"zero-plus",      {"plus 0,$X,$R"},                   {":= $X,_,$R"}, FALSE},
+        {"minus-zero",     {"minus $X,0,$R"},                  {":= $X,_,$R"}, FALSE},
+        {"minus-self",     {"minus $X,$X,$R"},                 {":= 0,_,$R"}, FALSE},
+        {"over-one",       {"over $X,1,$R"},                   {":= $X,_,$R"}, FALSE},
+};
+
+#define RULE_NUM ((int) (sizeof(rules) / sizeof(rules[0])))
+
+/*操作数模式的种类*/
+typedef enum {
+    PAT_NONE, PAT_LITERAL, PAT_ANY, PAT_TEMP, PAT_OFFSET
+} PatternKind;
+
+/*操作符模式的种类*/
+typedef enum {
+    OP_LITERAL, OP_ARITH, OP_REL, OP_NOTREL
+} OpKind;
+
+typedef struct {
+    PatternKind kind;
+    char *literal;
+    int bind;/*模式变量的下标或.+n中的n*/
+} OperandPattern;
+
+typedef struct {
+    OpKind kind;
+    char *literal;
+    OperandPattern operand[3];
+} QuadPattern;
+
+/*编译后的规则*/
+typedef struct {
+    QuadPattern pattern[MAX_WINDOW];
+    int patternNum;
+    QuadPattern replacement[MAX_WINDOW];
+    int replacementNum;
+} CompiledRule;
+
+static THREAD_LOCAL CompiledRule compiled[RULE_NUM];
+static THREAD_LOCAL int ruleCompiled = FALSE;
+static THREAD_LOCAL int fired[RULE_NUM];
+
+/*匹配过程中的绑定*/
+static THREAD_LOCAL char *binding[MAX_BIND];
+static THREAD_LOCAL char *boundOp;
+
+/*解析一个操作数模式*/
+static OperandPattern parseOperand(char *s) {
+    OperandPattern p;
+    p.literal = NULL;
+    p.bind = 0;
+    if (strcmp(s, "_") == 0)
+        p.kind = PAT_NONE;
+    else if (s[0] == '$' || s[0] == '%') {
+        p.kind = s[0] == '$' ? PAT_ANY : PAT_TEMP;
+        p.bind = s[1] - 'A';
+    } else if (s[0] == '.' && s[1] == '+') {
+        p.kind = PAT_OFFSET;
+        p.bind = atoi(s + 2);
+    } else {
+        p.kind = PAT_LITERAL;
+        p.literal = copyString(s);
+    }
+    return p;
+}
+
+/*解析一条四元式模式*/
+static QuadPattern parseQuad(char *text) {
+    QuadPattern p;
+    char buffer[64];
+    char *op, *args, *field;
+    int k;
+    strncpy(buffer, text, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    op = buffer;
+    args = strchr(buffer, ' ');
+    *args++ = '\0';
+    p.literal = NULL;
+    if (strcmp(op, "@arith") == 0)
+        p.kind = OP_ARITH;
+    else if (strcmp(op, "@rel") == 0)
+        p.kind = OP_REL;
+    else if (strcmp(op, "!rel") == 0)
+        p.kind = OP_NOTREL;
+    else {
+        p.kind = OP_LITERAL;
+        p.literal = copyString(op);
+    }
+    for (k = 0; k < 3; k++) {
+        field = args;
+        args = strchr(args, ',');
+        if (args != NULL)
+            *args++ = '\0';
+        p.operand[k] = parseOperand(field);
+    }
+    return p;
+}
+
+/*把规则表编译成便于匹配的形式*/
+static void compileRules(void) {
+    int r, k;
+    for (r = 0; r < RULE_NUM; r++) {
+        compiled[r].patternNum = 0;
+        for (k = 0; rules[r].pattern[k] != NULL; k++)
+            compiled[r].pattern[compiled[r].patternNum++] = parseQuad(rules[r].pattern[k]);
+        compiled[r].replacementNum = 0;
+        for (k = 0; rules[r].replacement[k] != NULL; k++)
+            compiled[r].replacement[compiled[r].replacementNum++] = parseQuad(rules[r].replacement[k]);
+    }
+    ruleCompiled = TRUE;
+}
+
+/*条件跳转取反后的操作符，j=没有对应的取反操作符时返回NULL*/
+char *invertRelation(char *operator) {
+    if (strcmp(operator, "j<") == 0)
+        return "j>=";
+    if (strcmp(operator, "j>=") == 0)
+        return "j<";
+    if (strcmp(operator, "j>") == 0)
+        return "j<=";
+    if (strcmp(operator, "j<=") == 0)
+        return "j>";
+    return NULL;
+}
+
+static int matchOperand(OperandPattern *p, char *s, int base) {
+    switch (p->kind) {
+        case PAT_NONE:
+            return s == NULL;
+        case PAT_LITERAL:
+            return s != NULL && strcmp(s, p->literal) == 0;
+        case PAT_OFFSET:
+            return s != NULL && atoi(s) == base + p->bind;
+        case PAT_TEMP:
+            if (!isTemp(s))
+                return FALSE;
+            /*是临时变量时按任意操作数绑定*/
+            /*fall through*/
+        case PAT_ANY:
+            if (s == NULL)
+                return FALSE;
+            if (binding[p->bind] == NULL) {
+                binding[p->bind] = s;
+                return TRUE;
+            }
+            return strcmp(binding[p->bind], s) == 0;
+        default:
+            return FALSE;
+    }
+}
+
+static int matchQuad(QuadPattern *p, Quadruple *q, int base) {
+    switch (p->kind) {
+        case OP_LITERAL:
+            if (strcmp(q->operator, p->literal) != 0)
+                return FALSE;
+            break;
+        case OP_ARITH:
+            if (!isArith(q->operator))
+                return FALSE;
+            boundOp = q->operator;
+            break;
+        case OP_REL:
+            if (!isCondJump(q->operator))
+                return FALSE;
+            boundOp = q->operator;
+            break;
+        default:
+            return FALSE;
+    }
+    if (!matchOperand(&p->operand[0], q->arg1, base))
+        return FALSE;
+    if (!matchOperand(&p->operand[1], q->arg2, base))
+        return FALSE;
+    return matchOperand(&p->operand[2], q->result, base);
+}
+
+static char *instantiateOperand(OperandPattern *p, int base) {
+    switch (p->kind) {
+        case PAT_LITERAL:
+            return p->literal;
+        case PAT_OFFSET:
+            return intToChar(base + p->bind);
+        case PAT_ANY:
+        case PAT_TEMP:
+            return binding[p->bind];
+        case PAT_NONE:
+        default:
+            return NULL;
+    }
+}
+
+/*临时变量的编号，不是临时变量返回-1*/
+static int tempNumber(char *s) {
+    return isTemp(s) ? atoi(s + strlen(TEMP_PREFIX)) : -1;
+}
+
+/*尝试在第i条四元式处使用第r条规则，成功时改写并返回TRUE*/
+static int applyRule(int r, int i, int *isTarget, int *removed, int *uses) {
+    CompiledRule *rule = &compiled[r];
+    QuadPattern *p;
+    Quadruple *q;
+    int k, t, windowUses, isTempBind;
+    char *operator;
+    if (i + rule->patternNum > curIndex)
+        return FALSE;
+    for (k = 0; k < MAX_BIND; k++)
+        binding[k] = NULL;
+    boundOp = NULL;
+    for (k = 0; k < rule->patternNum; k++) {
+        if (removed[i + k] || (k > 0 && isTarget[i + k]))
+            return FALSE;
+        if (!matchQuad(&rule->pattern[k], &quadruples[i + k], i))
+            return FALSE;
+    }
+    /*%X绑定的临时变量除窗口内的使用外不能再被使用*/
+    if (rules[r].singleUse)
+        for (k = 0; k < MAX_BIND; k++) {
+            if (binding[k] == NULL || (t = tempNumber(binding[k])) < 0)
+                continue;
+            isTempBind = FALSE;
+            windowUses = 0;
+            for (p = rule->pattern; p < rule->pattern + rule->patternNum; p++) {
+                isTempBind |= (p->operand[0].kind == PAT_TEMP && p->operand[0].bind == k) ||
+                              (p->operand[1].kind == PAT_TEMP && p->operand[1].bind == k) ||
+                              (p->operand[2].kind == PAT_TEMP && p->operand[2].bind == k);
+                windowUses += (p->operand[0].kind == PAT_TEMP && p->operand[0].bind == k) +
+                              (p->operand[1].kind == PAT_TEMP && p->operand[1].bind == k) +
+                              (p->operand[2].kind == PAT_TEMP && p->operand[2].bind == k &&
+                               p->kind == OP_LITERAL && strcmp(p->literal, "OUT") == 0);
+            }
+            if (isTempBind && uses[t] != windowUses)
+                return FALSE;
+        }
+    operator = boundOp;
+    if (rule->replacementNum > 0 && rule->replacement[0].kind == OP_NOTREL &&
+        (operator = invertRelation(boundOp)) == NULL)
+        return FALSE;
+    for (k = 0; k < rule->patternNum; k++) {
+        q = &quadruples[i + k];
+        if (k >= rule->replacementNum) {
+            removed[i + k] = TRUE;
+            continue;
+        }
+        p = &rule->replacement[k];
+        q->operator = p->kind == OP_LITERAL ? p->literal : operator;
+        q->arg1 = instantiateOperand(&p->operand[0], i);
+        q->arg2 = instantiateOperand(&p->operand[1], i);
+        q->result = instantiateOperand(&p->operand[2], i);
+    }
+    fired[r]++;
+    return TRUE;
+}
+
+/*窥孔优化，每一轮从头到尾扫描一遍，删除被合并的四元式后重新编号，直到没有规则可用*/
+void peephole(void) {
+    int i, r, t, k, changed, maxTemp;
+    int *isTarget, *removed, *uses;
+    char *operand[3];
+    Quadruple *q;
+    if (!ruleCompiled)
+        compileRules();
+    /*统计只针对本次编译*/
+    memset(fired, 0, sizeof(fired));
+    do {
+        changed = FALSE;
+        isTarget = (int *) calloc(curIndex + 1, sizeof(int));
+        removed = (int *) calloc(curIndex + 1, sizeof(int));
+        /*统计每个临时变量被使用的次数*/
+        maxTemp = -1;
+        for (i = 0; i < curIndex; i++) {
+            q = &quadruples[i];
+            if ((t = tempNumber(q->arg1)) > maxTemp)
+                maxTemp = t;
+            if ((t = tempNumber(q->arg2)) > maxTemp)
+                maxTemp = t;
+            if (!isJump(q->operator) && (t = tempNumber(q->result)) > maxTemp)
+                maxTemp = t;
+        }
+        uses = (int *) calloc(maxTemp + 2, sizeof(int));
+        for (i = 0; i < curIndex; i++) {
+            q = &quadruples[i];
+            operand[0] = q->arg1;
+            operand[1] = q->arg2;
+            operand[2] = strcmp(q->operator, "OUT") == 0 ? q->result : NULL;
+            for (k = 0; k < 3; k++)
+                if ((t = tempNumber(operand[k])) >= 0)
+                    uses[t]++;
+            if (isJump(q->operator) && (t = atoi(q->result)) >= 0 && t < curIndex)
+                isTarget[t] = TRUE;
+        }
+        for (i = 0; i < curIndex; i++)
+            for (r = 0; r < RULE_NUM; r++)
+                if (applyRule(r, i, isTarget, removed, uses)) {
+                    changed = TRUE;
+                    break;
+                }
+        removeQuadruples(removed);
+        free(uses);
+        free(removed);
+        free(isTarget);
+    } while (changed);
+}
+
+/*输出每条规则被使用的次数*/
+void printPeepholeStats(FILE *file) {
+    int r, total = 0;
+    fprintf(file, "\nPeephole rule        Fired\n");
+    fprintf(file, "-------------------  ------\n");
+    for (r = 0; r < RULE_NUM; r++) {
+        fprintf(file, "%-19s  %6d\n", rules[r].name, fired[r]);
+        total += fired[r];
+    }
+    fprintf(file, "%-19s  %6d\n", "total", total);
+}
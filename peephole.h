@@ -0,0 +1,20 @@
+//
+// Created by liang on 2020/7/8.
+//
+
+#ifndef TINY_PEEPHOLE_H
+#define TINY_PEEPHOLE_H
+
+#include <stdio.h>
+
+/*窥孔优化：用规则表在四元式上滑动窗口改写，重复直到没有规则可用。
+ * 需要在临时变量分配之前执行，此时每个临时变量只有一处定值*/
+void peephole(void);
+
+/*条件跳转取反后的操作符，j=没有对应的取反操作符时返回NULL*/
+char *invertRelation(char *operator);
+
+/*输出每条规则被使用的次数*/
+void printPeepholeStats(FILE *file);
+
+#endif //TINY_PEEPHOLE_H
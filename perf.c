@@ -0,0 +1,99 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdio.h>
+#include <string.h>
+#include "globals.h"
+#include "perf.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char *perfNames[PERF_NUM] = {
+        "cycles", "instructions", "branch-misses", "L1-dcache-misses", "LLC-misses", "page-faults"
+};
+
+/*每个计数器一个文件描述符，-1表示不可用。不放在一组中，这样一个计数器打不开不影响其他计数器*/
+static THREAD_LOCAL int perfFd[PERF_NUM];
+static THREAD_LOCAL int perfOpened = FALSE;
+
+#ifdef __linux__
+static int openCounter(unsigned type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#define CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+#endif
+
+/*打开当前线程的计数器*/
+int perfOpen(void) {
+    int i, num = 0;
+    if (perfOpened) {
+        for (i = 0; i < PERF_NUM; i++)
+            num += perfFd[i] >= 0;
+        return num;
+    }
+#ifdef __linux__
+    perfFd[PERF_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    perfFd[PERF_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perfFd[PERF_BRANCH_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    perfFd[PERF_L1D_MISSES] = openCounter(PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_L1D));
+    perfFd[PERF_LLC_MISSES] = openCounter(PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_LL));
+    perfFd[PERF_PAGE_FAULTS] = openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+#else
+    for (i = 0; i < PERF_NUM; i++)
+        perfFd[i] = -1;
+#endif
+    perfOpened = TRUE;
+    for (i = 0; i < PERF_NUM; i++)
+        num += perfFd[i] >= 0;
+    return num;
+}
+
+/*关闭当前线程的计数器*/
+void perfClose(void) {
+    int i;
+    if (!perfOpened)
+        return;
+#ifdef __linux__
+    for (i = 0; i < PERF_NUM; i++)
+        if (perfFd[i] >= 0)
+            close(perfFd[i]);
+#else
+    (void) i;
+#endif
+    perfOpened = FALSE;
+}
+
+int perfAvailable(PerfCounter counter) {
+    return perfOpened && perfFd[counter] >= 0;
+}
+
+/*读取所有计数器*/
+void perfRead(long long values[PERF_NUM]) {
+    int i;
+    for (i = 0; i < PERF_NUM; i++) {
+        values[i] = -1;
+#ifdef __linux__
+        /*值、启用的时间、实际计数的时间*/
+        unsigned long long data[3];
+        if (!perfAvailable(i) || read(perfFd[i], data, sizeof(data)) != sizeof(data))
+            continue;
+        if (data[2] > 0 && data[2] < data[1])
+            data[0] = (unsigned long long) ((double) data[0] * data[1] / data[2]);
+        values[i] = (long long) data[0];
+#endif
+    }
+}
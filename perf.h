@@ -0,0 +1,30 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_PERF_H
+#define TINY_PERF_H
+
+/*用perf_event_open读取当前线程的硬件计数器，只统计用户态。
+ * 内核不支持、权限不够或者不是Linux时，打不开的计数器不可用，读出的值为-1*/
+typedef enum {
+    PERF_CYCLES, PERF_INSTRUCTIONS, PERF_BRANCH_MISSES, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_PAGE_FAULTS,
+    PERF_NUM
+} PerfCounter;
+
+/*计数器的名字*/
+extern const char *perfNames[PERF_NUM];
+
+/*打开当前线程的计数器，已经打开时什么也不做。返回可用的计数器个数*/
+int perfOpen(void);
+
+/*关闭当前线程的计数器*/
+void perfClose(void);
+
+/*计数器是否可用*/
+int perfAvailable(PerfCounter counter);
+
+/*读取所有计数器的当前值，计数器被分时复用时按实际计数的时间比例放大*/
+void perfRead(long long values[PERF_NUM]);
+
+#endif //TINY_PERF_H
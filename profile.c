@@ -0,0 +1,256 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "globals.h"
+#include "translate.h"
+#include "cfg.h"
+#include "peephole.h"
+#include "profile.h"
+#include "trace.h"
+
+#define PROFILE_MAGIC "TINY profile 1"
+
+/*读入的剖析*/
+static THREAD_LOCAL uint64_t *profileCounts = NULL;
+static THREAD_LOCAL uint64_t *profileTaken = NULL;
+static THREAD_LOCAL int profileNum = 0;
+static THREAD_LOCAL unsigned profileChecksum = 0;
+static THREAD_LOCAL int profileLoaded = FALSE;
+
+static unsigned hashString(unsigned h, const char *s) {
+    if (s == NULL)
+        return (h ^ 0xff) * 16777619u;
+    while (*s)
+        h = (h ^ (unsigned char) *s++) * 16777619u;
+    return h * 16777619u;
+}
+
+/*四元式的校验和，包括操作符、操作数和行号*/
+static unsigned quadChecksum(void) {
+    unsigned h = 2166136261u;
+    int i;
+    for (i = 0; i < curIndex; i++) {
+        h = hashString(h, quadruples[i].operator);
+        h = hashString(h, quadruples[i].arg1);
+        h = hashString(h, quadruples[i].arg2);
+        h = hashString(h, quadruples[i].result);
+        h = (h ^ (unsigned) quadruples[i].lineno) * 16777619u;
+    }
+    return h;
+}
+
+/*写入剖析：每条四元式一行，然后按源程序行汇总，行的执行次数取该行四元式执行次数的最大值*/
+int profileWrite(const char *file, VMProfile *profile) {
+    FILE *f = fopen(file, "w");
+    uint64_t *lineExecutions, *lineBranches, *lineTaken;
+    int i, k, line;
+    if (f == NULL)
+        return FALSE;
+    fprintf(f, "%s\n", PROFILE_MAGIC);
+    fprintf(f, "quadruples %d %08x\n", curIndex, quadChecksum());
+    fprintf(f, "# index count taken line operator\n");
+    for (i = 0; i < curIndex && i < profile->codeNum; i++) {
+        fprintf(f, "%d %" PRIu64 " ", i, profile->counts[i]);
+        if (isCondJump(quadruples[i].operator))
+            fprintf(f, "%" PRIu64, profile->taken[i]);
+        else
+            fprintf(f, "-");
+        fprintf(f, " %d %s\n", quadruples[i].lineno, quadruples[i].operator);
+    }
+    /*一遍扫描四元式，按行号累加*/
+    lineExecutions = (uint64_t *) calloc(lineno + 1, sizeof(uint64_t));
+    lineBranches = (uint64_t *) calloc(lineno + 1, sizeof(uint64_t));
+    lineTaken = (uint64_t *) calloc(lineno + 1, sizeof(uint64_t));
+    for (k = 0; k < curIndex && k < profile->codeNum; k++) {
+        line = quadruples[k].lineno;
+        if (line < 1 || line > lineno)
+            continue;
+        if (profile->counts[k] > lineExecutions[line])
+            lineExecutions[line] = profile->counts[k];
+        if (isCondJump(quadruples[k].operator)) {
+            lineBranches[line] += profile->counts[k];
+            lineTaken[line] += profile->taken[k];
+        }
+    }
+    fprintf(f, "# line executions branches taken%%\n");
+    for (line = 1; line <= lineno; line++) {
+        if (lineExecutions[line] == 0)
+            continue;
+        fprintf(f, "line %d %" PRIu64 " %" PRIu64, line, lineExecutions[line], lineBranches[line]);
+        if (lineBranches[line] > 0)
+            fprintf(f, " %.1f\n", lineTaken[line] * 100.0 / lineBranches[line]);
+        else
+            fprintf(f, " -\n");
+    }
+    free(lineExecutions);
+    free(lineBranches);
+    free(lineTaken);
+    return fclose(f) == 0;
+}
+
+void profileClear(void) {
+    free(profileCounts);
+    free(profileTaken);
+    profileCounts = profileTaken = NULL;
+    profileNum = 0;
+    profileLoaded = FALSE;
+}
+
+/*读入剖析文件*/
+int profileLoad(const char *file) {
+    FILE *f = fopen(file, "r");
+    char buf[128], taken[32];
+    int i, index, num;
+    unsigned checksum;
+    profileClear();
+    if (f == NULL)
+        return FALSE;
+    if (fgets(buf, sizeof(buf), f) == NULL || strncmp(buf, PROFILE_MAGIC, strlen(PROFILE_MAGIC)) != 0 ||
+        fscanf(f, "quadruples %d %x\n", &num, &checksum) != 2 || num < 0 ||
+        fgets(buf, sizeof(buf), f) == NULL) {
+        fclose(f);
+        return FALSE;
+    }
+    profileCounts = (uint64_t *) calloc(num + 1, sizeof(uint64_t));
+    profileTaken = (uint64_t *) calloc(num + 1, sizeof(uint64_t));
+    for (i = 0; i < num; i++) {
+        if (fscanf(f, "%d %" SCNu64 " %31s %*d %*s", &index, &profileCounts[i], taken) != 3 || index != i) {
+            fclose(f);
+            profileClear();
+            return FALSE;
+        }
+        profileTaken[i] = taken[0] == '-' ? 0 : strtoull(taken, NULL, 10);
+    }
+    fclose(f);
+    profileNum = num;
+    profileChecksum = checksum;
+    profileLoaded = TRUE;
+    return TRUE;
+}
+
+/*块b最常走的后继，-1表示程序结束。j=不能取反，总是选顺序执行的后继*/
+static int likelySuccessor(CFG *cfg, int b) {
+    int last = cfg->blocks[b].end - 1, target;
+    Quadruple *q = &quadruples[last];
+    int fall = cfg->blocks[b].end < curIndex ? cfg->blockOf[cfg->blocks[b].end] : -1;
+    if (strcmp(q->operator, "HALT") == 0)
+        return -1;
+    if (!isJump(q->operator))
+        return fall;
+    target = atoi(q->result);
+    target = target >= 0 && target < curIndex ? cfg->blockOf[target] : -1;
+    if (!isCondJump(q->operator))
+        return target;
+    if (invertRelation(q->operator) != NULL && profileTaken[last] * 2 > profileCounts[last])
+        return target;
+    return fall;
+}
+
+/*输出一条四元式，跳转的目标先记为基本块，全部输出后再换成新的下标*/
+static void emit(Quadruple *out, int *outBlock, int *num, Quadruple q, int targetBlock) {
+    outBlock[*num] = targetBlock;
+    out[(*num)++] = q;
+}
+
+/*按剖析重排基本块*/
+void profileLayout(void) {
+    CFG *cfg;
+    Quadruple *out, q;
+    int *order, *placed, *newStart, *outBlock;
+    int n = curIndex, num = 0, outNum = 0, inverted = 0, cold = 0, seed, b, next, i, k, last, target, fall, end;
+    if (!profileLoaded || n == 0)
+        return;
+    if (profileNum != n || profileChecksum != quadChecksum()) {
+        fprintf(listing, "Profile does not match the program, ignored\n");
+        return;
+    }
+    cfg = buildCFG();
+    order = (int *) malloc(cfg->blockNum * sizeof(int));
+    placed = (int *) calloc(cfg->blockNum, sizeof(int));
+    /*执行过的块：从入口开始，每条链沿最常走的后继延伸到已放置或没有执行过的块为止。
+     * 下一条链优先从上一条链末尾的顺序后继开始，使原来的顺序执行尽量保留*/
+    for (seed = 0; seed >= 0;) {
+        for (b = seed; ; b = next) {
+            placed[b] = TRUE;
+            order[num++] = b;
+            next = likelySuccessor(cfg, b);
+            if (next < 0 || placed[next] || profileCounts[cfg->blocks[next].start] == 0)
+                break;
+        }
+        fall = cfg->blocks[b].end < n ? cfg->blockOf[cfg->blocks[b].end] : -1;
+        if (fall >= 0 && !placed[fall] && profileCounts[cfg->blocks[fall].start] > 0)
+            seed = fall;
+        else
+            for (seed = 0; seed < cfg->blockNum && (placed[seed] || profileCounts[cfg->blocks[seed].start] == 0);
+                 seed++);
+        if (seed == cfg->blockNum)
+            seed = -1;
+    }
+    for (b = 0; b < cfg->blockNum; b++)
+        if (!placed[b]) {
+            order[num++] = b;
+            cold++;
+        }
+
+    /*每个块最多增加一条无条件跳转*/
+    out = (Quadruple *) malloc((n + cfg->blockNum + 1) * sizeof(Quadruple));
+    outBlock = (int *) malloc((n + cfg->blockNum + 1) * sizeof(int));
+    newStart = (int *) malloc((cfg->blockNum + 1) * sizeof(int));
+    for (k = 0; k < num; k++) {
+        b = order[k];
+        next = k + 1 < num ? order[k + 1] : -1;
+        newStart[b] = outNum;
+        last = cfg->blocks[b].end - 1;
+        for (i = cfg->blocks[b].start; i < last; i++)
+            emit(out, outBlock, &outNum, quadruples[i], -2);
+        q = quadruples[last];
+        fall = cfg->blocks[b].end < n ? cfg->blockOf[cfg->blocks[b].end] : -1;
+        if (strcmp(q.operator, "HALT") == 0) {
+            emit(out, outBlock, &outNum, q, -2);
+            continue;
+        }
+        if (!isJump(q.operator)) {
+            emit(out, outBlock, &outNum, q, -2);
+            if (fall != next)
+                emit(out, outBlock, &outNum, (Quadruple) {poolString("j"), NULL, NULL, NULL, q.lineno}, fall);
+            continue;
+        }
+        target = atoi(q.result);
+        target = target >= 0 && target < n ? cfg->blockOf[target] : -1;
+        if (!isCondJump(q.operator)) {
+            if (target != next)
+                emit(out, outBlock, &outNum, q, target);
+        } else if (fall == next)
+            emit(out, outBlock, &outNum, q, target);
+        else if (target == next && invertRelation(q.operator) != NULL) {
+            q.operator = invertRelation(q.operator);
+            emit(out, outBlock, &outNum, q, fall);
+            inverted++;
+        } else {
+            emit(out, outBlock, &outNum, q, target);
+            emit(out, outBlock, &outNum, (Quadruple) {poolString("j"), NULL, NULL, NULL, q.lineno}, fall);
+        }
+    }
+    /*跳到程序末尾的跳转改为跳到最后的HALT，HALT之前的四元式中间没有插入跳转*/
+    b = cfg->blockOf[n - 1];
+    end = strcmp(quadruples[n - 1].operator, "HALT") == 0 ? newStart[b] + n - 1 - cfg->blocks[b].start : outNum;
+    for (i = 0; i < outNum; i++)
+        if (outBlock[i] != -2)
+            out[i].result = intToChar(outBlock[i] == -1 ? end : newStart[outBlock[i]]);
+    reserveQuadruples(outNum);
+    memcpy(quadruples, out, outNum * sizeof(Quadruple));
+    curIndex = outNum;
+    if (TRACING(TRACE_OPT, 1))
+        fprintf(listing, "\nProfile layout: %d blocks, %d not executed moved to the end, %d branches inverted\n",
+                cfg->blockNum, cold, inverted);
+    free(out);
+    free(outBlock);
+    free(newStart);
+    free(order);
+    free(placed);
+    freeCFG(cfg);
+}
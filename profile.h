@@ -0,0 +1,27 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_PROFILE_H
+#define TINY_PROFILE_H
+
+#include "vm.h"
+
+/*剖析引导的优化。tiny -fprofile-generate在虚拟机上运行程序，把每条四元式的执行次数、
+ * 条件跳转的跳转次数和按源程序行汇总的次数写入剖析文件；tiny -fprofile-use读入剖析文件，
+ * 在四元式生成和优化之后（-O0时也是）按执行次数重排基本块。剖析按四元式的下标记录，
+ * 同一程序用同样的选项编译时四元式相同，文件中记下四元式的条数和校验和，不符时不使用*/
+
+/*把当前四元式的剖析写入file，成功时返回TRUE*/
+int profileWrite(const char *file, VMProfile *profile);
+
+/*读入剖析文件，成功时返回TRUE。读入的剖析在本线程以后的编译中使用，直到profileClear*/
+int profileLoad(const char *file);
+
+void profileClear(void);
+
+/*按剖析重排基本块：从入口沿最常走的后继把执行过的块连成链，使可能的路径顺序执行，
+ * 必要时把条件跳转取反，没有执行过的块放到最后。没有读入剖析或剖析与四元式不符时什么也不做*/
+void profileLayout(void);
+
+#endif //TINY_PROFILE_H
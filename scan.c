@@ -8,6 +8,9 @@
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
+#include "outbuf.h"
+#include "stats.h"
+#include "trace.h"
 
 /* states in scanner DFA */
 typedef enum {
@@ -15,16 +18,27 @@ typedef enum {
 } StateType;
 
 /* lexeme of identifier or reserved word */
-char tokenString[MAXTOKENLEN + 1];
+THREAD_LOCAL char tokenString[MAXTOKENLEN + 1];
 
 /* BUFLEN = length of the input buffer for
    source code lines */
 #define BUFLEN 256
 
-static char lineBuf[BUFLEN]; /* holds the current line */
-static int linepos = 0; /* current position in LineBuf */
-static int bufsize = 0; /* current size of buffer string */
-static int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
+static THREAD_LOCAL char lineBuf[BUFLEN]; /* holds the current line */
+static THREAD_LOCAL int linepos = 0; /* current position in LineBuf */
+static THREAD_LOCAL int bufsize = 0; /* current size of buffer string */
+static THREAD_LOCAL int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
+
+/* Procedure initScanner resets the scanner
+ * before a new source file is read
+ * 读入新的源文件之前重置扫描程序
+ */
+void initScanner(void) {
+    lineno = 0;
+    linepos = 0;
+    bufsize = 0;
+    EOF_flag = FALSE;
+}
 
 /* getNextChar fetches the next non-blank character
    from lineBuf, reading in a new line if lineBuf is
@@ -33,7 +47,12 @@ static int getNextChar(void) {
     if (!(linepos < bufsize)) {
         lineno++;
         if (fgets(lineBuf, BUFLEN - 1, source)) {
-            if (EchoSource) fprintf(listing, "%4d: %s", lineno, lineBuf);
+            if (TRACING(TRACE_SOURCE, 1)) {
+                OutBuf *out = outOpen(listing);
+                outIntPad(out, lineno, 4);
+                outPuts(out, ": ");
+                outPuts(out, lineBuf);
+            }
             bufsize = strlen(lineBuf);
             linepos = 0;
             return lineBuf[linepos++];
@@ -75,7 +94,7 @@ static struct {
 
 /* lookup an identifier to see if it is a reserved word */
 /* uses linear search */
-static TokenType reservedLookup(char *s) {
+TokenType reservedLookup(char *s) {
     int i;
     for (i = 0; i < MAXRESERVED; i++)
         if (!strcmp(s, reservedWords[i].str))
@@ -84,7 +103,7 @@ static TokenType reservedLookup(char *s) {
 }
 
 /* Error code part **/
-int errorCode = 0;
+THREAD_LOCAL int errorCode = 0;
 char *errorMsg[6] = {
         "Unkown error",
         "Uncomplete comment,} expected!",
@@ -115,6 +134,7 @@ TokenType getToken(void) {  /* index for storing into tokenString */
     /* flag to indicate save to tokenString */
 
     int save;
+    statsBegin(PHASE_SCAN);
     while (state != DONE) {
         int c = getNextChar();
         char ch = (char) c;
@@ -263,7 +283,12 @@ TokenType getToken(void) {  /* index for storing into tokenString */
                 break;
             case DONE:
             default: /* should never happen */
-                fprintf(listing, "Scanner Bug: state= %d\n", state);
+            {
+                OutBuf *out = outOpen(listing);
+                outPuts(out, "Scanner Bug: state= ");
+                outInt(out, state);
+                outChar(out, '\n');
+            }
                 state = DONE;
                 currentToken = ERROR;
                 break;
@@ -276,11 +301,17 @@ TokenType getToken(void) {  /* index for storing into tokenString */
                 currentToken = reservedLookup(tokenString);
         }
     }
-    if (TraceScan) {
-        fprintf(listing, "\t%d: ", lineno);
+    if (TRACING(TRACE_SCAN, 1)) {
+        OutBuf *out = outOpen(listing);
+        outChar(out, '\t');
+        outInt(out, lineno);
+        outPuts(out, ": ");
 
         printToken(currentToken, tokenString);
     }
+    TRACE_EVENT(TRACE_SCAN, EV_TOKEN, lineno, currentToken, 0, tokenString);
+    stats.tokens++;
+    statsEnd();
     return currentToken;
 } /* end getToken */
 
@@ -12,11 +12,21 @@
 #define MAXTOKENLEN 40
 
 /* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN + 1];
+extern THREAD_LOCAL char tokenString[MAXTOKENLEN + 1];
+
+/* Procedure initScanner resets the scanner
+ * before a new source file is read
+ */
+void initScanner(void);
 
 /* function getToken returns the 
  * next token in source file
  */
 TokenType getToken(void);
 
+/* function reservedLookup returns the reserved
+ * word token for s, or ID if s is not reserved
+ */
+TokenType reservedLookup(char *s);
+
 #endif
@@ -0,0 +1,977 @@
+//
+// Created by liang on 2020/7/9.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "translate.h"
+#include "cfg.h"
+#include "ssa.h"
+#include "nametab.h"
+
+/*变量表，把四元式中的变量映射为连续编号*/
+static THREAD_LOCAL NameTable ssaVarTable;
+static THREAD_LOCAL int varCapacity;
+
+/*在变量表末尾加入一个变量*/
+static int addVar(SSA *ssa, char *name) {
+    if (ssa->varNum == varCapacity) {
+        varCapacity = varCapacity == 0 ? 256 : varCapacity * 2;
+        ssa->varNames = (char **) realloc(ssa->varNames, varCapacity * sizeof(char *));
+    }
+    ssa->varNames[ssa->varNum] = name;
+    return ssa->varNum++;
+}
+
+/*查找变量的编号，不存在时插入*/
+static int ssaVarIndex(SSA *ssa, char *name) {
+    int v = nameTableFind(&ssaVarTable, name);
+    if (v >= 0)
+        return v;
+    v = addVar(ssa, name);
+    nameTableInsert(&ssaVarTable, name, v);
+    return v;
+}
+
+/*第i条四元式第k个操作数（arg1、arg2、OUT的result）使用的变量，不是变量时返回NULL*/
+static char *usedVar(int i, int k) {
+    Quadruple *q = &quadruples[i];
+    char *s = k == 0 ? q->arg1 : k == 1 ? q->arg2 :
+                                 strcmp(q->operator, "OUT") == 0 ? q->result : NULL;
+    return isVariable(s) ? s : NULL;
+}
+
+/*第i条四元式定值的变量，没有时返回NULL*/
+static char *definedVar(int i) {
+    Quadruple *q = &quadruples[i];
+    if (isJump(q->operator) || strcmp(q->operator, "OUT") == 0 || !isVariable(q->result))
+        return NULL;
+    return q->result;
+}
+
+/*增加一个SSA名字，名字数组的容量在构造时按定值个数预留*/
+static int newName(SSA *ssa, int var, int def) {
+    ssa->nameVar[ssa->nameNum] = var;
+    ssa->nameDef[ssa->nameNum] = def;
+    return ssa->nameNum++;
+}
+
+/*块b在块s的前驱中的下标*/
+static int predIndex(CFG *cfg, int s, int b) {
+    int k;
+    for (k = 0; k < cfg->blocks[s].predNum; k++)
+        if (cfg->blocks[s].pred[k] == b)
+            return k;
+    return -1;
+}
+
+/*按稳定的计数排序把(key,value)对分组，start[key]起为该key的所有value*/
+static int *groupPairs(int *keys, int *values, int pairNum, int keyNum, int **start) {
+    int i;
+    int *result = (int *) malloc((pairNum + 1) * sizeof(int));
+    int *next = (int *) malloc((keyNum + 1) * sizeof(int));
+    *start = (int *) calloc(keyNum + 2, sizeof(int));
+    for (i = 0; i < pairNum; i++)
+        (*start)[keys[i] + 1]++;
+    for (i = 0; i < keyNum; i++)
+        (*start)[i + 1] += (*start)[i];
+    for (i = 0; i < keyNum; i++)
+        next[i] = (*start)[i];
+    for (i = 0; i < pairNum; i++)
+        result[next[keys[i]]++] = values[i];
+    free(next);
+    return result;
+}
+
+/*支配树的孩子列表*/
+static void buildDomChildren(SSA *ssa) {
+    CFG *cfg = ssa->cfg;
+    int *parent = (int *) malloc((cfg->blockNum + 1) * sizeof(int));
+    int *child = (int *) malloc((cfg->blockNum + 1) * sizeof(int));
+    int b, num = 0, d;
+    for (b = 0; b < cfg->blockNum; b++) {
+        d = cfg->blocks[b].idom;
+        if (d >= 0 && d != b) {
+            parent[num] = d;
+            child[num++] = b;
+        }
+    }
+    ssa->domChildren = groupPairs(parent, child, num, cfg->blockNum, &ssa->domChildStart);
+    free(child);
+    free(parent);
+}
+
+/*支配树上的父结点，入口块的父结点视为虚拟入口-1*/
+static int domParent(CFG *cfg, int b) {
+    return b == 0 ? -1 : cfg->blocks[b].idom;
+}
+
+/*求支配边界（Cooper-Harvey-Kennedy）：从汇合点的每个前驱沿支配树向上，直到汇合点的直接支配者。
+ * 入口块有前驱时也是汇合点（还有来自程序入口的边）*/
+static int *computeFrontiers(CFG *cfg, int **start) {
+    int n = cfg->blockNum, b, k, p, runner, stop, num = 0, capacity = n + 1;
+    int *owner = (int *) malloc(capacity * sizeof(int));
+    int *member = (int *) malloc(capacity * sizeof(int));
+    int *last = (int *) malloc((n + 1) * sizeof(int));
+    int *result;
+    BasicBlock *block;
+    for (b = 0; b < n; b++)
+        last[b] = -1;
+    for (b = 0; b < n; b++) {
+        block = &cfg->blocks[b];
+        if (block->idom == -1 || block->predNum + (b == 0) < 2)
+            continue;
+        stop = domParent(cfg, b);
+        for (k = 0; k < block->predNum; k++) {
+            p = block->pred[k];
+            if (cfg->blocks[p].idom == -1)
+                continue;
+            for (runner = p; runner != stop && last[runner] != b; runner = domParent(cfg, runner)) {
+                last[runner] = b;
+                if (num == capacity) {
+                    capacity *= 2;
+                    owner = (int *) realloc(owner, capacity * sizeof(int));
+                    member = (int *) realloc(member, capacity * sizeof(int));
+                }
+                owner[num] = runner;
+                member[num++] = b;
+            }
+        }
+    }
+    result = groupPairs(owner, member, num, n, start);
+    free(last);
+    free(member);
+    free(owner);
+    return result;
+}
+
+/*为每个变量求入口处活跃的块并在迭代支配边界上放置φ函数，返回φ的个数，
+ * phiBlock和phiVar按变量顺序记录φ的位置*/
+static int placePhis(SSA *ssa, int **phiBlock, int **phiVar) {
+    CFG *cfg = ssa->cfg;
+    int n = curIndex, nb = cfg->blockNum, vn = ssa->varNum;
+    int i, k, b, v, x, d, p, top, num = 0, capacity = nb + 1, pairNum;
+    int *keys = (int *) malloc((4 * n + 1) * sizeof(int));
+    int *values = (int *) malloc((4 * n + 1) * sizeof(int));
+    int *defMark = (int *) malloc((vn + 1) * sizeof(int));
+    int *useMark = (int *) malloc((vn + 1) * sizeof(int));
+    int *defStart, *defBlocks, *ueStart, *ueBlocks, *dfStart, *df;
+    int *liveMark = (int *) malloc((nb + 1) * sizeof(int));
+    int *phiMark = (int *) malloc((nb + 1) * sizeof(int));
+    int *blockDef = (int *) malloc((nb + 1) * sizeof(int));/*块中有定值的变量*/
+    int *stack = (int *) malloc((nb + 1) * sizeof(int));
+    char *s;
+
+    /*每个变量的定值块，以及在块中定值之前就被使用（入口处向上暴露）的块*/
+    for (v = 0; v < vn; v++) {
+        defMark[v] = -1;
+        useMark[v] = -1;
+    }
+    pairNum = 0;
+    for (b = 0; b < nb; b++) {
+        if (cfg->blocks[b].idom == -1)
+            continue;
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            if ((s = definedVar(i)) != NULL && defMark[v = ssaVarIndex(ssa, s)] != b) {
+                defMark[v] = b;
+                keys[pairNum] = v;
+                values[pairNum++] = b;
+            }
+    }
+    defBlocks = groupPairs(keys, values, pairNum, vn, &defStart);
+    for (v = 0; v < vn; v++)
+        defMark[v] = -1;
+    pairNum = 0;
+    for (b = 0; b < nb; b++) {
+        if (cfg->blocks[b].idom == -1)
+            continue;
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+            for (k = 0; k < 3; k++)
+                if ((s = usedVar(i, k)) != NULL && defMark[v = ssaVarIndex(ssa, s)] != b &&
+                    useMark[v] != b) {
+                    useMark[v] = b;
+                    keys[pairNum] = v;
+                    values[pairNum++] = b;
+                }
+            if ((s = definedVar(i)) != NULL)
+                defMark[ssaVarIndex(ssa, s)] = b;
+        }
+    }
+    ueBlocks = groupPairs(keys, values, pairNum, vn, &ueStart);
+    df = computeFrontiers(cfg, &dfStart);
+
+    *phiBlock = (int *) malloc(capacity * sizeof(int));
+    *phiVar = (int *) malloc(capacity * sizeof(int));
+    for (b = 0; b < nb; b++) {
+        liveMark[b] = -1;
+        phiMark[b] = -1;
+        blockDef[b] = -1;
+    }
+    for (v = 0; v < vn; v++) {
+        /*逆向求v在入口处活跃的块*/
+        for (k = defStart[v]; k < defStart[v + 1]; k++)
+            blockDef[defBlocks[k]] = v;
+        top = 0;
+        for (k = ueStart[v]; k < ueStart[v + 1]; k++) {
+            liveMark[ueBlocks[k]] = v;
+            stack[top++] = ueBlocks[k];
+        }
+        while (top > 0) {
+            b = stack[--top];
+            for (k = 0; k < cfg->blocks[b].predNum; k++) {
+                p = cfg->blocks[b].pred[k];
+                if (cfg->blocks[p].idom != -1 && liveMark[p] != v && blockDef[p] != v) {
+                    liveMark[p] = v;
+                    stack[top++] = p;
+                }
+            }
+        }
+        /*迭代支配边界，只在v活跃的块放置φ，φ本身也是新的定值*/
+        top = 0;
+        for (k = defStart[v]; k < defStart[v + 1]; k++)
+            stack[top++] = defBlocks[k];
+        while (top > 0) {
+            x = stack[--top];
+            for (k = dfStart[x]; k < dfStart[x + 1]; k++) {
+                d = df[k];
+                if (phiMark[d] == v)
+                    continue;
+                phiMark[d] = v;
+                if (liveMark[d] != v)
+                    continue;
+                if (num == capacity) {
+                    capacity *= 2;
+                    *phiBlock = (int *) realloc(*phiBlock, capacity * sizeof(int));
+                    *phiVar = (int *) realloc(*phiVar, capacity * sizeof(int));
+                }
+                (*phiBlock)[num] = d;
+                (*phiVar)[num++] = v;
+                if (blockDef[d] != v) {
+                    blockDef[d] = v;
+                    stack[top++] = d;
+                }
+            }
+        }
+    }
+    free(df);
+    free(dfStart);
+    free(ueBlocks);
+    free(ueStart);
+    free(defBlocks);
+    free(defStart);
+    free(stack);
+    free(blockDef);
+    free(phiMark);
+    free(liveMark);
+    free(useMark);
+    free(defMark);
+    free(values);
+    free(keys);
+    return num;
+}
+
+/*沿支配树先序重命名：每个变量维护当前的名字，离开子树时恢复*/
+static void renameVariables(SSA *ssa) {
+    CFG *cfg = ssa->cfg;
+    int nb = cfg->blockNum;
+    int *cur = (int *) malloc((ssa->varNum + 1) * sizeof(int));/*变量当前的名字*/
+    int *logVar = (int *) malloc((curIndex + ssa->phiNum + 1) * sizeof(int));
+    int *logName = (int *) malloc((curIndex + ssa->phiNum + 1) * sizeof(int));
+    int *logMark = (int *) malloc((nb + 1) * sizeof(int));
+    int *stack = (int *) malloc((nb + 1) * sizeof(int));
+    int *next = (int *) malloc((nb + 1) * sizeof(int));
+    int v, b, c, i, k, j, s, f, top = 0, logTop = 0;
+    char *str;
+    Phi *phi;
+    for (v = 0; v < ssa->varNum; v++)
+        cur[v] = v;
+    if (nb > 0) {
+        stack[top++] = 0;
+        next[0] = -1;
+    }
+    while (top > 0) {
+        b = stack[top - 1];
+        if (next[b] == -1) {
+            /*进入块b*/
+            next[b] = ssa->domChildStart[b];
+            logMark[b] = logTop;
+            for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++) {
+                phi = &ssa->phis[f];
+                logVar[logTop] = phi->var;
+                logName[logTop++] = cur[phi->var];
+                cur[phi->var] = phi->name = newName(ssa, phi->var, -2 - f);
+            }
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+                for (k = 0; k < 3; k++)
+                    if ((str = usedVar(i, k)) != NULL)
+                        ssa->use[3 * i + k] = cur[ssaVarIndex(ssa, str)];
+                if ((str = definedVar(i)) != NULL) {
+                    v = ssaVarIndex(ssa, str);
+                    logVar[logTop] = v;
+                    logName[logTop++] = cur[v];
+                    cur[v] = ssa->def[i] = newName(ssa, v, i);
+                }
+            }
+            /*填写后继中φ函数对应本块的参数*/
+            for (k = 0; k < cfg->blocks[b].succNum; k++) {
+                s = cfg->blocks[b].succ[k];
+                j = predIndex(cfg, s, b);
+                for (f = ssa->phiStart[s]; f < ssa->phiStart[s + 1]; f++)
+                    ssa->phis[f].args[j] = cur[ssa->phis[f].var];
+            }
+        }
+        if (next[b] < ssa->domChildStart[b + 1]) {
+            c = ssa->domChildren[next[b]++];
+            next[c] = -1;
+            stack[top++] = c;
+        } else {
+            /*离开块b，恢复进入时的名字*/
+            while (logTop > logMark[b]) {
+                logTop--;
+                cur[logVar[logTop]] = logName[logTop];
+            }
+            top--;
+        }
+    }
+    free(next);
+    free(stack);
+    free(logMark);
+    free(logName);
+    free(logVar);
+    free(cur);
+}
+
+/*在cfg上构造剪枝的SSA形式*/
+SSA *buildSSA(CFG *cfg) {
+    SSA *ssa = (SSA *) calloc(1, sizeof(SSA));
+    int n = curIndex, nb = cfg->blockNum;
+    int i, k, b, f, v, argNum;
+    int *phiBlock, *phiVar, *order, *sorted;
+    char *s;
+    ssa->cfg = cfg;
+
+    nameTableClear(&ssaVarTable);
+    varCapacity = 0;
+    for (i = 0; i < n; i++) {
+        for (k = 0; k < 3; k++)
+            if ((s = usedVar(i, k)) != NULL)
+                ssaVarIndex(ssa, s);
+        if ((s = definedVar(i)) != NULL)
+            ssaVarIndex(ssa, s);
+    }
+    ssa->def = (int *) malloc((n + 1) * sizeof(int));
+    ssa->use = (int *) malloc((3 * n + 1) * sizeof(int));
+    ssa->removed = (int *) calloc(n + 1, sizeof(int));
+    ssa->executable = (int *) calloc(nb + 1, sizeof(int));
+    for (i = 0; i < n; i++) {
+        ssa->def[i] = -1;
+        for (k = 0; k < 3; k++)
+            ssa->use[3 * i + k] = -1;
+    }
+    /*不可达块中的四元式直接删除（保留最后的HALT）*/
+    for (b = 0; b < nb; b++) {
+        ssa->executable[b] = cfg->blocks[b].idom != -1;
+        if (!ssa->executable[b])
+            for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+                ssa->removed[i] = i != n - 1;
+    }
+    buildDomChildren(ssa);
+
+    /*放置φ函数并按基本块排列，同一块内的φ保持变量顺序*/
+    ssa->phiNum = placePhis(ssa, &phiBlock, &phiVar);
+    order = (int *) malloc((ssa->phiNum + 1) * sizeof(int));
+    for (f = 0; f < ssa->phiNum; f++)
+        order[f] = f;
+    sorted = groupPairs(phiBlock, order, ssa->phiNum, nb, &ssa->phiStart);
+    ssa->phis = (Phi *) malloc((ssa->phiNum + 1) * sizeof(Phi));
+    for (f = 0; f < ssa->phiNum; f++) {
+        ssa->phis[f].var = phiVar[sorted[f]];
+        ssa->phis[f].block = phiBlock[sorted[f]];
+        ssa->phis[f].name = -1;
+        ssa->phis[f].removed = FALSE;
+    }
+    free(sorted);
+    free(order);
+    free(phiVar);
+    free(phiBlock);
+
+    /*名字0到varNum-1为入口处的初值*/
+    ssa->nameVar = (int *) malloc((ssa->varNum + n + ssa->phiNum + 1) * sizeof(int));
+    ssa->nameDef = (int *) malloc((ssa->varNum + n + ssa->phiNum + 1) * sizeof(int));
+    for (v = 0; v < ssa->varNum; v++) {
+        ssa->nameVar[v] = v;
+        ssa->nameDef[v] = -1;
+    }
+    ssa->nameNum = ssa->varNum;
+    for (f = 0; f < ssa->phiNum; f++) {
+        b = ssa->phis[f].block;
+        argNum = cfg->blocks[b].predNum + (b == 0);
+        ssa->phis[f].args = (int *) malloc((argNum + 1) * sizeof(int));
+        for (k = 0; k < argNum; k++)
+            ssa->phis[f].args[k] = -1;
+        if (b == 0)
+            ssa->phis[f].args[cfg->blocks[b].predNum] = ssa->phis[f].var;
+    }
+    renameVariables(ssa);
+    return ssa;
+}
+
+/*判断从块p到块s的边在当前四元式下是否仍然存在*/
+int ssaEdgeLive(SSA *ssa, int p, int s) {
+    CFG *cfg = ssa->cfg;
+    int last = cfg->blocks[p].end - 1, target;
+    int fall = cfg->blocks[s].start == cfg->blocks[p].end;
+    Quadruple *q = &quadruples[last];
+    if (!ssa->executable[p] || !ssa->executable[s])
+        return FALSE;
+    if (ssa->removed[last])
+        return fall;
+    if (strcmp(q->operator, "HALT") == 0)
+        return FALSE;
+    if (!isJump(q->operator))
+        return fall;
+    target = atoi(q->result);
+    if (target >= 0 && target < curIndex && cfg->blockOf[target] == s)
+        return TRUE;
+    return isCondJump(q->operator) && fall;
+}
+
+/*复制插入的位置：程序入口（跳转到第0条四元式的不经过）、四元式之前、四元式之后*/
+#define AT_ENTRY 0
+#define AT_BEFORE 1
+#define AT_AFTER 2
+
+/*离开SSA形式时插入的四元式，key为3*位置+种类，位置n+k表示第k个拆边块*/
+typedef struct {
+    int key;
+    int target;/*拆边块末尾的跳转的原目标，其他为-1*/
+    Quadruple quad;
+} SSACopy;
+
+static THREAD_LOCAL SSACopy *copies;
+static THREAD_LOCAL int copyNum;
+static THREAD_LOCAL int copyCapacity;
+
+static void addCopy(int key, int target, char *operator, char *arg1, char *result) {
+    SSACopy *c;
+    if (copyNum == copyCapacity) {
+        copyCapacity = copyCapacity == 0 ? 16 : copyCapacity * 2;
+        copies = (SSACopy *) realloc(copies, copyCapacity * sizeof(SSACopy));
+    }
+    c = &copies[copyNum++];
+    c->key = key;
+    c->target = target;
+    c->quad.operator = operator;
+    c->quad.arg1 = arg1;
+    c->quad.arg2 = NULL;
+    c->quad.result = result;
+    c->quad.lineno = key / 3 < curIndex ? quadruples[key / 3].lineno : 0;
+}
+
+/*把一条边上的并行复制dst[k]:=src[k]（变量编号）顺序化后加入插入记录，
+ * 目标仍被其他复制读取的先不写，只剩循环时用新的临时变量打破*/
+static void addParallelCopies(SSA *ssa, int *dst, int *src, int num, int key) {
+    int k, j, blocked, tmp;
+    while (num > 0) {
+        for (k = 0; k < num; k++) {
+            blocked = FALSE;
+            for (j = 0; j < num && !blocked; j++)
+                blocked = j != k && src[j] == dst[k];
+            if (!blocked)
+                break;
+        }
+        if (k == num) {
+            tmp = addVar(ssa, newVar());
+            addCopy(key, -1, ":=", ssa->varNames[dst[0]], ssa->varNames[tmp]);
+            for (j = 0; j < num; j++)
+                if (src[j] == dst[0])
+                    src[j] = tmp;
+            continue;
+        }
+        addCopy(key, -1, ":=", ssa->varNames[src[k]], ssa->varNames[dst[k]]);
+        num--;
+        dst[k] = dst[num];
+        src[k] = src[num];
+    }
+}
+
+/*活跃名字冲突时选择改用新变量的名字：入口初值不改，
+ * 尽量不改φ的定值和φ的参数（改了就要在边上复制），其余改编号大的*/
+static int chooseVictim(SSA *ssa, int a, int b, int entryNum, int *phiUse) {
+    int sa, sb;
+    if (a < entryNum)
+        return b;
+    if (b < entryNum)
+        return a;
+    sa = (ssa->nameDef[a] <= -2) + (phiUse[a] > 0);
+    sb = (ssa->nameDef[b] <= -2) + (phiUse[b] > 0);
+    if (sa != sb)
+        return sa < sb ? a : b;
+    return a > b ? a : b;
+}
+
+/*让名字x单独使用一个新变量x_n*/
+static void splitName(SSA *ssa, int *home, int x) {
+    char *base = ssa->varNames[ssa->nameVar[x]];
+    char *str = (char *) malloc(strlen(base) + 12);
+    sprintf(str, "%s_%d", base, x);
+    home[x] = addVar(ssa, poolString(str));
+    free(str);
+}
+
+/*名字x在当前程序点活跃。slot[h]为活跃的、存放在变量h中的名字*/
+static void setLive(SSA *ssa, int *home, int *slot, int x, int entryNum, int *phiUse) {
+    int h = home[x], m = slot[h], victim;
+    if (m == -1 || m == x) {
+        slot[h] = x;
+        return;
+    }
+    victim = chooseVictim(ssa, x, m, entryNum, phiUse);
+    splitName(ssa, home, victim);
+    slot[h] = victim == m ? x : m;
+    slot[home[victim]] = victim;
+}
+
+/*名字x在当前程序点定值，定值之前不再活跃*/
+static void killLive(SSA *ssa, int *home, int *slot, int x, int entryNum, int *phiUse) {
+    int h = home[x], m = slot[h], victim;
+    if (m == x) {
+        slot[h] = -1;
+        return;
+    }
+    if (m == -1)
+        return;
+    /*m跨过x的定值仍然活跃*/
+    victim = chooseVictim(ssa, x, m, entryNum, phiUse);
+    splitName(ssa, home, victim);
+    if (victim == m) {
+        slot[h] = -1;
+        slot[home[m]] = m;
+    }
+}
+
+/*求每个名字活跃的块的出口，结果按块分组*/
+static int *nameLiveness(SSA *ssa, int **liveStart) {
+    CFG *cfg = ssa->cfg;
+    int n = curIndex, nb = cfg->blockNum;
+    int i, k, b, s, f, x, p, u, db, top, site, num = 0, pairNum = 0, capacity = n + 1;
+    int *siteStart, *sites;
+    int *keys = (int *) malloc(capacity * sizeof(int));
+    int *values = (int *) malloc(capacity * sizeof(int));
+    int *outBlock = (int *) malloc(capacity * sizeof(int));
+    int *outName = (int *) malloc(capacity * sizeof(int));
+    int *inMark = (int *) malloc((nb + 1) * sizeof(int));
+    int *outMark = (int *) malloc((nb + 1) * sizeof(int));
+    int *stack = (int *) malloc((nb + 1) * sizeof(int));
+    int *result;
+    Phi *phi;
+
+    /*使用点：普通使用记为2*块号，φ参数记为前驱出口2*前驱+1*/
+#define ADD_SITE(name, value) do { \
+        if (num == capacity) { \
+            capacity *= 2; \
+            keys = (int *) realloc(keys, capacity * sizeof(int)); \
+            values = (int *) realloc(values, capacity * sizeof(int)); \
+        } \
+        keys[num] = (name); \
+        values[num++] = (value); \
+    } while (0)
+    for (b = 0; b < nb; b++) {
+        if (!ssa->executable[b])
+            continue;
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            for (k = 0; k < 3 && !ssa->removed[i]; k++)
+                if ((u = ssa->use[3 * i + k]) >= 0)
+                    ADD_SITE(u, 2 * b);
+        for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++) {
+            phi = &ssa->phis[f];
+            if (phi->removed)
+                continue;
+            for (k = 0; k < cfg->blocks[b].predNum; k++)
+                if (phi->args[k] >= 0 && ssaEdgeLive(ssa, cfg->blocks[b].pred[k], b))
+                    ADD_SITE(phi->args[k], 2 * cfg->blocks[b].pred[k] + 1);
+        }
+    }
+#undef ADD_SITE
+    sites = groupPairs(keys, values, num, ssa->nameNum, &siteStart);
+
+    capacity = n + 1;
+    for (b = 0; b < nb; b++) {
+        inMark[b] = -1;
+        outMark[b] = -1;
+    }
+#define LIVE_OUT(block) do { \
+        if (outMark[block] != x) { \
+            outMark[block] = x; \
+            if (pairNum == capacity) { \
+                capacity *= 2; \
+                outBlock = (int *) realloc(outBlock, capacity * sizeof(int)); \
+                outName = (int *) realloc(outName, capacity * sizeof(int)); \
+            } \
+            outBlock[pairNum] = (block); \
+            outName[pairNum++] = x; \
+        } \
+    } while (0)
+#define LIVE_IN(block) do { \
+        if ((block) != db && inMark[block] != x) { \
+            inMark[block] = x; \
+            stack[top++] = (block); \
+        } \
+    } while (0)
+    for (x = 0; x < ssa->nameNum; x++) {
+        if (ssa->nameDef[x] == -1)
+            db = -1;
+        else if (ssa->nameDef[x] >= 0)
+            db = cfg->blockOf[ssa->nameDef[x]];
+        else
+            db = ssa->phis[-2 - ssa->nameDef[x]].block;
+        top = 0;
+        for (k = siteStart[x]; k < siteStart[x + 1]; k++) {
+            site = sites[k];
+            b = site >> 1;
+            if (site & 1)
+                LIVE_OUT(b);
+            LIVE_IN(b);
+        }
+        /*从入口处活跃的块逆向传播到定值所在的块为止*/
+        while (top > 0) {
+            s = stack[--top];
+            for (k = 0; k < cfg->blocks[s].predNum; k++) {
+                p = cfg->blocks[s].pred[k];
+                if (!ssaEdgeLive(ssa, p, s))
+                    continue;
+                LIVE_OUT(p);
+                LIVE_IN(p);
+            }
+        }
+    }
+#undef LIVE_IN
+#undef LIVE_OUT
+    result = groupPairs(outBlock, outName, pairNum, nb, liveStart);
+    free(stack);
+    free(outMark);
+    free(inMark);
+    free(outName);
+    free(outBlock);
+    free(values);
+    free(keys);
+    free(siteStart);
+    free(sites);
+    return result;
+}
+
+/*按插入记录重建四元式数组并修正跳转目标，retarget[i]不为-1时第i条跳转改为跳到该拆边块*/
+static void rebuildQuadruples(SSA *ssa, int *retarget, int stubNum) {
+    int n = curIndex, keyNum = 3 * (n + stubNum), total = n + copyNum;
+    int i, k, pos, key, target, s;
+    int *order, *start;
+    int *keys = (int *) malloc((copyNum + 1) * sizeof(int));
+    int *ids = (int *) malloc((copyNum + 1) * sizeof(int));
+    int *newPos = (int *) malloc((n + 1) * sizeof(int));
+    int *stubStart = (int *) malloc((stubNum + 1) * sizeof(int));
+    int *fromOld = (int *) malloc((total + 1) * sizeof(int));/*原四元式的下标，插入的为-1*/
+    int *jumpOld = (int *) malloc((total + 1) * sizeof(int));/*拆边块跳转的原目标*/
+    Quadruple *result = (Quadruple *) malloc((total + 1) * sizeof(Quadruple));
+    for (k = 0; k < copyNum; k++) {
+        keys[k] = copies[k].key;
+        ids[k] = k;
+    }
+    order = groupPairs(keys, ids, copyNum, keyNum, &start);
+    pos = 0;
+#define EMIT_COPIES(key) do { \
+        for (k = start[key]; k < start[(key) + 1]; k++) { \
+            fromOld[pos] = -1; \
+            jumpOld[pos] = copies[order[k]].target; \
+            result[pos++] = copies[order[k]].quad; \
+        } \
+    } while (0)
+    for (i = 0; i < n; i++) {
+        key = 3 * i;
+        EMIT_COPIES(key + AT_ENTRY);
+        newPos[i] = pos;
+        EMIT_COPIES(key + AT_BEFORE);
+        if (!ssa->removed[i]) {
+            fromOld[pos] = i;
+            jumpOld[pos] = -1;
+            result[pos++] = quadruples[i];
+        }
+        EMIT_COPIES(key + AT_AFTER);
+    }
+    newPos[n] = pos;
+    for (s = 0; s < stubNum; s++) {
+        stubStart[s] = pos;
+        key = 3 * (n + s);
+        EMIT_COPIES(key + AT_AFTER);
+    }
+#undef EMIT_COPIES
+    for (i = 0; i < pos; i++) {
+        if (jumpOld[i] >= 0)
+            result[i].result = intToChar(newPos[jumpOld[i]]);
+        else if (fromOld[i] >= 0 && isJump(result[i].operator) && result[i].result != NULL) {
+            if (retarget[fromOld[i]] >= 0)
+                result[i].result = intToChar(stubStart[retarget[fromOld[i]]]);
+            else if ((target = atoi(result[i].result)) >= 0 && target <= n)
+                result[i].result = intToChar(newPos[target]);
+        }
+    }
+    reserveQuadruples(pos);
+    memcpy(quadruples, result, pos * sizeof(Quadruple));
+    curIndex = pos;
+    free(result);
+    free(jumpOld);
+    free(fromOld);
+    free(stubStart);
+    free(newPos);
+    free(start);
+    free(order);
+    free(ids);
+    free(keys);
+}
+
+/*释放SSA形式及其中的cfg*/
+static void freeSSA(SSA *ssa) {
+    int f;
+    for (f = 0; f < ssa->phiNum; f++)
+        free(ssa->phis[f].args);
+    free(ssa->phis);
+    free(ssa->phiStart);
+    free(ssa->domChildren);
+    free(ssa->domChildStart);
+    free(ssa->executable);
+    free(ssa->removed);
+    free(ssa->use);
+    free(ssa->def);
+    free(ssa->nameDef);
+    free(ssa->nameVar);
+    free(ssa->varNames);
+    freeCFG(ssa->cfg);
+    free(ssa);
+    nameTableClear(&ssaVarTable);
+}
+
+/*离开SSA形式*/
+void destroySSA(SSA *ssa) {
+    CFG *cfg = ssa->cfg;
+    int n = curIndex, nb = cfg->blockNum, entryNum = ssa->varNum;
+    int i, k, b, f, x, p, d, u, last, target, num, key, stubNum = 0;
+    int *home = (int *) malloc((ssa->nameNum + 1) * sizeof(int));/*名字最终存放的变量*/
+    int *phiUse = (int *) calloc(ssa->nameNum + 1, sizeof(int));
+    int *slot = (int *) malloc((ssa->varNum + ssa->nameNum + 1) * sizeof(int));
+    int *retarget = (int *) malloc((n + 1) * sizeof(int));
+    int *dst = (int *) malloc((ssa->varNum + 1) * sizeof(int));
+    int *src = (int *) malloc((ssa->varNum + 1) * sizeof(int));
+    int *liveStart, *liveOut;
+    BasicBlock *block;
+    Quadruple *q;
+    Phi *phi;
+
+    for (x = 0; x < ssa->nameNum; x++)
+        home[x] = ssa->nameVar[x];
+    for (f = 0; f < ssa->phiNum; f++)
+        if (!ssa->phis[f].removed)
+            for (k = 0; k < cfg->blocks[ssa->phis[f].block].predNum + (ssa->phis[f].block == 0); k++)
+                if (ssa->phis[f].args[k] >= 0)
+                    phiUse[ssa->phis[f].args[k]]++;
+    for (x = 0; x < ssa->varNum + ssa->nameNum; x++)
+        slot[x] = -1;
+
+    /*在每个块中逆向扫描，同一变量的两个名字同时活跃时其中一个改用新变量*/
+    liveOut = nameLiveness(ssa, &liveStart);
+    for (b = 0; b < nb; b++) {
+        if (!ssa->executable[b])
+            continue;
+        for (k = liveStart[b]; k < liveStart[b + 1]; k++)
+            setLive(ssa, home, slot, liveOut[k], entryNum, phiUse);
+        for (i = cfg->blocks[b].end - 1; i >= cfg->blocks[b].start; i--) {
+            if (ssa->removed[i])
+                continue;
+            if ((d = ssa->def[i]) >= 0)
+                killLive(ssa, home, slot, d, entryNum, phiUse);
+            for (k = 0; k < 3; k++)
+                if ((u = ssa->use[3 * i + k]) >= 0)
+                    setLive(ssa, home, slot, u, entryNum, phiUse);
+        }
+        for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++)
+            if (!ssa->phis[f].removed)
+                killLive(ssa, home, slot, ssa->phis[f].name, entryNum, phiUse);
+        /*清除块入口处仍活跃的名字*/
+        for (k = liveStart[b]; k < liveStart[b + 1]; k++)
+            slot[home[liveOut[k]]] = -1;
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++)
+            for (k = 0; k < 3 && !ssa->removed[i]; k++)
+                if ((u = ssa->use[3 * i + k]) >= 0)
+                    slot[home[u]] = -1;
+        for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++)
+            slot[home[ssa->phis[f].name]] = -1;
+    }
+    free(liveOut);
+    free(liveStart);
+
+    /*φ函数改为前驱边上的并行复制，两个名字放在同一个变量中时不需要复制*/
+    for (i = 0; i < n; i++)
+        retarget[i] = -1;
+    copyNum = 0;
+    for (b = 0; b < nb; b++) {
+        block = &cfg->blocks[b];
+        if (!ssa->executable[b] || ssa->phiStart[b] == ssa->phiStart[b + 1])
+            continue;
+        for (k = 0; k < block->predNum + (b == 0); k++) {
+            p = k < block->predNum ? block->pred[k] : -1;
+            if (p >= 0 && !ssaEdgeLive(ssa, p, b))
+                continue;
+            num = 0;
+            for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++) {
+                phi = &ssa->phis[f];
+                if (phi->removed || phi->args[k] < 0 || home[phi->args[k]] == home[phi->name])
+                    continue;
+                dst[num] = home[phi->name];
+                src[num++] = home[phi->args[k]];
+            }
+            if (num == 0)
+                continue;
+            if (p < 0) {
+                addParallelCopies(ssa, dst, src, num, AT_ENTRY);
+                continue;
+            }
+            /*确定复制的位置：顺序执行的边放在前驱末尾之后，无条件跳转之前，
+             * 条件跳转的目标边拆出一个新块放在程序末尾*/
+            last = cfg->blocks[p].end - 1;
+            q = &quadruples[last];
+            if (ssa->removed[last] || !isJump(q->operator))
+                key = 3 * last + AT_AFTER;
+            else if (!isCondJump(q->operator))
+                key = 3 * last + AT_BEFORE;
+            else if (cfg->blockOf[target = atoi(q->result)] == p + 1) {
+                /*两个后继相同的条件跳转没有作用*/
+                ssa->removed[last] = TRUE;
+                key = 3 * last + AT_AFTER;
+            } else if (block->start == cfg->blocks[p].end)
+                key = 3 * last + AT_AFTER;
+            else {
+                retarget[last] = stubNum;
+                key = 3 * (n + stubNum++) + AT_AFTER;
+                addParallelCopies(ssa, dst, src, num, key);
+                addCopy(key, target, "j", NULL, NULL);
+                continue;
+            }
+            addParallelCopies(ssa, dst, src, num, key);
+        }
+    }
+
+    /*按最终的变量改写四元式，删除两边是同一变量的复制*/
+    for (b = 0; b < nb; b++) {
+        if (!ssa->executable[b])
+            continue;
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+            q = &quadruples[i];
+            if (ssa->removed[i])
+                continue;
+            if (ssa->use[3 * i] >= 0)
+                q->arg1 = ssa->varNames[home[ssa->use[3 * i]]];
+            if (ssa->use[3 * i + 1] >= 0)
+                q->arg2 = ssa->varNames[home[ssa->use[3 * i + 1]]];
+            if (ssa->use[3 * i + 2] >= 0)
+                q->result = ssa->varNames[home[ssa->use[3 * i + 2]]];
+            if ((d = ssa->def[i]) >= 0) {
+                q->result = ssa->varNames[home[d]];
+                if (strcmp(q->operator, ":=") == 0 && ssa->use[3 * i] >= 0 &&
+                    home[ssa->use[3 * i]] == home[d])
+                    ssa->removed[i] = TRUE;
+            }
+        }
+    }
+    rebuildQuadruples(ssa, retarget, stubNum);
+
+    free(copies);
+    copies = NULL;
+    copyNum = 0;
+    copyCapacity = 0;
+    free(src);
+    free(dst);
+    free(retarget);
+    free(slot);
+    free(phiUse);
+    free(home);
+    freeSSA(ssa);
+}
+
+/*输出名字，形式为变量名.编号，入口初值只输出变量名*/
+static void printName(SSA *ssa, FILE *file, int x, char *text) {
+    if (x < 0)
+        fprintf(file, "%s", text == NULL ? "_" : text);
+    else if (ssa->nameDef[x] == -1)
+        fprintf(file, "%s", ssa->varNames[ssa->nameVar[x]]);
+    else
+        fprintf(file, "%s.%d", ssa->varNames[ssa->nameVar[x]], x);
+}
+
+/*以文本形式输出SSA形式*/
+void printSSA(SSA *ssa, FILE *file) {
+    CFG *cfg = ssa->cfg;
+    int b, f, k, i;
+    Quadruple *q;
+    for (b = 0; b < cfg->blockNum; b++) {
+        if (!ssa->executable[b])
+            continue;
+        fprintf(file, "B%d:\n", b);
+        for (f = ssa->phiStart[b]; f < ssa->phiStart[b + 1]; f++) {
+            if (ssa->phis[f].removed)
+                continue;
+            fprintf(file, "       ");
+            printName(ssa, file, ssa->phis[f].name, NULL);
+            fprintf(file, " = phi(");
+            for (k = 0; k < cfg->blocks[b].predNum + (b == 0); k++) {
+                if (k > 0)
+                    fprintf(file, ", ");
+                printName(ssa, file, ssa->phis[f].args[k], "?");
+            }
+            fprintf(file, ")\n");
+        }
+        for (i = cfg->blocks[b].start; i < cfg->blocks[b].end; i++) {
+            if (ssa->removed[i])
+                continue;
+            q = &quadruples[i];
+            fprintf(file, "%3d:  %5s  ", i, q->operator);
+            printName(ssa, file, ssa->use[3 * i], q->arg1);
+            fprintf(file, ",");
+            printName(ssa, file, ssa->use[3 * i + 1], q->arg2);
+            fprintf(file, ",");
+            if (ssa->def[i] >= 0)
+                printName(ssa, file, ssa->def[i], q->result);
+            else
+                printName(ssa, file, ssa->use[3 * i + 2], q->result);
+            fprintf(file, "\n");
+        }
+    }
+}
+
+/*定值-使用链*/
+int *ssaUses(SSA *ssa, int **start) {
+    CFG *cfg = ssa->cfg;
+    int n = curIndex, num = 3 * n, i, k, f, u, argNum;
+    int *keys, *sites, *result;
+    for (f = 0; f < ssa->phiNum; f++)
+        num += cfg->blocks[ssa->phis[f].block].predNum + 1;
+    keys = (int *) malloc((num + 1) * sizeof(int));
+    sites = (int *) malloc((num + 1) * sizeof(int));
+    num = 0;
+    for (i = 0; i < n; i++)
+        for (k = 0; k < 3; k++)
+            if ((u = ssa->use[3 * i + k]) >= 0) {
+                keys[num] = u;
+                sites[num++] = i;
+            }
+    for (f = 0; f < ssa->phiNum; f++) {
+        argNum = cfg->blocks[ssa->phis[f].block].predNum + (ssa->phis[f].block == 0);
+        for (k = 0; k < argNum; k++)
+            if ((u = ssa->phis[f].args[k]) >= 0) {
+                keys[num] = u;
+                sites[num++] = -1 - f;
+            }
+    }
+    result = groupPairs(keys, sites, num, ssa->nameNum, start);
+    free(sites);
+    free(keys);
+    return result;
+}
@@ -0,0 +1,60 @@
+//
+// Created by liang on 2020/7/9.
+//
+
+#ifndef TINY_SSA_H
+#define TINY_SSA_H
+
+#include <stdio.h>
+#include "cfg.h"
+
+/*φ函数，args[k]为所在块第k个前驱传来的SSA名字，前驱不可达时为-1。
+ * 入口块（块0）多一个参数args[predNum]，对应程序入口处变量的初值*/
+typedef struct PhiRec {
+    int var;/*原变量*/
+    int name;/*φ定值的SSA名字*/
+    int block;
+    int *args;
+    int removed;/*被稀疏优化删除*/
+} Phi;
+
+/*四元式的SSA形式：四元式本身不变，另外记录每个操作数对应的SSA名字。
+ * 名字0到varNum-1是各变量在程序入口处的初值*/
+typedef struct SSARec {
+    CFG *cfg;
+    int varNum;
+    char **varNames;
+    int nameNum;
+    int *nameVar;/*名字对应的原变量*/
+    int *nameDef;/*名字的定值：四元式下标，φ定值为-2-φ编号，入口初值为-1*/
+    int *def;/*def[i]为第i条四元式定值的名字，没有时为-1*/
+    int *use;/*use[3*i+k]为第i条四元式arg1、arg2、result（OUT）使用的名字，常量为-1*/
+    int *removed;/*被删除的四元式*/
+    int *executable;/*可能执行的基本块*/
+    Phi *phis;/*按基本块排列的φ函数*/
+    int phiNum;
+    int *phiStart;/*块b的φ函数为phis[phiStart[b]]到phis[phiStart[b+1]-1]*/
+    int *domChildStart;/*支配树：块b的孩子为domChildren[domChildStart[b]]起的若干个*/
+    int *domChildren;
+} SSA;
+
+/*在cfg上构造剪枝的SSA形式：在迭代支配边界上放置φ函数，
+ * 只保留变量在入口处活跃的φ函数，然后沿支配树重命名*/
+SSA *buildSSA(CFG *cfg);
+
+/*离开SSA形式：把φ函数改为前驱边上的复制（关键边被拆开），
+ * 同一变量的名字在活跃区间不相交时合并回原变量，相交的名字改用新变量，
+ * 然后按稀疏优化的结果重建四元式数组。之后ssa和其中的cfg被释放*/
+void destroySSA(SSA *ssa);
+
+/*定值-使用链：返回按名字分组的使用点，名字x的使用点从(*start)[x]到(*start)[x+1]-1，
+ * 四元式中的使用记为四元式下标，φ的参数记为-1-φ编号*/
+int *ssaUses(SSA *ssa, int **start);
+
+/*判断从块p到块s的边在当前（可能已被改写的）四元式下是否仍然存在*/
+int ssaEdgeLive(SSA *ssa, int p, int s);
+
+/*以文本形式输出SSA形式，φ函数和名字写为x.n*/
+void printSSA(SSA *ssa, FILE *file);
+
+#endif //TINY_SSA_H
@@ -0,0 +1,337 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "globals.h"
+#include "translate.h"
+#include "stats.h"
+#include "trace.h"
+
+THREAD_LOCAL CompileStats stats;
+
+/*正在计时的阶段，phaseStack[phaseDepth - 1]为当前阶段。阶段最多嵌套三层*/
+#define MAX_PHASE_DEPTH 4
+static THREAD_LOCAL Phase phaseStack[MAX_PHASE_DEPTH];
+static THREAD_LOCAL int phaseDepth = 0;
+static THREAD_LOCAL double wallStart, cpuStart;
+static THREAD_LOCAL long long perfStart[PERF_NUM];
+
+static const char *phaseNames[PHASE_NUM] = {
+        "scan", "parse", "analyze", "codegen", "optimize", "output"
+};
+
+static double clockSeconds(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*开始一次编译的统计*/
+void statsReset(void) {
+    memset(&stats, 0, sizeof(stats));
+    phaseDepth = 0;
+    if (CollectCounters)
+        perfOpen();
+}
+
+/*把上次读取以来的硬件计数加到阶段phase上，add为FALSE时只记下当前值*/
+static void addCounters(Phase phase, int add) {
+    long long values[PERF_NUM];
+    int i;
+    if (!CollectCounters)
+        return;
+    perfRead(values);
+    for (i = 0; i < PERF_NUM; i++) {
+        if (add && values[i] >= 0)
+            stats.counters[phase][i] += values[i] - perfStart[i];
+        perfStart[i] = values[i];
+    }
+}
+
+/*线程的CPU时间要用系统调用读取，每个单词读一次太慢，所以扫描的CPU时间算在语法分析中，
+ * 输出时再按两者的墙钟时间分开*/
+void statsBegin(Phase phase) {
+    double wall;
+    if (!CollectStats)
+        return;
+    wall = clockSeconds(CLOCK_MONOTONIC);
+    if (phaseDepth > 0)
+        stats.wall[phaseStack[phaseDepth - 1]] += wall - wallStart;
+    wallStart = wall;
+    if (phase != PHASE_SCAN) {
+        double cpu = clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+        if (phaseDepth > 0)
+            stats.cpu[phaseStack[phaseDepth - 1]] += cpu - cpuStart;
+        cpuStart = cpu;
+        addCounters(phaseDepth > 0 ? phaseStack[phaseDepth - 1] : phase, phaseDepth > 0);
+    }
+    phaseStack[phaseDepth++] = phase;
+}
+
+/*离开当前阶段*/
+void statsEnd(void) {
+    double wall;
+    Phase phase;
+    if (!CollectStats || phaseDepth == 0)
+        return;
+    phase = phaseStack[--phaseDepth];
+    wall = clockSeconds(CLOCK_MONOTONIC);
+    stats.wall[phase] += wall - wallStart;
+    wallStart = wall;
+    if (phase != PHASE_SCAN) {
+        double cpu = clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+        stats.cpu[phase] += cpu - cpuStart;
+        cpuStart = cpu;
+        addCounters(phase, TRUE);
+    }
+}
+
+/*各阶段的CPU时间，语法分析的CPU时间按墙钟时间分给扫描*/
+static void phaseCpu(double *cpu) {
+    double both = stats.wall[PHASE_SCAN] + stats.wall[PHASE_PARSE];
+    memcpy(cpu, stats.cpu, sizeof(stats.cpu));
+    cpu[PHASE_SCAN] = both > 0 ? stats.cpu[PHASE_PARSE] * stats.wall[PHASE_SCAN] / both : 0;
+    cpu[PHASE_PARSE] = stats.cpu[PHASE_PARSE] - cpu[PHASE_SCAN];
+}
+
+/*优化后的四元式按操作符计数，按第一次出现的顺序排列*/
+typedef struct OpCountRec {
+    const char *op;
+    long count;
+} OpCount;
+
+static int countOperators(OpCount **counts) {
+    OpCount *c = NULL;
+    int i, k, num = 0;
+    for (i = 0; i < curIndex; i++) {
+        for (k = 0; k < num && strcmp(c[k].op, quadruples[i].operator) != 0; k++);
+        if (k == num) {
+            c = (OpCount *) realloc(c, (num + 1) * sizeof(OpCount));
+            c[num].op = quadruples[i].operator;
+            c[num++].count = 0;
+        }
+        c[k].count++;
+    }
+    *counts = c;
+    return num;
+}
+
+/*进程的峰值常驻内存，单位KB*/
+static long peakMemory(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static long sumCounts(const long *counts, int num) {
+    long total = 0;
+    int i;
+    for (i = 0; i < num; i++)
+        total += counts[i];
+    return total;
+}
+
+/*按-ftime-report的格式输出*/
+void statsPrint(FILE *file) {
+    double cpu[PHASE_NUM], wallTotal = 0, cpuTotal = 0;
+    OpCount *ops;
+    int i, opNum = countOperators(&ops);
+    phaseCpu(cpu);
+    for (i = 0; i < PHASE_NUM; i++) {
+        wallTotal += stats.wall[i];
+        cpuTotal += cpu[i];
+    }
+    fprintf(file, "\nExecution times (seconds)\n");
+    fprintf(file, " %-12s %10s %10s %6s\n", "phase", "wall", "cpu", "%wall");
+    for (i = 0; i < PHASE_NUM; i++)
+        fprintf(file, " %-12s %10.6f %10.6f %5.1f%%\n", phaseNames[i], stats.wall[i], cpu[i],
+                wallTotal > 0 ? stats.wall[i] * 100 / wallTotal : 0.0);
+    fprintf(file, " %-12s %10.6f %10.6f\n", "TOTAL", wallTotal, cpuTotal);
+
+    fprintf(file, "\nCounters\n");
+    fprintf(file, " %-24s %10ld\n", "tokens", stats.tokens);
+    fprintf(file, " %-24s %10ld\n", "syntax tree nodes",
+            sumCounts(stats.stmtNodes, TypeK + 1) + sumCounts(stats.expNodes, BoolK + 1));
+    for (i = 0; i <= TypeK; i++)
+        if (stats.stmtNodes[i] > 0)
+            fprintf(file, "   %-22s %10ld\n", stmtKindNames[i], stats.stmtNodes[i]);
+    for (i = 0; i <= BoolK; i++)
+        if (stats.expNodes[i] > 0)
+            fprintf(file, "   %-22s %10ld\n", expKindNames[i], stats.expNodes[i]);
+    fprintf(file, " %-24s %10ld\n", "symbol table probes", stats.symtabProbes);
+    fprintf(file, " %-24s %10ld\n", "symbol table collisions", stats.symtabCollisions);
+    fprintf(file, " %-24s %10ld\n", "quadruples generated", stats.quadruples);
+    fprintf(file, " %-24s %10d\n", "quadruples final", curIndex);
+    for (i = 0; i < opNum; i++)
+        fprintf(file, "   %-22s %10ld\n", ops[i].op, ops[i].count);
+    fprintf(file, " %-24s %10ld\n", "temporaries", stats.temporaries);
+    fprintf(file, " %-24s %10ld\n", "backpatches", stats.backpatches);
+    fprintf(file, " %-24s %10ld\n", "peak memory (KB)", peakMemory());
+    free(ops);
+}
+
+/*硬件计数的表格中，扫描和语法分析合为一行*/
+static const char *counterPhaseNames[PHASE_NUM] = {
+        "", "scan+parse", "analyze", "codegen", "optimize", "output"
+};
+
+static void printCounter(FILE *file, PerfCounter counter, double value, const char *format) {
+    if (perfAvailable(counter))
+        fprintf(file, format, value);
+    else
+        fprintf(file, " %14s", "n/a");
+}
+
+static void printIPC(FILE *file, const long long *counts) {
+    if (perfAvailable(PERF_CYCLES) && perfAvailable(PERF_INSTRUCTIONS) && counts[PERF_CYCLES] > 0)
+        fprintf(file, " %6.2f", (double) counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES]);
+    else
+        fprintf(file, " %6s", "n/a");
+}
+
+/*每个阶段按什么计算平均值：扫描和语法分析按单词，分析和翻译按语法树节点，
+ * 优化按生成的四元式，输出按优化后的四元式*/
+static long phaseUnits(Phase phase, const char **unit) {
+    switch (phase) {
+        case PHASE_SCAN:
+        case PHASE_PARSE:
+            *unit = "token";
+            return stats.tokens;
+        case PHASE_ANALYZE:
+        case PHASE_CODEGEN:
+            *unit = "node";
+            return sumCounts(stats.stmtNodes, TypeK + 1) + sumCounts(stats.expNodes, BoolK + 1);
+        case PHASE_OPTIMIZE:
+            *unit = "quad";
+            return stats.quadruples;
+        default:
+            *unit = "quad";
+            return curIndex;
+    }
+}
+
+/*输出各阶段的硬件计数*/
+void statsPrintCounters(FILE *file) {
+    long long total[PERF_NUM] = {0};
+    const char *unit;
+    long units;
+    int i, k;
+    if (perfOpen() == 0) {
+        fprintf(file, "\nHardware counters unavailable (see /proc/sys/kernel/perf_event_paranoid)\n");
+        return;
+    }
+    fprintf(file, "\nHardware counters (user space)\n %-12s", "phase");
+    for (k = 0; k < PERF_NUM; k++) {
+        fprintf(file, " %14s", perfNames[k]);
+        if (k == PERF_INSTRUCTIONS)
+            fprintf(file, " %6s", "IPC");
+    }
+    fprintf(file, "\n");
+    for (i = PHASE_PARSE; i <= PHASE_NUM; i++) {
+        const long long *counts = i < PHASE_NUM ? stats.counters[i] : total;
+        fprintf(file, " %-12s", i < PHASE_NUM ? counterPhaseNames[i] : "TOTAL");
+        for (k = 0; k < PERF_NUM; k++) {
+            if (i < PHASE_NUM)
+                total[k] += counts[k];
+            printCounter(file, k, (double) counts[k], " %14.0f");
+            if (k == PERF_INSTRUCTIONS)
+                printIPC(file, counts);
+        }
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "\nPer unit\n %-12s %-6s", "phase", "unit");
+    for (k = 0; k < PERF_NUM; k++)
+        fprintf(file, " %14s", perfNames[k]);
+    fprintf(file, "\n");
+    for (i = PHASE_PARSE; i < PHASE_NUM; i++) {
+        units = phaseUnits(i, &unit);
+        fprintf(file, " %-12s %-6s", counterPhaseNames[i], unit);
+        for (k = 0; k < PERF_NUM; k++)
+            printCounter(file, k, units > 0 ? (double) stats.counters[i][k] / units : 0.0, " %14.3f");
+        fprintf(file, "\n");
+    }
+}
+
+/*输出JSON字符串*/
+static void printJSONString(FILE *file, const char *s) {
+    fputc('"', file);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(file, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+            fprintf(file, "\\u%04x", (unsigned char) *s);
+        else
+            fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+/*输出一组按名字的计数*/
+static void printJSONCounts(FILE *file, const char **names, const long *counts, int num) {
+    int i, first = TRUE;
+    fprintf(file, "{");
+    for (i = 0; i < num; i++)
+        if (counts[i] > 0) {
+            fprintf(file, "%s\"%s\": %ld", first ? "" : ", ", names[i], counts[i]);
+            first = FALSE;
+        }
+    fprintf(file, "}");
+}
+
+/*输出JSON*/
+void statsPrintJSON(FILE *file, const char *pgm) {
+    double cpu[PHASE_NUM];
+    OpCount *ops;
+    int i, opNum = countOperators(&ops);
+    phaseCpu(cpu);
+    fprintf(file, "{\n  \"file\": ");
+    printJSONString(file, pgm);
+    fprintf(file, ",\n  \"phases\": {");
+    for (i = 0; i < PHASE_NUM; i++)
+        fprintf(file, "%s\n    \"%s\": {\"wall\": %.9f, \"cpu\": %.9f}", i == 0 ? "" : ",",
+                phaseNames[i], stats.wall[i], cpu[i]);
+    fprintf(file, "\n  },\n  \"counters\": {\n");
+    fprintf(file, "    \"tokens\": %ld,\n", stats.tokens);
+    fprintf(file, "    \"stmtNodes\": ");
+    printJSONCounts(file, stmtKindNames, stats.stmtNodes, TypeK + 1);
+    fprintf(file, ",\n    \"expNodes\": ");
+    printJSONCounts(file, expKindNames, stats.expNodes, BoolK + 1);
+    fprintf(file, ",\n    \"symtabProbes\": %ld,\n", stats.symtabProbes);
+    fprintf(file, "    \"symtabCollisions\": %ld,\n", stats.symtabCollisions);
+    fprintf(file, "    \"quadruplesGenerated\": %ld,\n", stats.quadruples);
+    fprintf(file, "    \"quadruplesFinal\": %d,\n", curIndex);
+    fprintf(file, "    \"quadruplesByOperator\": {");
+    for (i = 0; i < opNum; i++) {
+        fprintf(file, "%s", i == 0 ? "" : ", ");
+        printJSONString(file, ops[i].op);
+        fprintf(file, ": %ld", ops[i].count);
+    }
+    fprintf(file, "},\n");
+    fprintf(file, "    \"temporaries\": %ld,\n", stats.temporaries);
+    fprintf(file, "    \"backpatches\": %ld,\n", stats.backpatches);
+    fprintf(file, "    \"peakMemoryKB\": %ld\n", peakMemory());
+    fprintf(file, "  }");
+    if (CollectCounters) {
+        /*不可用的计数器为null，扫描的计数在parse中*/
+        fprintf(file, ",\n  \"hardware\": {");
+        for (i = PHASE_PARSE; i < PHASE_NUM; i++) {
+            fprintf(file, "%s\n    \"%s\": {", i == PHASE_PARSE ? "" : ",", phaseNames[i]);
+            for (int k = 0; k < PERF_NUM; k++) {
+                fprintf(file, "%s\"%s\": ", k == 0 ? "" : ", ", perfNames[k]);
+                if (perfAvailable(k))
+                    fprintf(file, "%lld", stats.counters[i][k]);
+                else
+                    fprintf(file, "null");
+            }
+            fprintf(file, "}");
+        }
+        fprintf(file, "\n  }");
+    }
+    fprintf(file, "\n}\n");
+    free(ops);
+}
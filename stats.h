@@ -0,0 +1,51 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_STATS_H
+#define TINY_STATS_H
+
+#include "globals.h"
+#include "perf.h"
+
+/*编译的各个阶段。扫描在语法分析中按需进行，计时时从语法分析中扣除*/
+typedef enum {
+    PHASE_SCAN, PHASE_PARSE, PHASE_ANALYZE, PHASE_CODEGEN, PHASE_OPTIMIZE, PHASE_OUTPUT, PHASE_NUM
+} Phase;
+
+/*一次编译的统计，计数总是进行，计时只在CollectStats为TRUE时进行*/
+typedef struct CompileStatsRec {
+    double wall[PHASE_NUM];/*秒*/
+    double cpu[PHASE_NUM];
+    long tokens;
+    long stmtNodes[TypeK + 1];/*按StmtKind*/
+    long expNodes[BoolK + 1];/*按ExpKind*/
+    long symtabProbes;/*插入和查找的次数*/
+    long symtabCollisions;/*查找时跳过的其他名字*/
+    long quadruples;/*优化前生成的四元式条数*/
+    long temporaries;
+    long backpatches;/*回填的跳转*/
+    long long counters[PHASE_NUM][PERF_NUM];/*CollectCounters为TRUE时各阶段的硬件计数，扫描的计数在语法分析中*/
+} CompileStats;
+
+extern THREAD_LOCAL CompileStats stats;
+
+/*开始一次编译的统计*/
+void statsReset(void);
+
+/*进入阶段phase，暂停当前阶段的计时。阶段可以嵌套*/
+void statsBegin(Phase phase);
+
+/*离开当前阶段，继续外层阶段的计时*/
+void statsEnd(void);
+
+/*按-ftime-report的格式输出各阶段的时间和计数，四元式按优化后的操作符统计*/
+void statsPrint(FILE *file);
+
+/*输出各阶段的硬件计数、IPC和每个单词、语法树节点或四元式的缺失次数*/
+void statsPrintCounters(FILE *file);
+
+/*输出同样内容的JSON，pgm为源文件名*/
+void statsPrintJSON(FILE *file, const char *pgm);
+
+#endif //TINY_STATS_H
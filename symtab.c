@@ -4,7 +4,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "globals.h"
 #include "symtab.h"
+#include "outbuf.h"
+#include "stats.h"
+#include "trace.h"
+
+static THREAD_LOCAL BucketList hashTable[SIZE];
 
 int hash(char *key) {
     int temp = 0;
@@ -20,8 +26,12 @@ void symTabInsert(char *name, int lineno, int loc) {
     int index = hash(name);
     BucketList bucketList = hashTable[index];
     /*寻找正确的表项*/
-    while ((bucketList != NULL) && (strcmp(name, bucketList->name) != 0))
+    stats.symtabProbes++;
+    while ((bucketList != NULL) && (strcmp(name, bucketList->name) != 0)) {
         bucketList = bucketList->next;
+        stats.symtabCollisions++;
+    }
+    TRACE_EVENT(TRACE_ANALYZE, EV_SYM_INSERT, lineno, bucketList == NULL ? loc : bucketList->memloc, 0, name);
     if (bucketList == NULL) {
         bucketList = (BucketList) malloc(sizeof(struct BucketListRec));
         bucketList->name = name;
@@ -45,31 +55,67 @@ void symTabInsert(char *name, int lineno, int loc) {
 int symTabLookUp(char *name) {
     int index = hash(name);
     BucketList bucketList = hashTable[index];
-    while ((bucketList != NULL) && (strcmp(name, bucketList->name) != 0))
+    stats.symtabProbes++;
+    while ((bucketList != NULL) && (strcmp(name, bucketList->name) != 0)) {
         bucketList = bucketList->next;
+        stats.symtabCollisions++;
+    }
+    TRACE_EVENT(TRACE_ANALYZE, EV_SYM_LOOKUP, 0, bucketList == NULL ? -1 : bucketList->memloc, 0, name);
     if (bucketList == NULL)
         return -1;
     return bucketList->memloc;
 }
 
+/*清空符号表，变量名属于语法树，不在这里释放*/
+void symTabClear(void) {
+    int i;
+    BucketList bucketList;
+    LineList lineList;
+    for (i = 0; i < SIZE; ++i) {
+        while (hashTable[i] != NULL) {
+            bucketList = hashTable[i];
+            hashTable[i] = bucketList->next;
+            while (bucketList->lines != NULL) {
+                lineList = bucketList->lines;
+                bucketList->lines = lineList->next;
+                free(lineList);
+            }
+            free(bucketList);
+        }
+    }
+}
+
 void printSymTab(FILE *listing) {
+    OutBuf *out = outOpen(listing);
     int i;
-    fprintf(listing, "Variable Name  Location   Line Numbers\n");
-    fprintf(listing, "-------------  --------   ------------\n");
+    outPuts(out, "Variable Name  Location   Line Numbers\n");
+    outPuts(out, "-------------  --------   ------------\n");
     for (i = 0; i < SIZE; ++i) {
         if (hashTable[i] != NULL) {
             BucketList bucketList = hashTable[i];
             while (bucketList != NULL) {
                 LineList lineList = bucketList->lines;
-                fprintf(listing, "%-14s ", bucketList->name);
-                fprintf(listing, "%-8d  ", bucketList->memloc);
+                outStrPad(out, bucketList->name, -14);
+                outChar(out, ' ');
+                outIntPad(out, bucketList->memloc, -8);
+                outSpaces(out, 2);
                 while (lineList != NULL) {
-                    fprintf(listing, "%4d ", lineList->lineno);
+                    outIntPad(out, lineList->lineno, 4);
+                    outChar(out, ' ');
                     lineList = lineList->next;
                 }
-                fprintf(listing, "\n");
+                outChar(out, '\n');
                 bucketList = bucketList->next;
             }
         }
     }
+}
+
+/*按printSymTab的顺序访问符号表中的每个名字*/
+void symTabVisit(void (*visit)(BucketList bucket, void *arg), void *arg) {
+    BucketList bucketList;
+    int i;
+    for (i = 0; i < SIZE; ++i)
+        for (bucketList = hashTable[i]; bucketList != NULL; bucketList = bucketList->next)
+            visit(bucketList, arg);
 }
\ No newline at end of file
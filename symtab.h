@@ -18,13 +18,16 @@ typedef struct BucketListRec {
     struct BucketListRec *next;
 } *BucketList;
 
-static BucketList hashTable[SIZE];
-
-
 void symTabInsert(char *name, int lineno, int loc);
 
 int symTabLookUp(char *name);
 
+/*清空符号表，编译下一个文件之前调用*/
+void symTabClear(void);
+
 void printSymTab(FILE *listing);
 
+/*按printSymTab的顺序访问符号表中的每个名字*/
+void symTabVisit(void (*visit)(BucketList bucket, void *arg), void *arg);
+
 #endif //TINY_SYMTAB_H
@@ -0,0 +1,71 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_TINY_H
+#define TINY_TINY_H
+
+#include <stddef.h>
+
+/*libtiny：在内存中编译TINY程序。源程序从缓冲区读入，所有输出都放在返回的TinyResult中，
+ * 不读写文件。编译状态和选项都是线程局部的，多个线程可以同时调用tinyCompile*/
+
+/*编译选项，TinyOptions为NULL时使用tinyDefaultOptions的值*/
+typedef struct TinyOptionsRec {
+    const char *name;/*源程序的名字，只用于清单和TM代码中的注释*/
+    int optimize;/*优化四元式*/
+    int emitC;/*同时翻译为C*/
+    int trace;/*清单中的跟踪级别（见globals.h），0时清单中只有错误*/
+} TinyOptions;
+
+/*四元式，字符串属于TinyResult*/
+typedef struct TinyQuadRec {
+    const char *op;
+    const char *arg1;
+    const char *arg2;
+    const char *result;
+    int line;/*生成它的源程序行*/
+} TinyQuad;
+
+typedef struct TinySymbolRec {
+    const char *name;
+    int location;
+    const int *lines;/*出现的行*/
+    int lineNum;
+} TinySymbol;
+
+typedef struct TinyDiagnosticRec {
+    int line;
+    const char *message;
+} TinyDiagnostic;
+
+/*编译结果，用tinyFree释放。出错时只有listing和diagnostics*/
+typedef struct TinyResultRec {
+    int ok;
+    TinyQuad *quads;/*优化后的四元式*/
+    int quadNum;
+    char *code;/*TM代码，以'\0'结束*/
+    size_t codeSize;
+    unsigned char *bytecode;/*.tnb格式的字节码*/
+    size_t bytecodeSize;
+    char *ccode;/*emitC时为C代码，否则为NULL*/
+    size_t ccodeSize;
+    char *listing;
+    size_t listingSize;
+    TinyDiagnostic *diagnostics;
+    int diagnosticNum;
+    TinySymbol *symbols;
+    int symbolNum;
+    void *arena;/*四元式、符号和错误信息中的字符串所在的内存*/
+} TinyResult;
+
+/*返回默认选项：名字为input.tny，优化，不翻译为C，不输出跟踪*/
+TinyOptions tinyDefaultOptions(void);
+
+/*编译text中的size个字节，返回的结果由调用者用tinyFree释放*/
+TinyResult *tinyCompile(const char *text, size_t size, const TinyOptions *options);
+
+/*释放编译结果*/
+void tinyFree(TinyResult *result);
+
+#endif //TINY_TINY_H
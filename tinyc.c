@@ -0,0 +1,97 @@
+//
+// Created by liang on 2020/7/16.
+//
+/*编译守护进程的客户端：tinyc [-c] <filename>
+ * 用法和输出与tiny相同：清单写到stdout，生成<name>.tm、<name>.tnb，-c时还生成<name>.c，
+ * 但编译由tiny -d启动的守护进程完成，省去每次启动编译器的开销。套接字由TINY_SOCKET指定。
+ * 守护进程没有运行或者使用其他选项（-r、-j、-b、.tnb文件）时直接执行tiny*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "globals.h"
+#include "client.h"
+
+/*把参数原样交给tiny*/
+static void execTiny(char *argv[]) {
+    char *tiny = clientTinyPath(argv[0]);
+    argv[0] = tiny;
+    execvp(tiny, argv);
+    fprintf(stderr, "Unable to run %s\n", tiny);
+    exit(1);
+}
+
+/*读入整个文件，找不到时返回NULL*/
+static char *readFile(const char *name, size_t *len) {
+    FILE *file = fopen(name, "rb");
+    char *text = NULL;
+    size_t capacity = 0, n;
+    *len = 0;
+    if (file == NULL)
+        return NULL;
+    do {
+        if (*len == capacity) {
+            capacity = capacity == 0 ? 65536 : capacity * 2;
+            text = (char *) realloc(text, capacity);
+        }
+        n = fread(text + *len, 1, capacity - *len, file);
+        *len += n;
+    } while (n > 0);
+    fclose(file);
+    return text;
+}
+
+/*把回答的一部分写到<name>ext，打不开时与tiny一样在清单中报告*/
+static int writePart(const char *pgm, const char *ext, const char *data, size_t size) {
+    const char *slash = strrchr(pgm, '/'), *dot = strrchr(pgm, '.');
+    size_t baseLen = dot != NULL && (slash == NULL || dot > slash) ? (size_t) (dot - pgm) : strlen(pgm);
+    char *name = (char *) malloc(baseLen + strlen(ext) + 1);
+    FILE *file;
+    memcpy(name, pgm, baseLen);
+    strcpy(name + baseLen, ext);
+    file = fopen(name, "wb");
+    if (file == NULL) {
+        printf("Unable to open %s\n", name);
+        free(name);
+        return FALSE;
+    }
+    fwrite(data, 1, size, file);
+    fclose(file);
+    free(name);
+    return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+    ClientResult result;
+    unsigned flags = 0;
+    char *pgm, *text;
+    size_t len;
+    if (argc == 3 && strcmp(argv[1], "-c") == 0)
+        flags = DAEMON_EMIT_C;
+    else if (argc != 2)
+        execTiny(argv);
+    pgm = (char *) malloc(strlen(argv[argc - 1]) + 5);
+    strcpy(pgm, argv[argc - 1]);
+    if (strlen(pgm) > 4 && strcmp(pgm + strlen(pgm) - 4, ".tnb") == 0)
+        execTiny(argv);
+    if (strchr(pgm, '.') == NULL)
+        strcat(pgm, ".tny");
+    text = readFile(pgm, &len);
+    if (text == NULL) {
+        fprintf(stderr, "File %s not found\n", pgm);
+        exit(1);
+    }
+    if (!clientCompile(clientSocketPath(), pgm, text, len, flags, &result))
+        execTiny(argv);
+    fwrite(result.part[DAEMON_LISTING], 1, result.header.size[DAEMON_LISTING], stdout);
+    /*与tiny一样，依次打开输出文件，有一个打不开就停止*/
+    if (result.header.status == DAEMON_OK
+        && writePart(pgm, ".tm", result.part[DAEMON_CODE], result.header.size[DAEMON_CODE])
+        && writePart(pgm, ".tnb", result.part[DAEMON_BINARY], result.header.size[DAEMON_BINARY])
+        && (flags & DAEMON_EMIT_C))
+        writePart(pgm, ".c", result.part[DAEMON_CCODE], result.header.size[DAEMON_CCODE]);
+    clientFree(&result);
+    free(text);
+    free(pgm);
+    return 0;
+}
@@ -0,0 +1,251 @@
+//
+// Created by liang on 2020/7/16.
+//
+/*TINY程序生成器：tinygen [-l lines] [-d depth] [-e operands] [-v idents] [-c comments] [-s strings] [-r seed]
+ * 在stdout上输出一个语法正确的TINY程序，大约lines行（默认1000，可以到数百万行，边生成边输出）。
+ * -d：if、repeat、do-while的最大嵌套深度（默认4）
+ * -e：算术表达式中的操作数个数（默认4）
+ * -v：变量个数（默认16）
+ * -c：注释行占的百分比（默认5）
+ * -s：字符串赋值占赋值语句的百分比（默认5）
+ * -r：随机数种子，同样的参数和种子生成同样的程序。
+ * 循环都用各自的计数器控制次数，除数都是非零常数，生成的程序可以在虚拟机上运行结束*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DEPTH 64
+
+static long lines = 1000;
+static int maxDepth = 4;
+static int operands = 4;
+static int idents = 16;
+static int commentPercent = 5;
+static int stringPercent = 5;
+static unsigned long seed = 1;
+
+static long lineCount = 0;/*已经输出的行数*/
+
+/*xorshift随机数，不依赖C库的rand，不同平台上结果相同*/
+static unsigned long nextRandom(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+/*0到n - 1之间的随机数*/
+static int randomInt(int n) {
+    return (int) (nextRandom() % (unsigned long) n);
+}
+
+static int percent(int p) {
+    return randomInt(100) < p;
+}
+
+static void indent(int depth) {
+    int i;
+    for (i = 0; i < depth; i++)
+        fputs("  ", stdout);
+}
+
+static void endLine(void) {
+    putchar('\n');
+    lineCount++;
+}
+
+static void variable(void) {
+    printf("v%d", randomInt(idents));
+}
+
+/*操作数：变量或常数*/
+static void operand(void) {
+    if (percent(60))
+        variable();
+    else
+        printf("%d", randomInt(100));
+}
+
+/*n个操作数的算术表达式，以变量或常数开头，后面的操作数可以是括号中的子表达式。
+ * 除法的除数总是非零常数*/
+static void expression(int n) {
+    static const char *ops[] = {"+", "-", "*", "+", "-"};
+    int k;
+    operand();
+    for (n--; n > 0; n -= k) {
+        if (percent(10)) {
+            printf(" / %d", randomInt(9) + 1);
+            k = 1;
+            continue;
+        }
+        printf(" %s ", ops[randomInt(5)]);
+        k = n >= 3 && percent(30) ? 2 + randomInt(n - 1) : 1;
+        if (k > 1) {
+            putchar('(');
+            expression(k);
+            putchar(')');
+        } else
+            operand();
+    }
+}
+
+/*条件：比较，可以用and、or、not连接*/
+static void condition(void) {
+    static const char *relops[] = {"<", ">", "=", "<=", ">="};
+    int n = percent(30) ? 2 : 1, i;
+    for (i = 0; i < n; i++) {
+        if (i > 0)
+            fputs(percent(50) ? " and " : " or ", stdout);
+        if (percent(10))
+            fputs("not ", stdout);
+        expression(operands > 2 ? 2 : operands);
+        printf(" %s ", relops[randomInt(5)]);
+        expression(operands > 2 ? 2 : operands);
+    }
+}
+
+static void statements(int depth, int n);
+
+/*注释行*/
+static void comment(int depth) {
+    indent(depth);
+    printf("{ generated comment %ld }", lineCount);
+    endLine();
+}
+
+/*一条语句，depth为当前的嵌套深度*/
+static void statement(int depth) {
+    int r = randomInt(100);
+    if (percent(commentPercent))
+        comment(depth);
+    if (depth < maxDepth && r < 10) {
+        indent(depth);
+        fputs("if ", stdout);
+        condition();
+        fputs(" then", stdout);
+        endLine();
+        statements(depth + 1, 1 + randomInt(3));
+        if (percent(40)) {
+            indent(depth);
+            fputs("else", stdout);
+            endLine();
+            statements(depth + 1, 1 + randomInt(3));
+        }
+        indent(depth);
+        fputs("end;", stdout);
+        endLine();
+    } else if (depth < maxDepth && r < 18) {
+        /*每层循环用自己的计数器k<depth>，最多执行2到4次*/
+        int doWhile = percent(50);
+        indent(depth);
+        printf("k%d := 0;", depth);
+        endLine();
+        indent(depth);
+        fputs(doWhile ? "do" : "repeat", stdout);
+        endLine();
+        statements(depth + 1, 1 + randomInt(3));
+        indent(depth + 1);
+        printf("k%d := k%d + 1;", depth, depth);
+        endLine();
+        indent(depth);
+        printf("%s k%d < %d;", doWhile ? "while" : "until", depth, 2 + randomInt(3));
+        endLine();
+    } else if (r < 24) {
+        indent(depth);
+        fputs("write ", stdout);
+        expression(operands);
+        putchar(';');
+        endLine();
+    } else if (r < 26) {
+        indent(depth);
+        fputs("read ", stdout);
+        variable();
+        putchar(';');
+        endLine();
+    } else if (percent(stringPercent)) {
+        indent(depth);
+        printf("s%d := 'text %d';", randomInt(4), randomInt(1000));
+        endLine();
+    } else {
+        indent(depth);
+        variable();
+        fputs(" := ", stdout);
+        expression(operands);
+        putchar(';');
+        endLine();
+    }
+}
+
+static void statements(int depth, int n) {
+    int i;
+    for (i = 0; i < n; i++)
+        statement(depth);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-l lines] [-d depth] [-e operands] [-v idents] [-c comments] [-s strings] [-r seed]\n",
+            name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 == argc)
+            usage(argv[0]);
+        switch (argv[++i - 1][1]) {
+            case 'l':
+                lines = atol(argv[i]);
+                break;
+            case 'd':
+                maxDepth = atoi(argv[i]);
+                break;
+            case 'e':
+                operands = atoi(argv[i]);
+                break;
+            case 'v':
+                idents = atoi(argv[i]);
+                break;
+            case 'c':
+                commentPercent = atoi(argv[i]);
+                break;
+            case 's':
+                stringPercent = atoi(argv[i]);
+                break;
+            case 'r':
+                seed = strtoul(argv[i], NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (maxDepth < 0 || maxDepth > MAX_DEPTH || operands < 1 || idents < 1)
+        usage(argv[0]);
+    /*种子为0时xorshift只产生0*/
+    seed = seed * 2654435761ul + 1;
+
+    printf("{Generated by tinygen -l %ld -d %d -e %d -v %d -c %d -s %d}", lines, maxDepth, operands, idents,
+           commentPercent, stringPercent);
+    endLine();
+    fputs("int", stdout);
+    for (i = 0; i < idents; i++)
+        printf("%s v%d", i == 0 ? "" : ",", i);
+    for (i = 0; i < maxDepth; i++)
+        printf(", k%d", i);
+    putchar(';');
+    endLine();
+    fputs("string s0, s1, s2, s3;", stdout);
+    endLine();
+    /*先给所有变量赋初值*/
+    for (i = 0; i < idents; i++) {
+        printf("v%d := %d;", i, i + 1);
+        endLine();
+    }
+    while (lineCount < lines)
+        statement(0);
+    for (i = 0; i < idents && i < 4; i++) {
+        printf("write v%d;", i);
+        endLine();
+    }
+    return 0;
+}
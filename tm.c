@@ -0,0 +1,263 @@
+//
+// Created by liang on 2020/7/13.
+//
+/*TM模拟器：tm [-s] <filename>
+ * 读入TM指令时一次解码到数组中，执行时直接按操作码分派，不再解析文本。
+ * IN从stdin读入整数，OUT每行输出一个整数；-s在stderr上输出执行的指令数和存储器访问次数。
+ * 运行错误的退出码与虚拟机相同：除零为1，输入错误为2，其他错误为3*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define IADDR_SIZE 65536 /* increase for large programs */
+#define DADDR_SIZE 65536 /* increase for large programs */
+#define NO_REGS 8
+#define PC_REG 7
+
+typedef enum {
+    opHALT, opIN, opOUT, opADD, opSUB, opMUL, opDIV,
+    opLD, opST, opLDA, opLDC, opJLT, opJLE, opJGT, opJGE, opJEQ, opJNE
+} OpCode;
+
+static const char *opCodeTab[] = {
+        "HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV",
+        "LD", "ST", "LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE"
+};
+
+#define OP_NUM ((int) (sizeof(opCodeTab) / sizeof(opCodeTab[0])))
+
+/*运行结果*/
+#define TM_OK 0
+#define TM_ZERO_DIV 1
+#define TM_BAD_INPUT 2
+#define TM_IMEM_ERR 3
+#define TM_DMEM_ERR 4
+
+/*解码后的指令，RO型为op r,s,t；RM型为op r,t(s)*/
+typedef struct {
+    int op;
+    int r, s, t;
+} Instruction;
+
+static Instruction iMem[IADDR_SIZE];
+static int iNum;
+static int dMem[DADDR_SIZE];
+static int reg[NO_REGS];
+
+/*统计*/
+static long long steps, loads, stores;
+
+/*读入一个整数，成功时返回TRUE*/
+static int readInt(char **p, int *value) {
+    char *end;
+    long v;
+    while (isspace((unsigned char) **p))
+        (*p)++;
+    v = strtol(*p, &end, 10);
+    if (end == *p)
+        return FALSE;
+    *p = end;
+    *value = (int) v;
+    return TRUE;
+}
+
+/*跳过空白后读入一个字符c*/
+static int skipChar(char **p, char c) {
+    while (isspace((unsigned char) **p))
+        (*p)++;
+    if (**p != c)
+        return FALSE;
+    (*p)++;
+    return TRUE;
+}
+
+/*读入并解码全部指令，出错时返回FALSE*/
+static int readInstructions(FILE *file) {
+    char line[512], name[8], *p;
+    int lineNo = 0, loc, op, k, r, s, t;
+    for (loc = 0; loc < IADDR_SIZE; loc++) {
+        iMem[loc].op = opHALT;
+        iMem[loc].r = 0;
+        iMem[loc].s = 0;
+        iMem[loc].t = 0;
+    }
+    iNum = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNo++;
+        p = line;
+        while (isspace((unsigned char) *p))
+            p++;
+        /*超过缓冲区的行：注释跳过其余部分，指令行不会这么长*/
+        if (strchr(line, '\n') == NULL && !feof(file)) {
+            if (*p != '*') {
+                fprintf(stderr, "Line %d too long\n", lineNo);
+                return FALSE;
+            }
+            while ((k = fgetc(file)) != EOF && k != '\n');
+            continue;
+        }
+        if (*p == '*' || *p == '\0')
+            continue;
+        if (!readInt(&p, &loc) || loc < 0 || loc >= IADDR_SIZE || !skipChar(&p, ':')) {
+            fprintf(stderr, "Bad location at line %d\n", lineNo);
+            return FALSE;
+        }
+        while (isspace((unsigned char) *p))
+            p++;
+        for (k = 0; k < 7 && isalpha((unsigned char) p[k]); k++)
+            name[k] = p[k];
+        name[k] = '\0';
+        p += k;
+        for (op = 0; op < OP_NUM && strcmp(opCodeTab[op], name) != 0; op++);
+        if (op == OP_NUM) {
+            fprintf(stderr, "Illegal opcode %s at line %d\n", name, lineNo);
+            return FALSE;
+        }
+        if (!readInt(&p, &r) || !skipChar(&p, ',') || !readInt(&p, op < opLD ? &s : &t)
+            || !(op < opLD ? skipChar(&p, ',') : skipChar(&p, '('))
+            || !readInt(&p, op < opLD ? &t : &s) || (op >= opLD && !skipChar(&p, ')'))) {
+            fprintf(stderr, "Bad operands at line %d\n", lineNo);
+            return FALSE;
+        }
+        if (r < 0 || r >= NO_REGS || (op != opLDC && (s < 0 || s >= NO_REGS))
+            || (op < opLD && (t < 0 || t >= NO_REGS))) {
+            fprintf(stderr, "Bad register at line %d\n", lineNo);
+            return FALSE;
+        }
+        iMem[loc].op = op;
+        iMem[loc].r = r;
+        iMem[loc].s = op == opLDC ? 0 : s;
+        iMem[loc].t = t;
+        if (loc >= iNum)
+            iNum = loc + 1;
+    }
+    return TRUE;
+}
+
+/*整数除法，除数为-1时按补码回绕求相反数*/
+#define DIVIDE(a, b) ((b) == -1 ? (int) (0u - (unsigned) (a)) : (a) / (b))
+
+/*执行程序，返回TM_OK或运行错误*/
+static int run(void) {
+    Instruction *ip;
+    int pc = 0, addr;
+    memset(dMem, 0, sizeof(dMem));
+    memset(reg, 0, sizeof(reg));
+    dMem[0] = DADDR_SIZE - 1;
+    reg[6] = dMem[0];
+    for (;;) {
+        if (pc < 0 || pc >= IADDR_SIZE)
+            return TM_IMEM_ERR;
+        ip = &iMem[pc];
+        reg[PC_REG] = ++pc;
+        steps++;
+        switch (ip->op) {
+            case opHALT:
+                return TM_OK;
+            case opIN:
+                if (scanf("%d", &reg[ip->r]) != 1)
+                    return TM_BAD_INPUT;
+                break;
+            case opOUT:
+                printf("%d\n", reg[ip->r]);
+                break;
+            case opADD:
+                reg[ip->r] = (int) ((unsigned) reg[ip->s] + (unsigned) reg[ip->t]);
+                break;
+            case opSUB:
+                reg[ip->r] = (int) ((unsigned) reg[ip->s] - (unsigned) reg[ip->t]);
+                break;
+            case opMUL:
+                reg[ip->r] = (int) ((unsigned) reg[ip->s] * (unsigned) reg[ip->t]);
+                break;
+            case opDIV:
+                if (reg[ip->t] == 0)
+                    return TM_ZERO_DIV;
+                reg[ip->r] = DIVIDE(reg[ip->s], reg[ip->t]);
+                break;
+            case opLD:
+                addr = ip->t + reg[ip->s];
+                if (addr < 0 || addr >= DADDR_SIZE)
+                    return TM_DMEM_ERR;
+                reg[ip->r] = dMem[addr];
+                loads++;
+                break;
+            case opST:
+                addr = ip->t + reg[ip->s];
+                if (addr < 0 || addr >= DADDR_SIZE)
+                    return TM_DMEM_ERR;
+                dMem[addr] = reg[ip->r];
+                stores++;
+                break;
+            case opLDA:
+                reg[ip->r] = (int) ((unsigned) ip->t + (unsigned) reg[ip->s]);
+                break;
+            case opLDC:
+                reg[ip->r] = ip->t;
+                break;
+            case opJLT:
+                if (reg[ip->r] < 0)
+                    reg[PC_REG] = ip->t + reg[ip->s];
+                break;
+            case opJLE:
+                if (reg[ip->r] <= 0)
+                    reg[PC_REG] = ip->t + reg[ip->s];
+                break;
+            case opJGT:
+                if (reg[ip->r] > 0)
+                    reg[PC_REG] = ip->t + reg[ip->s];
+                break;
+            case opJGE:
+                if (reg[ip->r] >= 0)
+                    reg[PC_REG] = ip->t + reg[ip->s];
+                break;
+            case opJEQ:
+                if (reg[ip->r] == 0)
+                    reg[PC_REG] = ip->t + reg[ip->s];
+                break;
+            case opJNE:
+                if (reg[ip->r] != 0)
+                    reg[PC_REG] = ip->t + reg[ip->s];
+                break;
+            default:
+                return TM_IMEM_ERR;
+        }
+        pc = reg[PC_REG];
+    }
+}
+
+int main(int argc, char *argv[]) {
+    static const char *errors[] = {"", "division by zero", "bad input",
+                                   "instruction memory fault", "data memory fault"};
+    FILE *file;
+    int stats = FALSE, status;
+    if (argc == 3 && strcmp(argv[1], "-s") == 0)
+        stats = TRUE;
+    else if (argc != 2) {
+        fprintf(stderr, "usage: %s [-s] <filename>\n", argv[0]);
+        exit(1);
+    }
+    file = fopen(argv[argc - 1], "r");
+    if (file == NULL) {
+        fprintf(stderr, "File %s not found\n", argv[argc - 1]);
+        exit(1);
+    }
+    if (!readInstructions(file))
+        exit(3);
+    fclose(file);
+    status = run();
+    fflush(stdout);
+    if (status != TM_OK)
+        fprintf(stderr, "Runtime error: %s\n", errors[status]);
+    if (stats)
+        fprintf(stderr, "%lld instructions, %lld loads, %lld stores\n", steps, loads, stores);
+    return status > TM_IMEM_ERR ? TM_IMEM_ERR : status;
+}
@@ -0,0 +1,582 @@
+//
+// Created by liang on 2020/7/13.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "translate.h"
+#include "bytecode.h"
+#include "tmgen.h"
+#include "outbuf.h"
+
+/*TM的操作码，HALT到DIV为寄存器型（RO），其余为寄存器-存储器型（RM）*/
+typedef enum {
+    TM_HALT, TM_IN, TM_OUT, TM_ADD, TM_SUB, TM_MUL, TM_DIV,
+    TM_LD, TM_ST, TM_LDA, TM_LDC, TM_JLT, TM_JLE, TM_JGT, TM_JGE, TM_JEQ, TM_JNE
+} TMOpcode;
+
+static const char *tmNames[] = {
+        "HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV",
+        "LD", "ST", "LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE"
+};
+
+/*分配给变量的寄存器*/
+#define TM_REG_NUM 5
+static const int allocRegs[TM_REG_NUM] = {2, 3, 4, 5, 6};
+
+/*注释中每行列出的寄存器分配个数*/
+#define REGS_PER_LINE 8
+
+/*循环深度的权值上限，避免溢出*/
+#define MAX_WEIGHT_DEPTH 6
+
+/*生成的TM指令。RO型为op r,s,t；RM型为op r,t(s)。
+ * target不为-1时t由第target条虚拟机指令的位置回填（相对pc的跳转）*/
+typedef struct {
+    TMOpcode op;
+    int r, s, t;
+    int target;
+    int from;/*对应的虚拟机指令*/
+} TMInstr;
+
+static THREAD_LOCAL TMInstr *tm;
+static THREAD_LOCAL int tmNum;
+static THREAD_LOCAL int tmCapacity;
+static THREAD_LOCAL int curFrom;
+
+static THREAD_LOCAL VMProgram *curProg;
+static THREAD_LOCAL int *regOf;/*变量所在的寄存器，在存储器中时为-1*/
+static THREAD_LOCAL int *addrOf;/*变量在数据存储器中的地址*/
+static THREAD_LOCAL char *isConst;
+
+static void emitTM(TMOpcode op, int r, int s, int t, int target) {
+    if (tmNum == tmCapacity) {
+        tmCapacity = tmCapacity == 0 ? 256 : tmCapacity * 2;
+        tm = (TMInstr *) realloc(tm, tmCapacity * sizeof(TMInstr));
+    }
+    tm[tmNum].op = op;
+    tm[tmNum].r = r;
+    tm[tmNum].s = s;
+    tm[tmNum].t = t;
+    tm[tmNum].target = target;
+    tm[tmNum].from = curFrom;
+    tmNum++;
+}
+
+/*读写存储器中的变量，地址相对于执行时的pc（即下一条指令的位置）*/
+static void emitMem(TMOpcode op, int r, int slot) {
+    emitTM(op, r, TM_PC, addrOf[slot] - (tmNum + 1), -1);
+}
+
+/*取操作数：在寄存器中的直接返回，常量和存储器中的变量装入scratch*/
+static int fetch(int slot, int scratch) {
+    if (isConst[slot]) {
+        emitTM(TM_LDC, scratch, 0, curProg->init[slot], -1);
+        return scratch;
+    }
+    if (regOf[slot] >= 0)
+        return regOf[slot];
+    emitMem(TM_LD, scratch, slot);
+    return scratch;
+}
+
+/*结果写到的寄存器：变量在存储器中时先写到ac*/
+static int destReg(int slot) {
+    return regOf[slot] >= 0 ? regOf[slot] : TM_AC;
+}
+
+/*结果在寄存器r中，变量在存储器中时写回*/
+static void store(int slot, int r) {
+    if (regOf[slot] < 0)
+        emitMem(TM_ST, r, slot);
+}
+
+/*把num个(key, value)对按key分组：第k组为list[first[k]]到list[first[k + 1] - 1]，first有keyNum+1个元素*/
+static int *groupByKey(int num, const int *keys, const int *values, int keyNum, int *first) {
+    int i, k;
+    int *list = (int *) malloc((num + 1) * sizeof(int));
+    for (k = 0; k <= keyNum; k++)
+        first[k] = 0;
+    for (i = 0; i < num; i++)
+        first[keys[i] + 1]++;
+    for (k = 0; k < keyNum; k++)
+        first[k + 1] += first[k];
+    for (i = 0; i < num; i++)
+        list[first[keys[i]]++] = values[i];
+    for (k = keyNum; k > 0; k--)
+        first[k] = first[k - 1];
+    first[0] = 0;
+    return list;
+}
+
+/*活跃区间上的线性扫描：按起点处理区间，寄存器不够时换出权值最小的区间（包括当前区间），
+ * 被换出的变量整个放在存储器中。第i条指令读操作数的位置为2i，写结果的位置为2i+1，
+ * 所以在一条指令中结束的区间可以把寄存器让给在这条指令中定值的变量。
+ * 活跃分析逐个变量进行，只处理在某个块中定值前被使用、可能跨块活跃的变量，
+ * 代价与活跃范围的大小成正比，与块数和变量数的乘积无关*/
+static void allocateRegisters(VMProgram *prog) {
+    int n = prog->codeNum, slotNum = prog->regNum;
+    int i, b, j, k, p, s, v, top, blockNum, edgeNum, useNum, defNum, activeNum, addr, victim, depth;
+    int *blockStart, *blockOf, *start, *end, *order, *bucket, *diff, active[TM_REG_NUM], regUsed[TM_REG_NUM];
+    int *edgeFrom, *edgeTo, *predFirst, *preds;
+    int *useSlot, *useBlock, *useFirst, *useList, *defSlot, *defBlock, *defFirst, *defList;
+    int *useMark, *defMark, *inMark, *killMark, *work;
+    double *weight, scale;
+    VMInstr *ins;
+    char *leader = (char *) calloc(n + 1, sizeof(char));
+
+    /*基本块*/
+    leader[0] = TRUE;
+    for (i = 0; i < n; i++) {
+        ins = &prog->code[i];
+        if (ins->op >= OP_JMP && ins->op <= OP_JGE) {
+            leader[ins->c] = TRUE;
+            leader[i + 1] = TRUE;
+        } else if (ins->op == OP_HALT)
+            leader[i + 1] = TRUE;
+    }
+    blockStart = (int *) malloc((n + 2) * sizeof(int));
+    blockOf = (int *) malloc((n + 1) * sizeof(int));
+    blockNum = 0;
+    for (i = 0; i < n; i++) {
+        if (leader[i])
+            blockStart[blockNum++] = i;
+        blockOf[i] = blockNum - 1;
+    }
+    blockStart[blockNum] = n;
+
+    /*块的前驱：块的后继由最后一条指令决定*/
+    edgeFrom = (int *) malloc((2 * blockNum + 1) * sizeof(int));
+    edgeTo = (int *) malloc((2 * blockNum + 1) * sizeof(int));
+    edgeNum = 0;
+    for (b = 0; b < blockNum; b++) {
+        ins = &prog->code[blockStart[b + 1] - 1];
+        if (ins->op >= OP_JMP && ins->op <= OP_JGE) {
+            edgeFrom[edgeNum] = b;
+            edgeTo[edgeNum++] = blockOf[ins->c];
+        }
+        if (ins->op != OP_JMP && ins->op != OP_HALT && b + 1 < blockNum) {
+            edgeFrom[edgeNum] = b;
+            edgeTo[edgeNum++] = b + 1;
+        }
+    }
+    predFirst = (int *) malloc((blockNum + 1) * sizeof(int));
+    preds = groupByKey(edgeNum, edgeTo, edgeFrom, blockNum, predFirst);
+
+    /*每个块中定值前的使用（向上暴露的使用）和定值，每个变量在每个块中至多记录一次*/
+    useSlot = (int *) malloc((2 * n + 1) * sizeof(int));
+    useBlock = (int *) malloc((2 * n + 1) * sizeof(int));
+    defSlot = (int *) malloc((n + 1) * sizeof(int));
+    defBlock = (int *) malloc((n + 1) * sizeof(int));
+    useMark = (int *) malloc((slotNum + 1) * sizeof(int));
+    defMark = (int *) malloc((slotNum + 1) * sizeof(int));
+    for (s = 0; s < slotNum; s++)
+        useMark[s] = defMark[s] = -1;
+    useNum = defNum = 0;
+#define USE(x) do { \
+        if ((x) >= 0 && !isConst[x] && defMark[x] != b && useMark[x] != b) { \
+            useMark[x] = b; \
+            useSlot[useNum] = (x); \
+            useBlock[useNum++] = b; \
+        } \
+    } while (0)
+#define DEF(x) do { \
+        if (defMark[x] != b) { \
+            defMark[x] = b; \
+            defSlot[defNum] = (x); \
+            defBlock[defNum++] = b; \
+        } \
+    } while (0)
+    for (b = 0; b < blockNum; b++)
+        for (i = blockStart[b]; i < blockStart[b + 1]; i++) {
+            ins = &prog->code[i];
+            switch (ins->op) {
+                case OP_JMP:
+                case OP_HALT:
+                    break;
+                case OP_OUT:
+                case OP_OUTS:
+                    USE(ins->a);
+                    break;
+                case OP_IN:
+                    DEF(ins->c);
+                    break;
+                default:
+                    USE(ins->a);
+                    USE(ins->b);
+                    if (ins->op < OP_JMP)
+                        DEF(ins->c);
+                    break;
+            }
+        }
+#undef USE
+#undef DEF
+    useFirst = (int *) malloc((slotNum + 1) * sizeof(int));
+    useList = groupByKey(useNum, useSlot, useBlock, slotNum, useFirst);
+    defFirst = (int *) malloc((slotNum + 1) * sizeof(int));
+    defList = groupByKey(defNum, defSlot, defBlock, slotNum, defFirst);
+
+    /*循环深度：回边target<=i覆盖的指令深度加一*/
+    diff = (int *) calloc(n + 2, sizeof(int));
+    for (i = 0; i < n; i++) {
+        ins = &prog->code[i];
+        if (ins->op >= OP_JMP && ins->op <= OP_JGE && ins->c <= i) {
+            diff[ins->c]++;
+            diff[i + 1]--;
+        }
+    }
+
+    /*活跃区间（按读写位置）和权值*/
+    start = (int *) malloc((slotNum + 1) * sizeof(int));
+    end = (int *) malloc((slotNum + 1) * sizeof(int));
+    weight = (double *) calloc(slotNum + 1, sizeof(double));
+    for (s = 0; s < slotNum; s++) {
+        start[s] = 2 * n;
+        end[s] = -1;
+    }
+#define OCCUR(x, p) do { \
+        if ((x) >= 0 && !isConst[x]) { \
+            if (start[x] > (p)) \
+                start[x] = (p); \
+            if (end[x] < (p)) \
+                end[x] = (p); \
+            weight[x] += scale; \
+        } \
+    } while (0)
+    depth = 0;
+    for (i = 0; i < n; i++) {
+        depth += diff[i];
+        scale = 1;
+        for (k = 0; k < depth && k < MAX_WEIGHT_DEPTH; k++)
+            scale *= 10;
+        ins = &prog->code[i];
+        if (ins->op == OP_JMP || ins->op == OP_HALT)
+            continue;
+        if (ins->op == OP_OUT || ins->op == OP_OUTS) {
+            OCCUR(ins->a, 2 * i);
+            continue;
+        }
+        if (ins->op != OP_IN) {
+            OCCUR(ins->a, 2 * i);
+            OCCUR(ins->b, 2 * i);
+        }
+        if (ins->op < OP_JMP || ins->op == OP_IN)
+            OCCUR(ins->c, 2 * i + 1);
+    }
+#undef OCCUR
+
+    /*逐个变量从向上暴露的使用所在的块沿前驱反向传播，到定值的块为止。
+     * 区间延伸到变量活跃进入的块的开头和活跃离开的块的末尾*/
+    inMark = (int *) malloc((blockNum + 1) * sizeof(int));
+    killMark = (int *) malloc((blockNum + 1) * sizeof(int));
+    work = (int *) malloc((blockNum + 1) * sizeof(int));
+    for (b = 0; b < blockNum; b++)
+        inMark[b] = killMark[b] = -1;
+    for (s = 0; s < slotNum; s++) {
+        if (useFirst[s] == useFirst[s + 1])
+            continue;
+        for (k = defFirst[s]; k < defFirst[s + 1]; k++)
+            killMark[defList[k]] = s;
+        top = 0;
+        for (k = useFirst[s]; k < useFirst[s + 1]; k++) {
+            inMark[useList[k]] = s;
+            work[top++] = useList[k];
+        }
+        while (top > 0) {
+            b = work[--top];
+            if (start[s] > 2 * blockStart[b])
+                start[s] = 2 * blockStart[b];
+            for (j = predFirst[b]; j < predFirst[b + 1]; j++) {
+                p = preds[j];
+                if (end[s] < 2 * blockStart[p + 1] - 1)
+                    end[s] = 2 * blockStart[p + 1] - 1;
+                if (killMark[p] != s && inMark[p] != s) {
+                    inMark[p] = s;
+                    work[top++] = p;
+                }
+            }
+        }
+    }
+
+    /*按区间起点做计数排序，然后线性扫描*/
+    bucket = (int *) calloc(2 * n + 2, sizeof(int));
+    order = (int *) malloc((slotNum + 1) * sizeof(int));
+    for (s = 0; s < slotNum; s++)
+        if (end[s] >= 0)
+            bucket[start[s] + 1]++;
+    for (i = 0; i < 2 * n; i++)
+        bucket[i + 1] += bucket[i];
+    for (s = 0; s < slotNum; s++)
+        if (end[s] >= 0)
+            order[bucket[start[s]]++] = s;
+    for (s = 0; s < slotNum; s++)
+        regOf[s] = -1;
+    for (k = 0; k < TM_REG_NUM; k++)
+        regUsed[k] = FALSE;
+    activeNum = 0;
+    for (i = 0; i < bucket[2 * n]; i++) {
+        s = order[i];
+        for (k = 0; k < activeNum;) {
+            if (end[active[k]] < start[s]) {
+                for (v = 0; v < TM_REG_NUM; v++)
+                    if (allocRegs[v] == regOf[active[k]])
+                        regUsed[v] = FALSE;
+                active[k] = active[--activeNum];
+            } else
+                k++;
+        }
+        for (v = 0; v < TM_REG_NUM && regUsed[v]; v++);
+        if (v < TM_REG_NUM) {
+            regUsed[v] = TRUE;
+            regOf[s] = allocRegs[v];
+            active[activeNum++] = s;
+            continue;
+        }
+        victim = 0;
+        for (k = 1; k < activeNum; k++)
+            if (weight[active[k]] < weight[active[victim]])
+                victim = k;
+        if (weight[active[victim]] < weight[s]) {
+            regOf[s] = regOf[active[victim]];
+            regOf[active[victim]] = -1;
+            active[victim] = s;
+        }
+    }
+    /*不在寄存器中的变量分配存储器地址，地址0保留给TM存放存储器大小*/
+    addr = 1;
+    for (s = 0; s < slotNum; s++)
+        addrOf[s] = !isConst[s] && regOf[s] < 0 ? addr++ : -1;
+    /*入口处活跃的寄存器变量需要初值0*/
+    for (s = 0; s < slotNum; s++)
+        if (regOf[s] >= 0 && start[s] == 0)
+            emitTM(TM_LDC, regOf[s], 0, 0, -1);
+
+    free(order);
+    free(bucket);
+    free(work);
+    free(killMark);
+    free(inMark);
+    free(weight);
+    free(end);
+    free(start);
+    free(diff);
+    free(defList);
+    free(defFirst);
+    free(useList);
+    free(useFirst);
+    free(defMark);
+    free(useMark);
+    free(defBlock);
+    free(defSlot);
+    free(useBlock);
+    free(useSlot);
+    free(preds);
+    free(predFirst);
+    free(edgeTo);
+    free(edgeFrom);
+    free(blockOf);
+    free(blockStart);
+    free(leader);
+}
+
+/*条件跳转对应的TM跳转，reverse为TRUE时是交换两个操作数后的跳转*/
+static TMOpcode jumpOf(int op, int reverse) {
+    static const TMOpcode direct[] = {TM_JEQ, TM_JLT, TM_JGT, TM_JLE, TM_JGE};
+    static const TMOpcode reversed[] = {TM_JEQ, TM_JGT, TM_JLT, TM_JGE, TM_JLE};
+    return reverse ? reversed[op - OP_JEQ] : direct[op - OP_JEQ];
+}
+
+/*条件跳转。TM只能和0比较，a-b可能溢出，所以先比较符号：
+ * 符号不同时结果由a的符号决定，符号相同时a-b不会溢出。和0比较的直接跳转*/
+static void genCondJump(VMInstr *ins) {
+    int a = ins->a, b = ins->b, reverse = FALSE, ra, rb, c;
+    TMOpcode jump;
+    if (isConst[a] && !isConst[b]) {
+        a = ins->b;
+        b = ins->a;
+        reverse = TRUE;
+    }
+    jump = jumpOf(ins->op, reverse);
+    if (isConst[b]) {
+        c = curProg->init[b];
+        ra = fetch(a, TM_AC);
+        if (c > 0) {
+            /*a<0时a<c*/
+            if (jump == TM_JLT || jump == TM_JLE)
+                emitTM(TM_JLT, ra, TM_PC, 0, ins->c);
+            else
+                emitTM(TM_JLT, ra, TM_PC, 2, -1);
+        } else if (c < 0) {
+            /*a>=0时a>c*/
+            if (jump == TM_JGT || jump == TM_JGE)
+                emitTM(TM_JGE, ra, TM_PC, 0, ins->c);
+            else
+                emitTM(TM_JGE, ra, TM_PC, 2, -1);
+        }
+        if (c != 0) {
+            emitTM(TM_LDA, TM_AC, ra, (int) (0u - (unsigned) c), -1);
+            ra = TM_AC;
+        }
+        emitTM(jump, ra, TM_PC, 0, ins->c);
+        return;
+    }
+    ra = fetch(a, TM_AC);
+    rb = fetch(b, TM_AC1);
+    emitTM(TM_JGE, ra, TM_PC, 2, -1);
+    /*a<0<=b*/
+    if (jump == TM_JLT || jump == TM_JLE)
+        emitTM(TM_JGE, rb, TM_PC, 0, ins->c);
+    else
+        emitTM(TM_JGE, rb, TM_PC, 4, -1);
+    emitTM(TM_LDA, TM_PC, TM_PC, 1, -1);
+    /*b<0<=a*/
+    if (jump == TM_JGT || jump == TM_JGE)
+        emitTM(TM_JLT, rb, TM_PC, 0, ins->c);
+    else
+        emitTM(TM_JLT, rb, TM_PC, 2, -1);
+    emitTM(TM_SUB, TM_AC, ra, rb, -1);
+    emitTM(jump, TM_AC, TM_PC, 0, ins->c);
+}
+
+/*翻译一条虚拟机指令*/
+static void genInstr(VMInstr *ins) {
+    int ra, rb, rd;
+    switch (ins->op) {
+        case OP_MOVE:
+            if (isConst[ins->a]) {
+                rd = destReg(ins->c);
+                emitTM(TM_LDC, rd, 0, curProg->init[ins->a], -1);
+                store(ins->c, rd);
+            } else if (regOf[ins->c] < 0) {
+                store(ins->c, fetch(ins->a, TM_AC));
+            } else if (regOf[ins->a] < 0)
+                emitMem(TM_LD, regOf[ins->c], ins->a);
+            else if (regOf[ins->a] != regOf[ins->c])
+                emitTM(TM_LDA, regOf[ins->c], regOf[ins->a], 0, -1);
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+            /*加减一个常量用LDA完成*/
+            if ((ins->op == OP_ADD || ins->op == OP_SUB) && isConst[ins->b]) {
+                ra = fetch(ins->a, TM_AC);
+                rd = destReg(ins->c);
+                emitTM(TM_LDA, rd, ra,
+                       ins->op == OP_ADD ? curProg->init[ins->b] : (int) (0u - (unsigned) curProg->init[ins->b]), -1);
+            } else if (ins->op == OP_ADD && isConst[ins->a]) {
+                rb = fetch(ins->b, TM_AC);
+                rd = destReg(ins->c);
+                emitTM(TM_LDA, rd, rb, curProg->init[ins->a], -1);
+            } else {
+                ra = fetch(ins->a, TM_AC);
+                rb = fetch(ins->b, TM_AC1);
+                rd = destReg(ins->c);
+                emitTM(TM_ADD + (ins->op - OP_ADD), rd, ra, rb, -1);
+            }
+            store(ins->c, rd);
+            break;
+        case OP_JMP:
+            emitTM(TM_LDA, TM_PC, TM_PC, 0, ins->c);
+            break;
+        case OP_JEQ:
+        case OP_JLT:
+        case OP_JGT:
+        case OP_JLE:
+        case OP_JGE:
+            genCondJump(ins);
+            break;
+        case OP_IN:
+            rd = destReg(ins->c);
+            emitTM(TM_IN, rd, 0, 0, -1);
+            store(ins->c, rd);
+            break;
+        case OP_OUT:
+        case OP_OUTS:
+            /*TM没有字符串，字符串输出为它在字符串表中的下标*/
+            emitTM(TM_OUT, fetch(ins->a, TM_AC), 0, 0, -1);
+            break;
+        case OP_HALT:
+        default:
+            emitTM(TM_HALT, 0, 0, 0, -1);
+            break;
+    }
+}
+
+/*把程序翻译为TM指令写入file*/
+void tmEmit(VMProgram *prog, FILE *file) {
+    OutBuf *out = outOpen(file);
+    int i, s, k, line = 0;
+    int *first = (int *) malloc((prog->codeNum + 1) * sizeof(int));
+    TMInstr *t;
+    curProg = prog;
+    tmNum = 0;
+    curFrom = -1;
+    regOf = (int *) malloc((prog->regNum + 1) * sizeof(int));
+    addrOf = (int *) malloc((prog->regNum + 1) * sizeof(int));
+    isConst = (char *) malloc(prog->regNum + 1);
+    for (s = 0; s < prog->regNum; s++)
+        isConst[s] = isConstant(vmSlotName(prog, s));
+    allocateRegisters(prog);
+    for (i = 0; i < prog->codeNum; i++) {
+        curFrom = i;
+        first[i] = tmNum;
+        genInstr(&prog->code[i]);
+    }
+    first[prog->codeNum] = tmNum;
+
+    if (TRACING(TRACE_CODE, 1)) {
+        /*每行最多REGS_PER_LINE个，注释行不超过模拟器的行缓冲区*/
+        k = 0;
+        for (s = 0; s < prog->regNum; s++)
+            if (regOf[s] >= 0) {
+                if (k % REGS_PER_LINE == 0)
+                    outPuts(out, "* Registers:");
+                outChar(out, ' ');
+                outPuts(out, vmSlotName(prog, s));
+                outChar(out, '=');
+                outInt(out, regOf[s]);
+                if (++k % REGS_PER_LINE == 0)
+                    outChar(out, '\n');
+            }
+        if (k % REGS_PER_LINE != 0)
+            outChar(out, '\n');
+    }
+    for (i = 0; i < tmNum; i++) {
+        t = &tm[i];
+        if (t->target >= 0)
+            t->t = first[t->target] - (i + 1);
+        if (TRACING(TRACE_CODE, 1) && t->from >= 0 && prog->lines[t->from] > 0 && prog->lines[t->from] != line) {
+            line = prog->lines[t->from];
+            outPuts(out, "* line ");
+            outInt(out, line);
+            outChar(out, '\n');
+        }
+        outIntPad(out, i, 3);
+        outPuts(out, ":  ");
+        outStrPad(out, tmNames[t->op], 5);
+        outSpaces(out, 2);
+        outInt(out, t->r);
+        outChar(out, ',');
+        if (t->op < TM_LD) {
+            outInt(out, t->s);
+            outChar(out, ',');
+            outInt(out, t->t);
+        } else {
+            outInt(out, t->t);
+            outChar(out, '(');
+            outInt(out, t->s);
+            outChar(out, ')');
+        }
+        if (TRACING(TRACE_CODE, 1) && t->from >= 0 && (i == 0 || tm[i - 1].from != t->from)) {
+            outPuts(out, " \t");
+            bcPrintInstr(prog, t->from, out);
+        }
+        outChar(out, '\n');
+    }
+    free(isConst);
+    free(addrOf);
+    free(regOf);
+    free(first);
+}
@@ -0,0 +1,21 @@
+//
+// Created by liang on 2020/7/13.
+//
+
+#ifndef TINY_TMGEN_H
+#define TINY_TMGEN_H
+
+#include <stdio.h>
+#include "vm.h"
+
+/*TM的寄存器：7为pc，0和1为运算用的临时寄存器（ac、ac1），其余的分配给变量*/
+#define TM_PC 7
+#define TM_AC 0
+#define TM_AC1 1
+
+/*把程序翻译为TM指令写入file。先对变量的活跃区间做线性扫描，
+ * 把寄存器2到6分给权值（按循环深度加权的出现次数）最大的变量，其余变量放在数据存储器中。
+ * 数据存储器用相对pc的地址访问，所以不需要保留全局指针寄存器*/
+void tmEmit(VMProgram *prog, FILE *file);
+
+#endif //TINY_TMGEN_H
@@ -0,0 +1,169 @@
+//
+// Created by liang on 2020/7/16.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "globals.h"
+#include "trace.h"
+
+typedef struct TraceRecordRec {
+    unsigned long seq;/*写完后为写入位置加一，读取时用来跳过未写完或已被覆盖的记录*/
+    unsigned long time;/*纳秒*/
+    int subsystem;
+    int event;
+    int thread;
+    int line;
+    long a;
+    long b;
+    char text[TRACE_TEXT_LEN];
+} TraceRecord;
+
+static TraceRecord ring[TRACE_RING_SIZE];
+static unsigned long ringHead = 0;/*下一条记录的写入位置，只增不减*/
+static int threadCount = 0;
+static THREAD_LOCAL int threadId = -1;
+
+const char *traceNames[TRACE_NUM] = {
+        "source", "scan", "parse", "analyze", "code", "cfg", "opt"
+};
+const char *stmtKindNames[TypeK + 1] = {
+        "IfK", "RepeatK", "AssignK", "ReadK", "WriteK", "WhileK", "TypeK"
+};
+const char *expKindNames[BoolK + 1] = {
+        "OpK", "ConstNumK", "IdK", "ConstStrK", "BoolK"
+};
+static const char *tokenNames[] = {
+        "ENDFILE", "ERROR", "IF", "THEN", "ELSE", "END", "REPEAT", "UNTIL", "READ", "WRITE",
+        "TRUE", "FALSE", "OR", "AND", "NOT", "INT", "BOOL", "STRING", "DO", "WHILE",
+        "ID", "NUM", "STR",
+        "ASSIGN", "EQ", "LT", "GT", "LTE", "GTE", "PLUS", "MINUS", "TIMES", "OVER", "LPAREN", "RPAREN",
+        "SEMI", "COMMA", "SQM"
+};
+
+/*把一个事件写入跟踪环*/
+void traceRecord(TraceSubsystem subsystem, TraceEvent event, int line, long a, long b, const char *text) {
+    struct timespec ts;
+    unsigned long pos = __atomic_fetch_add(&ringHead, 1, __ATOMIC_RELAXED);
+    TraceRecord *r = &ring[pos & (TRACE_RING_SIZE - 1)];
+    if (threadId < 0)
+        threadId = __atomic_fetch_add(&threadCount, 1, __ATOMIC_RELAXED);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    /*先作废旧记录，写完内容后再发布序号*/
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    r->time = (unsigned long) ts.tv_sec * 1000000000ul + ts.tv_nsec;
+    r->subsystem = subsystem;
+    r->event = event;
+    r->thread = threadId;
+    r->line = line;
+    r->a = a;
+    r->b = b;
+    if (text != NULL) {
+        strncpy(r->text, text, TRACE_TEXT_LEN - 1);
+        r->text[TRACE_TEXT_LEN - 1] = '\0';
+    } else
+        r->text[0] = '\0';
+    __atomic_store_n(&r->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+/*把所有子系统的跟踪级别设为level*/
+void traceSetAll(int level) {
+    int i;
+    for (i = 0; i < TRACE_NUM; i++)
+        traceLevel[i] = level;
+}
+
+/*解析name=level的列表*/
+int traceParseSpec(const char *spec) {
+    const char *p = spec, *eq, *end;
+    int i, level;
+    while (*p != '\0') {
+        eq = strchr(p, '=');
+        end = strchr(p, ',');
+        if (end == NULL)
+            end = p + strlen(p);
+        if (eq == NULL || eq > end || !isdigit((unsigned char) eq[1]))
+            return FALSE;
+        level = atoi(eq + 1);
+        if (eq - p == 3 && strncmp(p, "all", 3) == 0)
+            traceSetAll(level);
+        else {
+            for (i = 0; i < TRACE_NUM; i++)
+                if (strlen(traceNames[i]) == (size_t) (eq - p) && strncmp(p, traceNames[i], eq - p) == 0)
+                    break;
+            if (i == TRACE_NUM)
+                return FALSE;
+            traceLevel[i] = level;
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return TRUE;
+}
+
+/*是否有子系统在记录事件*/
+int traceRecording(void) {
+    int i;
+    for (i = 0; i < TRACE_NUM; i++)
+        if (TRACING(i, 2))
+            return TRUE;
+    return FALSE;
+}
+
+/*格式化一条记录*/
+static void printRecord(FILE *file, const TraceRecord *r, unsigned long start) {
+    fprintf(file, "%10.3f us  T%-2d %-8s %5d  ", (r->time - start) / 1e3, r->thread,
+            traceNames[r->subsystem], r->line);
+    switch (r->event) {
+        case EV_TOKEN:
+            fprintf(file, "token %-8s %s\n",
+                    r->a >= 0 && r->a < (long) (sizeof(tokenNames) / sizeof(tokenNames[0])) ? tokenNames[r->a] : "?",
+                    r->text);
+            break;
+        case EV_NODE:
+            fprintf(file, "node %s\n", r->a == StmtK ? stmtKindNames[r->b] : expKindNames[r->b]);
+            break;
+        case EV_SYM_INSERT:
+            fprintf(file, "insert %s at %ld\n", r->text, r->a);
+            break;
+        case EV_SYM_LOOKUP:
+            fprintf(file, "lookup %s -> %ld\n", r->text, r->a);
+            break;
+        case EV_QUAD:
+            fprintf(file, "quad %ld %s\n", r->a, r->text);
+            break;
+        case EV_BACKPATCH:
+            fprintf(file, "backpatch %ld -> %ld\n", r->a, r->b);
+            break;
+        case EV_OPT_PASS:
+            fprintf(file, "pass %s %ld -> %ld quadruples\n", r->text, r->a, r->b);
+            break;
+        default:
+            fprintf(file, "event %d\n", r->event);
+    }
+}
+
+/*按写入的先后输出环中的记录。读取时记录可能正被覆盖，复制前后序号不变才输出*/
+void traceDump(FILE *file) {
+    unsigned long head = __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE), pos, start = 0, lost;
+    TraceRecord r, *slot;
+    int first = TRUE;
+    pos = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    lost = pos;
+    fprintf(file, "\nTrace events: %lu recorded, %lu overwritten\n", head, lost);
+    for (; pos < head; pos++) {
+        slot = &ring[pos & (TRACE_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+            continue;
+        memcpy(&r, slot, sizeof(r));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != pos + 1)
+            continue;
+        if (first) {
+            start = r.time;
+            first = FALSE;
+        }
+        printRecord(file, &r, start);
+    }
+}
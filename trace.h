@@ -0,0 +1,56 @@
+//
+// Created by liang on 2020/7/16.
+//
+
+#ifndef TINY_TRACE_H
+#define TINY_TRACE_H
+
+#include "globals.h"
+
+/*跟踪级别为2的子系统把事件写入跟踪环：固定大小的二进制记录，写入时只复制参数，
+ * 输出时才格式化。所有线程共用一个环，写入位置用原子加法分配，不加锁；
+ * 环满后覆盖最旧的记录*/
+#define TRACE_RING_SIZE 65536 /* 必须是2的幂 */
+#define TRACE_TEXT_LEN 16
+
+typedef enum {
+    EV_TOKEN,/*扫描到一个单词：a为单词类型，text为单词*/
+    EV_NODE,/*建立语法树节点：a为节点种类，b为语句或表达式的种类*/
+    EV_SYM_INSERT,/*符号表插入：text为名字，a为地址*/
+    EV_SYM_LOOKUP,/*符号表查找：text为名字，a为地址，找不到时为-1*/
+    EV_QUAD,/*生成四元式：a为序号，text为操作符*/
+    EV_BACKPATCH,/*回填：a为四元式序号，b为跳转目标*/
+    EV_OPT_PASS,/*一个优化阶段结束：text为阶段名，a、b为之前和之后的四元式条数*/
+    EV_NUM
+} TraceEvent;
+
+/*子系统的名字，用于-trace选项和输出*/
+extern const char *traceNames[TRACE_NUM];
+
+/*语句和表达式节点种类的名字*/
+extern const char *stmtKindNames[TypeK + 1];
+extern const char *expKindNames[BoolK + 1];
+
+#ifdef NO_TRACE
+#define TRACE_EVENT(subsystem, event, line, a, b, text) ((void) sizeof((a) + (b)))
+#else
+#define TRACE_EVENT(subsystem, event, line, a, b, text) \
+    do { if (TRACING(subsystem, 2)) traceRecord(subsystem, event, line, a, b, text); } while (0)
+#endif
+
+/*把一个事件写入跟踪环，text可以为NULL，超过TRACE_TEXT_LEN - 1的部分截掉*/
+void traceRecord(TraceSubsystem subsystem, TraceEvent event, int line, long a, long b, const char *text);
+
+/*把所有子系统的跟踪级别设为level*/
+void traceSetAll(int level);
+
+/*解析-trace=的参数，如scan=2,code=0或all=1，格式错误时返回FALSE*/
+int traceParseSpec(const char *spec);
+
+/*是否有子系统在记录事件*/
+int traceRecording(void);
+
+/*按写入的先后格式化输出环中的记录，时间从第一条记录算起*/
+void traceDump(FILE *file);
+
+#endif //TINY_TRACE_H
@@ -7,11 +7,114 @@
 #include "globals.h"
 #include "translate.h"
 #include "util.h"
+#include "optimize.h"
+#include "cfg.h"
+#include "peephole.h"
+#include "vm.h"
+#include "bytecode.h"
+#include "aot.h"
+#include "tmgen.h"
+#include "profile.h"
+#include "outbuf.h"
+#include "stats.h"
+#include "trace.h"
 
+/*四元式数组按需倍增，初始容量为LENGTH*/
 #define LENGTH 300
-Quadruple quadruples[LENGTH];
-static int curIndex = 0;
-static int variableNum = 0;
+THREAD_LOCAL Quadruple *quadruples = NULL;
+THREAD_LOCAL int curIndex = 0;
+static THREAD_LOCAL int capacity = 0;
+static THREAD_LOCAL int variableNum = 0;
+/*正在翻译的语句所在的行*/
+static THREAD_LOCAL int curLine = 0;
+
+/*四元式中的字符串都驻留在字符串池中：相同的字符串只保存一份，多次编译之间保留，
+ * 池超过STRING_POOL_LIMIT字节后在下一次编译开始时整体释放。优化时多条四元式可能共用
+ * 一个字符串，所以不单独释放*/
+#define STRING_BLOCK_SIZE 4096
+#define STRING_POOL_LIMIT (1 << 20)
+typedef struct StringBlockRec {
+    struct StringBlockRec *next;
+    size_t used;
+    size_t size;
+    char text[];
+} StringBlock;
+static THREAD_LOCAL StringBlock *stringBlocks = NULL;
+static THREAD_LOCAL size_t stringBytes = 0;
+/*驻留字符串的开放地址散列表，容量为2的幂*/
+static THREAD_LOCAL char **internTable = NULL;
+static THREAD_LOCAL int internCapacity = 0;
+static THREAD_LOCAL int internNum = 0;
+
+/*从字符串池中分配size个字节*/
+static char *newString(size_t size) {
+    StringBlock *b = stringBlocks;
+    if (b == NULL || b->used + size > b->size) {
+        b = (StringBlock *) malloc(sizeof(StringBlock) + (size > STRING_BLOCK_SIZE ? size : STRING_BLOCK_SIZE));
+        b->size = size > STRING_BLOCK_SIZE ? size : STRING_BLOCK_SIZE;
+        b->used = 0;
+        b->next = stringBlocks;
+        stringBlocks = b;
+        stringBytes += b->size;
+    }
+    b->used += size;
+    return b->text + b->used - size;
+}
+
+/*池超过上限时释放所有字符串，在编译开始时调用*/
+static void trimStrings(void) {
+    StringBlock *b;
+    if (stringBytes <= STRING_POOL_LIMIT)
+        return;
+    while (stringBlocks != NULL) {
+        b = stringBlocks;
+        stringBlocks = b->next;
+        free(b);
+    }
+    stringBytes = 0;
+    memset(internTable, 0, internCapacity * sizeof(char *));
+    internNum = 0;
+}
+
+static unsigned stringHash(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s)
+        h = (h ^ (unsigned char) *s++) * 16777619u;
+    return h;
+}
+
+/*散列表的容量加倍*/
+static void growIntern(void) {
+    char **old = internTable;
+    int i, h, oldCapacity = internCapacity;
+    internCapacity = oldCapacity == 0 ? 1024 : oldCapacity * 2;
+    internTable = (char **) calloc(internCapacity, sizeof(char *));
+    for (i = 0; i < oldCapacity; i++)
+        if (old[i] != NULL) {
+            h = (int) (stringHash(old[i]) & (internCapacity - 1));
+            while (internTable[h] != NULL)
+                h = (h + 1) & (internCapacity - 1);
+            internTable[h] = old[i];
+        }
+    free(old);
+}
+
+/*返回字符串池中与s相同的字符串，没有时复制一份*/
+char *poolString(const char *s) {
+    int h;
+    if (s == NULL)
+        return NULL;
+    if (internNum * 2 >= internCapacity)
+        growIntern();
+    h = (int) (stringHash(s) & (internCapacity - 1));
+    while (internTable[h] != NULL) {
+        if (strcmp(internTable[h], s) == 0)
+            return internTable[h];
+        h = (h + 1) & (internCapacity - 1);
+    }
+    internNum++;
+    return internTable[h] = strcpy(newString(strlen(s) + 1), s);
+}
 
 /*初始化该结构体*/
 void initRetStruct(RetStruct *retStruct) {
@@ -22,38 +125,134 @@ void initRetStruct(RetStruct *retStruct) {
 
 /*将int转换成char**/
 char *intToChar(int num) {
-    char *str = malloc(10);
+    char str[12];
     sprintf(str, "%d", num);
-    return str;
+    return poolString(str);
 }
 
 /*定义一个新的临时变量*/
-char *newVar() {
-    char *str = malloc(10);
-    sprintf(str, "t%d", variableNum++);
-    return str;
+char *newVar(void) {
+    char str[sizeof(TEMP_PREFIX) + 11];
+    sprintf(str, TEMP_PREFIX "%d", variableNum++);
+    stats.temporaries++;
+    return poolString(str);
+}
+
+/*保证四元式数组至少能容纳size条四元式*/
+void reserveQuadruples(int size) {
+    if (size <= capacity)
+        return;
+    while (capacity < size)
+        capacity = capacity == 0 ? LENGTH : capacity * 2;
+    quadruples = (Quadruple *) realloc(quadruples, capacity * sizeof(Quadruple));
 }
 
 /*增加一个四元组*/
 void addQuadruple(char *operator, char *arg1, char *arg2, char *result) {
-    quadruples[curIndex].operator = copyString(operator);
-    quadruples[curIndex].arg1 = copyString(arg1);
-    quadruples[curIndex].arg2 = copyString(arg2);
-    quadruples[curIndex].result = copyString(result);
+    if (curIndex == capacity)
+        reserveQuadruples(curIndex + 1);
+    quadruples[curIndex].operator = poolString(operator);
+    quadruples[curIndex].arg1 = poolString(arg1);
+    quadruples[curIndex].arg2 = poolString(arg2);
+    quadruples[curIndex].result = poolString(result);
+    quadruples[curIndex].lineno = curLine;
+    TRACE_EVENT(TRACE_CODE, EV_QUAD, curLine, curIndex, 0, operator);
     curIndex++;
 }
 
 /*输出四元组*/
 void printQuadruple(FILE *file) {
+    OutBuf *out = outOpen(file);
     for (int i = 0; i < curIndex; i++) {
-        fprintf(file, "%3d:  %5s  ", i, quadruples[i].operator);
-        if (quadruples[i].arg1 == NULL)
-            fprintf(file, "_,");
-        else fprintf(file, "%s,", quadruples[i].arg1);
-        if (quadruples[i].arg2 == NULL)
-            fprintf(file, "_,%s\n", quadruples[i].result);
-        else fprintf(file, "%s,%s\n", quadruples[i].arg2, quadruples[i].result);
+        outIntPad(out, i, 3);
+        outPuts(out, ":  ");
+        outStrPad(out, quadruples[i].operator, 5);
+        outSpaces(out, 2);
+        outPuts(out, quadruples[i].arg1 == NULL ? "_" : quadruples[i].arg1);
+        outChar(out, ',');
+        outPuts(out, quadruples[i].arg2 == NULL ? "_" : quadruples[i].arg2);
+        outChar(out, ',');
+        outPuts(out, quadruples[i].result == NULL ? "_" : quadruples[i].result);
+        outChar(out, '\n');
+    }
+}
+
+/*判断操作符是否为跳转*/
+int isJump(char *operator) {
+    return operator[0] == 'j';
+}
+
+/*判断操作符是否为条件跳转*/
+int isCondJump(char *operator) {
+    return operator[0] == 'j' && operator[1] != '\0';
+}
+
+/*判断操作符是否为算术运算*/
+int isArith(char *operator) {
+    return strcmp(operator, "plus") == 0 || strcmp(operator, "minus") == 0 ||
+           strcmp(operator, "times") == 0 || strcmp(operator, "over") == 0;
+}
+
+/*判断操作数是否为整数常量，常量折叠后可能出现负数*/
+int isNumber(char *s) {
+    if (s == NULL)
+        return FALSE;
+    if (*s == '-')
+        s++;
+    if (!isdigit(*s))
+        return FALSE;
+    while (isdigit(*s))
+        s++;
+    return *s == '\0';
+}
+
+/*判断操作数是否为常量*/
+int isConstant(char *s) {
+    if (s == NULL)
+        return FALSE;
+    return isNumber(s) || s[0] == '\'' || strcmp(s, "true") == 0 || strcmp(s, "false") == 0;
+}
+
+/*判断操作数是否为临时变量，临时变量的形式为TEMP_PREFIX加数字*/
+int isTemp(char *s) {
+    if (s == NULL || strncmp(s, TEMP_PREFIX, strlen(TEMP_PREFIX)) != 0)
+        return FALSE;
+    s += strlen(TEMP_PREFIX);
+    if (!isdigit(*s))
+        return FALSE;
+    while (isdigit(*s))
+        s++;
+    return *s == '\0';
+}
+
+/*判断操作数是否为变量*/
+int isVariable(char *s) {
+    return s != NULL && (isalpha(s[0]) || (s[0] == '_' && s[1] != '\0')) && !isConstant(s);
+}
+
+/*删除被标记的四元式，并修正所有跳转目标*/
+void removeQuadruples(int *removed) {
+    int i, j, target;
+    /*newIndex[i]为原第i条四元式（或其后第一条保留的四元式）的新地址*/
+    int *newIndex = (int *) malloc((curIndex + 1) * sizeof(int));
+    for (i = 0, j = 0; i < curIndex; i++) {
+        newIndex[i] = j;
+        if (!removed[i])
+            j++;
+    }
+    newIndex[curIndex] = j;
+    for (i = 0, j = 0; i < curIndex; i++) {
+        if (removed[i])
+            continue;
+        if (isJump(quadruples[i].operator) && quadruples[i].result != NULL) {
+            target = atoi(quadruples[i].result);
+            if (target >= 0 && target <= curIndex)
+                quadruples[i].result = intToChar(newIndex[target]);
+        }
+        quadruples[j++] = quadruples[i];
     }
+    curIndex = j;
+    free(newIndex);
 }
 
 /*新增加一个链表来记录要回填的信息*/
@@ -66,13 +265,14 @@ QuaLinkList *makeList(int i) {
 
 /*合并两个链表*/
 QuaLinkList *merge(QuaLinkList *list1, QuaLinkList *list2) {
+    QuaLinkList *tail = list1;
     /*判断list1是否为空，如果为空直接返回list2*/
     if (list1 != NULL) {
         /*遍历到list1最后一个节点，
-         * 让该节点的next为list2的首节点 */
-        while (list1->next != NULL)
-            list1 = list1->next;
-        list1->next = list2;
+         * 让该节点的next为list2的首节点，返回list1的首节点 */
+        while (tail->next != NULL)
+            tail = tail->next;
+        tail->next = list2;
         return list1;
     }
     return list2;
@@ -86,6 +286,8 @@ void backPatch(QuaLinkList *list, int target) {
         index = list->index;
         /*将跳转地址回填到四元式的result中*/
         quadruples[index].result = intToChar(target);
+        stats.backpatches++;
+        TRACE_EVENT(TRACE_CODE, EV_BACKPATCH, curLine, index, target, NULL);
         temp = list;
         list = list->next;
         /*释放节点*/
@@ -95,32 +297,83 @@ void backPatch(QuaLinkList *list, int target) {
 
 /*输出注释信息*/
 void emitComment(char *c) {
-    if (TraceCode)
-        fprintf(code, "* %s\n", c);
+    if (TRACING(TRACE_CODE, 1)) {
+        OutBuf *out = outOpen(code);
+        outPuts(out, "* ");
+        outPuts(out, c);
+        outChar(out, '\n');
+    }
 }
 
 /*遍历语法树来将四元式生成到代码文件*/
 void codeGen(TreeNode *syntaxTree, char *codeFile) {
+    VMProgram *prog;
+    int before;
     char *s = malloc(strlen(codeFile) + 7);
+    /*每次编译从空的四元式表开始，字符串池太大时释放*/
+    trimStrings();
+    curIndex = 0;
+    variableNum = 0;
+    curLine = 0;
     strcpy(s, "File: ");
     strcat(s, codeFile);
     emitComment("TINY Compilation to TM Code");
     emitComment(s);
+    free(s);
+    /*优化和控制流图的跟踪输出直接用fprintf写清单文件，先写出缓冲区中的内容*/
+    outFlush(outOpen(listing));
+    statsBegin(PHASE_CODEGEN);
     cGen(syntaxTree);
     addQuadruple("HALT", intToChar(0), intToChar(0), intToChar(0));
-    printQuadruple(code);
-    fprintf(listing, "\n\nQuadruple:\n");
-    printQuadruple(listing);
+    stats.quadruples = curIndex;
+    if (Optimize) {
+        statsBegin(PHASE_OPTIMIZE);
+        optimize();
+        statsEnd();
+        if (TRACING(TRACE_OPT, 1))
+            printPeepholeStats(listing);
+    }
+    /*按剖析重排基本块不依赖其他优化，-O0时也进行*/
+    statsBegin(PHASE_OPTIMIZE);
+    before = curIndex;
+    profileLayout();
+    TRACE_EVENT(TRACE_OPT, EV_OPT_PASS, 0, before, curIndex, "profile layout");
+    statsEnd();
+    if (TRACING(TRACE_CFG, 1)) {
+        CFG *cfg = buildCFG();
+        fprintf(listing, "\n\nControl flow graph:\n");
+        printCFGDot(cfg, listing);
+        freeCFG(cfg);
+    }
+    /*代码文件是TM指令，字节码另外写入binary，需要时再翻译为C写入ccode*/
+    statsBegin(PHASE_OUTPUT);
+    prog = vmLoad();
+    tmEmit(prog, code);
+    if (binary != NULL && !bcWrite(prog, binary))
+        fprintf(listing, "Unable to write bytecode\n");
+    if (ccode != NULL)
+        aotEmit(prog, ccode);
+    vmFree(prog);
+    if (TRACING(TRACE_CODE, 1)) {
+        outPuts(outOpen(listing), "\n\nQuadruple:\n");
+        printQuadruple(listing);
+    }
     emitComment("End of execution.");
+    statsEnd();
+    statsEnd();
 }
 
 /*根据节点类型的不同来使用不同的函数来遍历语法树*/
 RetStruct *cGen(TreeNode *tree) {
     RetStruct *ret = NULL;
+    int line;
     if (tree != NULL) {
         switch (tree->nodekind) {
             case StmtK:/*语句节点*/
+                line = curLine;
+                curLine = tree->lineno;
                 genStmt(tree);
+                curLine = line;
                 break;
             case ExpK:/*表达式节点*/
                 ret = genExp(tree);
@@ -11,6 +11,7 @@ typedef struct QuadrupleRec {
     char *arg1;
     char *arg2;
     char *result;   /*结果*/
+    int lineno;/*产生该四元式的语句所在的源程序行，编译器插入的为0*/
 } Quadruple;
 /*连接需要回填的逻辑地址*/
 typedef struct quaLinkList {
@@ -24,9 +25,32 @@ typedef struct retStruct {
     char *str;/*其他信息如str、num和布尔类型*/
 } RetStruct;
 
+/*四元式数组以及当前四元式的数量（下一条四元式的逻辑地址）*/
+extern THREAD_LOCAL Quadruple *quadruples;
+extern THREAD_LOCAL int curIndex;
+
+/*返回字符串池中与s相同的字符串，没有时复制一份。四元式中的字符串都驻留在池中，
+ * 在同一线程的多次编译之间保留，池太大时在开始下一次编译时释放*/
+char *poolString(const char *s);
+
+/*将int转换成char**/
+char *intToChar(int num);
+
+/*临时变量名的前缀。TINY的标识符以字母开头，编译器产生的名字以_开头，不会与用户的变量同名*/
+#define TEMP_PREFIX "_t"
+
+/*定义一个新的临时变量，名字为TEMP_PREFIX加编号*/
+char *newVar(void);
+
+/*保证四元式数组至少能容纳size条四元式*/
+void reserveQuadruples(int size);
+
 /*添加一个四元组*/
 void addQuadruple(char *operator, char *arg1, char *arg2, char *result);
 
+/*输出四元组*/
+void printQuadruple(FILE *file);
+
 /*新增加一个链表来记录要回填的信息*/
 QuaLinkList *makeList(int i);
 
@@ -36,6 +60,31 @@ QuaLinkList *merge(QuaLinkList *list1, QuaLinkList *list2);
 /*进行回填*/
 void backPatch(QuaLinkList *list, int target);
 
+/*判断操作符是否为跳转（j、j=、j<、j>、j<=、j>=）*/
+int isJump(char *operator);
+
+/*判断操作符是否为条件跳转*/
+int isCondJump(char *operator);
+
+/*判断操作符是否为算术运算（plus、minus、times、over）*/
+int isArith(char *operator);
+
+/*判断操作数是否为整数常量*/
+int isNumber(char *s);
+
+/*判断操作数是否为常量（整数、true/false、字符串）*/
+int isConstant(char *s);
+
+/*判断操作数是否为newVar产生的临时变量*/
+int isTemp(char *s);
+
+/*判断操作数是否为变量（包括临时变量）*/
+int isVariable(char *s);
+
+/*删除removed[i]不为0的四元式，重新编号并修正跳转目标，
+ * 跳转到被删除四元式的目标改为其后第一条保留的四元式*/
+void removeQuadruples(int *removed);
+
 /*遍历语法树来将四元式生成到代码文件*/
 void codeGen(TreeNode *syntaxTree, char *codeFile);
 
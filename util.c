@@ -8,12 +8,16 @@
 
 #include "globals.h"
 #include "util.h"
+#include "outbuf.h"
+#include "stats.h"
+#include "trace.h"
 
 
 /* Procedure printToken prints a token
  * and its lexeme to the listing file
  */
 void printToken(TokenType token, const char *tokenString) {
+    OutBuf *out = outOpen(listing);
     switch (token) {
         case IF:
         case THEN:
@@ -28,91 +32,110 @@ void printToken(TokenType token, const char *tokenString) {
         case STRING:
         case DO:
         case WHILE:
-            fprintf(listing,
-                    "reserved word: %s\n", tokenString);
+            outPuts(out, "reserved word: ");
+            outPuts(out, tokenString);
+            outChar(out, '\n');
             break;
         case OR:
-            fprintf(listing, "or\n");
+            outPuts(out, "or\n");
             break;
         case AND:
-            fprintf(listing, "and\n");
+            outPuts(out, "and\n");
             break;
         case NOT:
-            fprintf(listing, "not\n");
+            outPuts(out, "not\n");
             break;
         case T_TRUE:
-            fprintf(listing, "true\n");
+            outPuts(out, "true\n");
             break;
         case T_FALSE:
-            fprintf(listing, "false\n");
+            outPuts(out, "false\n");
             break;
         case ASSIGN:
-            fprintf(listing, ":=\n");
+            outPuts(out, ":=\n");
             break;
         case LT:
-            fprintf(listing, "<\n");
+            outPuts(out, "<\n");
             break;
         case EQ:
-            fprintf(listing, "=\n");
+            outPuts(out, "=\n");
             break;
         case GT:
-            fprintf(listing, ">\n");
+            outPuts(out, ">\n");
             break;
         case LTE:
-            fprintf(listing, "<=\n");
+            outPuts(out, "<=\n");
             break;
         case GTE:
-            fprintf(listing, ">=\n");
+            outPuts(out, ">=\n");
             break;
         case LPAREN:
-            fprintf(listing, "(\n");
+            outPuts(out, "(\n");
             break;
         case RPAREN:
-            fprintf(listing, ")\n");
+            outPuts(out, ")\n");
             break;
         case SEMI:
-            fprintf(listing, ";\n");
+            outPuts(out, ";\n");
             break;
         case COMMA:
-            fprintf(listing, ",\n");
+            outPuts(out, ",\n");
             break;
         case SQM:
-            fprintf(listing, "\'\n");
+            outPuts(out, "\'\n");
             break;
         case PLUS:
-            fprintf(listing, "+\n");
+            outPuts(out, "+\n");
             break;
         case MINUS:
-            fprintf(listing, "-\n");
+            outPuts(out, "-\n");
             break;
         case TIMES:
-            fprintf(listing, "*\n");
+            outPuts(out, "*\n");
             break;
         case OVER:
-            fprintf(listing, "/\n");
+            outPuts(out, "/\n");
             break;
         case ENDFILE:
-            fprintf(listing, "EOF\n");
+            outPuts(out, "EOF\n");
             break;
         case NUM:
-            fprintf(listing,
-                    "NUM, val= %s\n", tokenString);
+            outPuts(out, "NUM, val= ");
+            outPuts(out, tokenString);
+            outChar(out, '\n');
             break;
         case ID:
-            fprintf(listing,
-                    "ID, name= %s\n", tokenString);
+            outPuts(out, "ID, name= ");
+            outPuts(out, tokenString);
+            outChar(out, '\n');
             break;
         case STR:
-            fprintf(listing, "STR, name= %s\n", tokenString);
+            outPuts(out, "STR, name= ");
+            outPuts(out, tokenString);
+            outChar(out, '\n');
             break;
         case ERROR:
-            fprintf(listing, "ERROR %s: %s\n", errorMsg[errorCode], tokenString);
+            outPuts(out, "ERROR ");
+            outPuts(out, errorMsg[errorCode]);
+            outPuts(out, ": ");
+            outPuts(out, tokenString);
+            outChar(out, '\n');
             break;
         default: /* should never happen */
-            fprintf(listing, "Unknown token: %d\n", token);
+            outPuts(out, "Unknown token: ");
+            outInt(out, token);
+            outChar(out, '\n');
     }
 }
 
+/*输出内存不足的错误*/
+static void outOfMemory(void) {
+    OutBuf *out = outOpen(listing);
+    outPuts(out, "Out of memory error at line ");
+    outInt(out, lineno);
+    outChar(out, '\n');
+}
+
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  * 函数newStmtNode创建一个新语句节点，用于语法树构建
@@ -122,13 +145,16 @@ TreeNode *newStmtNode(StmtKind kind) {
     TreeNode *t = (TreeNode *) malloc(sizeof(TreeNode));
     int i;
     if (t == NULL)
-        fprintf(listing, "Out of memory error at line %d\n", lineno);
+        outOfMemory();
     else {
         for (i = 0; i < MAXCHILDREN; i++) t->child[i] = NULL;
         t->sibling = NULL;
         t->nodekind = StmtK;
         t->kind.stmt = kind;
+        stats.stmtNodes[kind]++;
+        TRACE_EVENT(TRACE_PARSE, EV_NODE, lineno, StmtK, kind, NULL);
         t->lineno = lineno;
+        t->attr.name = NULL;
     }
     return t;
 }
@@ -142,13 +168,16 @@ TreeNode *newExpNode(ExpKind kind) {
     TreeNode *t = (TreeNode *) malloc(sizeof(TreeNode));
     int i;
     if (t == NULL)
-        fprintf(listing, "Out of memory error at line %d\n", lineno);
+        outOfMemory();
     else {
         for (i = 0; i < MAXCHILDREN; i++) t->child[i] = NULL;
         t->sibling = NULL;
         t->nodekind = ExpK;
         t->kind.exp = kind;
+        stats.expNodes[kind]++;
+        TRACE_EVENT(TRACE_PARSE, EV_NODE, lineno, ExpK, kind, NULL);
         t->lineno = lineno;
+        t->attr.name = NULL;
         t->type = Void;
     }
     return t;
@@ -165,7 +194,7 @@ char *copyString(char *s) {
     n = strlen(s) + 1;
     t = malloc(n);
     if (t == NULL)
-        fprintf(listing, "Out of memory error at line %d\n", lineno);
+        outOfMemory();
     else strcpy(t, s);
     return t;
 }
@@ -174,17 +203,22 @@ char *copyString(char *s) {
  * store current number of spaces to indent
  * printTree使用变量indentno来存储要缩进的当前空间数
  */
-static int indentno = 0;
+static THREAD_LOCAL int indentno = 0;
 
 /* macros to increase/decrease indentation */
 #define INDENT indentno+=2
 #define UNINDENT indentno-=2
 
 /* printSpaces indents by printing spaces */
-static void printSpaces(void) {
-    int i;
-    for (i = 0; i < indentno; i++)
-        fprintf(listing, " ");
+static void printSpaces(OutBuf *out) {
+    outSpaces(out, indentno);
+}
+
+/*输出text和name并换行*/
+static void printNamed(OutBuf *out, const char *text, const char *name) {
+    outPuts(out, text);
+    outPuts(out, name != NULL ? name : "(null)");
+    outChar(out, '\n');
 }
 
 /* procedure printTree prints a syntax tree to the 
@@ -192,67 +226,70 @@ static void printSpaces(void) {
  * 过程printTree使用缩进将语法树打印到清单文件中，以指示子树
  */
 void printTree(TreeNode *tree) {
+    OutBuf *out = outOpen(listing);
     int i;
     /*增加缩进*/
     INDENT;
     while (tree != NULL) {
-        printSpaces();
+        printSpaces(out);
         /*语句节点*/
         if (tree->nodekind == StmtK) {
             switch (tree->kind.stmt) {
                 case IfK:
-                    fprintf(listing, "If\n");
+                    outPuts(out, "If\n");
                     break;
                 case RepeatK:
-                    fprintf(listing, "Repeat\n");
+                    outPuts(out, "Repeat\n");
                     break;
                 case AssignK:
-                    fprintf(listing, "Assign to: %s\n", tree->attr.name);
+                    printNamed(out, "Assign to: ", tree->attr.name);
                     break;
                 case ReadK:
-                    fprintf(listing, "Read: %s\n", tree->attr.name);
+                    printNamed(out, "Read: ", tree->attr.name);
                     break;
                 case WriteK:
-                    fprintf(listing, "Write\n");
+                    outPuts(out, "Write\n");
                     break;
                 case WhileK:
                     /*新添加WhileK来输出do-while语句*/
-                    fprintf(listing, "While\n");
+                    outPuts(out, "While\n");
                     break;
                 case TypeK:
                     /*输出数据类型*/
-                    fprintf(listing, "Type: %s\n", tree->attr.name);
+                    printNamed(out, "Type: ", tree->attr.name);
                     break;
                 default:
-                    fprintf(listing, "Unknown StmtNode kind\n");
+                    outPuts(out, "Unknown StmtNode kind\n");
                     break;
             }
         } else if (tree->nodekind == ExpK) {
             /*表达式节点*/
             switch (tree->kind.exp) {
                 case OpK:
-                    fprintf(listing, "Op: ");
+                    outPuts(out, "Op: ");
                     printToken(tree->attr.op, "\0");
                     break;
                 case ConstNumK:
                     /*输出常数*/
-                    fprintf(listing, "Const Integer: %d\n", tree->attr.val);
+                    outPuts(out, "Const Integer: ");
+                    outInt(out, tree->attr.val);
+                    outChar(out, '\n');
                     break;
                 case ConstStrK:
                     /*输出字符串*/
-                    fprintf(listing, "Const String: %s\n", tree->attr.string);
+                    printNamed(out, "Const String: ", tree->attr.string);
                     break;
                 case BoolK:
-                    fprintf(listing, "Const Bool: %s\n", tree->attr.string);
+                    printNamed(out, "Const Bool: ", tree->attr.string);
                     break;
                 case IdK:
-                    fprintf(listing, "Id: %s\n", tree->attr.name);
+                    printNamed(out, "Id: ", tree->attr.name);
                     break;
                 default:
-                    fprintf(listing, "Unknown ExpNode kind\n");
+                    outPuts(out, "Unknown ExpNode kind\n");
                     break;
             }
-        } else fprintf(listing, "Unknown node kind\n");
+        } else outPuts(out, "Unknown node kind\n");
         /*打印子树*/
         for (i = 0; i < MAXCHILDREN; i++)
             printTree(tree->child[i]);
@@ -263,6 +300,52 @@ void printTree(TreeNode *tree) {
     UNINDENT;
 }
 
+/* procedure freeTree releases a syntax tree
+ * together with the names and strings it owns
+ * 过程freeTree释放语法树以及节点中复制的名字和字符串，TypeK的类型名是常量，不释放
+ */
+void freeTree(TreeNode *tree) {
+    TreeNode *sibling;
+    int i;
+    while (tree != NULL) {
+        for (i = 0; i < MAXCHILDREN; i++)
+            freeTree(tree->child[i]);
+        if (tree->nodekind == StmtK ? tree->kind.stmt == AssignK || tree->kind.stmt == ReadK
+                                    : tree->kind.exp == IdK || tree->kind.exp == ConstStrK || tree->kind.exp == BoolK)
+            free(tree->attr.name);
+        sibling = tree->sibling;
+        free(tree);
+        tree = sibling;
+    }
+}
+
+/*本次编译报告的错误*/
+THREAD_LOCAL Diagnostic *diagnostics = NULL;
+THREAD_LOCAL int diagnosticNum = 0;
+static THREAD_LOCAL int diagnosticCapacity = 0;
+
+/* procedure addDiagnostic records an error
+ * 过程addDiagnostic记录一个错误，复制错误信息
+ */
+void addDiagnostic(int lineno, const char *message) {
+    if (diagnosticNum == diagnosticCapacity) {
+        diagnosticCapacity = diagnosticCapacity == 0 ? 8 : diagnosticCapacity * 2;
+        diagnostics = (Diagnostic *) realloc(diagnostics, diagnosticCapacity * sizeof(Diagnostic));
+    }
+    diagnostics[diagnosticNum].lineno = lineno;
+    diagnostics[diagnosticNum++].message = copyString((char *) message);
+}
+
+/* procedure clearDiagnostics forgets the errors
+ * 过程clearDiagnostics释放上一次编译的错误
+ */
+void clearDiagnostics(void) {
+    int i;
+    for (i = 0; i < diagnosticNum; i++)
+        free(diagnostics[i].message);
+    diagnosticNum = 0;
+}
+
 int isLegalChar(char c) {
     return (isalnum(c) ||
             isspace(c) ||
@@ -33,5 +33,31 @@ char *copyString(char *);
  */
 void printTree(TreeNode *);
 
+/* procedure freeTree releases a syntax tree
+ * together with the names and strings it owns
+ */
+void freeTree(TreeNode *);
+
+/* Diagnostic records one error reported during
+ * a compilation, in addition to the listing file
+ */
+typedef struct DiagnosticRec {
+    int lineno;
+    char *message;
+} Diagnostic;
+
+extern THREAD_LOCAL Diagnostic *diagnostics;
+extern THREAD_LOCAL int diagnosticNum;
+
+/* procedure addDiagnostic records an error;
+ * the message is copied
+ */
+void addDiagnostic(int lineno, const char *message);
+
+/* procedure clearDiagnostics forgets the errors
+ * of the previous compilation
+ */
+void clearDiagnostics(void);
+
 int isLegalChar(char c);
 #endif
@@ -0,0 +1,673 @@
+//
+// Created by liang on 2020/7/10.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "globals.h"
+#include "translate.h"
+#include "vm.h"
+#include "nametab.h"
+
+/*寄存器表，把变量名和常量映射为寄存器下标；字符串表，把带引号的字符串常量映射为字符串下标*/
+static THREAD_LOCAL NameTable slotTable;
+static THREAD_LOCAL NameTable stringTable;
+static THREAD_LOCAL int slotCapacity;
+static THREAD_LOCAL int stringCapacity;
+static THREAD_LOCAL int poolCapacity;
+
+/*把长为len的字符串加入字符串池，返回它的偏移*/
+static int poolAdd(VMProgram *prog, const char *str, int len) {
+    int off = prog->poolSize;
+    if (off + len + 1 > poolCapacity) {
+        while (off + len + 1 > poolCapacity)
+            poolCapacity = poolCapacity == 0 ? 1024 : poolCapacity * 2;
+        prog->pool = (char *) realloc(prog->pool, poolCapacity);
+    }
+    memcpy(prog->pool + off, str, len);
+    prog->pool[off + len] = '\0';
+    prog->poolSize = off + len + 1;
+    return off;
+}
+
+/*字符串常量的下标，去掉两边的引号，相同的字符串共用一个下标*/
+static int internString(VMProgram *prog, char *s) {
+    int i = nameTableFind(&stringTable, s);
+    if (i >= 0)
+        return i;
+    if (prog->stringNum == stringCapacity) {
+        stringCapacity = stringCapacity == 0 ? 16 : stringCapacity * 2;
+        prog->stringOff = (int32_t *) realloc(prog->stringOff, stringCapacity * sizeof(int32_t));
+    }
+    prog->stringOff[prog->stringNum] = poolAdd(prog, s + 1, (int) strlen(s) - 2);
+    nameTableInsert(&stringTable, s, prog->stringNum);
+    return prog->stringNum++;
+}
+
+/*操作数对应的寄存器，第一次出现时分配，常量同时设置初值*/
+static int slotOf(VMProgram *prog, char *name) {
+    int slot = nameTableFind(&slotTable, name);
+    if (slot >= 0)
+        return slot;
+    if (prog->regNum == slotCapacity) {
+        slotCapacity = slotCapacity == 0 ? 256 : slotCapacity * 2;
+        prog->init = (int32_t *) realloc(prog->init, slotCapacity * sizeof(int32_t));
+        prog->nameOff = (int32_t *) realloc(prog->nameOff, slotCapacity * sizeof(int32_t));
+    }
+    if (isNumber(name))
+        prog->init[prog->regNum] = atoi(name);
+    else if (strcmp(name, "true") == 0)
+        prog->init[prog->regNum] = 1;
+    else if (name[0] == '\'')
+        prog->init[prog->regNum] = internString(prog, name);
+    else
+        prog->init[prog->regNum] = 0;
+    prog->nameOff[prog->regNum] = poolAdd(prog, name, (int) strlen(name));
+    nameTableInsert(&slotTable, name, prog->regNum);
+    return prog->regNum++;
+}
+
+/*操作数的寄存器，缺省的操作数（_）返回-1*/
+static int operandSlot(VMProgram *prog, char *s) {
+    if (s == NULL || strcmp(s, "_") == 0)
+        return -1;
+    return slotOf(prog, s);
+}
+
+/*把四元式的操作符翻译为操作码*/
+static VMOpcode opcodeOf(char *operator) {
+    if (strcmp(operator, ":=") == 0)
+        return OP_MOVE;
+    if (strcmp(operator, "plus") == 0)
+        return OP_ADD;
+    if (strcmp(operator, "minus") == 0)
+        return OP_SUB;
+    if (strcmp(operator, "times") == 0)
+        return OP_MUL;
+    if (strcmp(operator, "over") == 0)
+        return OP_DIV;
+    if (strcmp(operator, "j") == 0)
+        return OP_JMP;
+    if (strcmp(operator, "j=") == 0)
+        return OP_JEQ;
+    if (strcmp(operator, "j<") == 0)
+        return OP_JLT;
+    if (strcmp(operator, "j>") == 0)
+        return OP_JGT;
+    if (strcmp(operator, "j<=") == 0)
+        return OP_JLE;
+    if (strcmp(operator, "j>=") == 0)
+        return OP_JGE;
+    if (strcmp(operator, "IN") == 0)
+        return OP_IN;
+    if (strcmp(operator, "OUT") == 0)
+        return OP_OUT;
+    return OP_HALT;
+}
+
+/*把当前的四元式解码为虚拟机程序*/
+VMProgram *vmLoad(void) {
+    VMProgram *prog = (VMProgram *) calloc(1, sizeof(VMProgram));
+    int n = curIndex, i, target, changed;
+    char *isString;
+    VMInstr *ins;
+    Quadruple *q;
+
+    nameTableClear(&slotTable);
+    nameTableClear(&stringTable);
+    slotCapacity = 0;
+    stringCapacity = 0;
+    poolCapacity = 0;
+    prog->in = stdin;
+    prog->out = stdout;
+    /*最后一条不是HALT时末尾补一条，跳到程序末尾的跳转也落在它上面*/
+    prog->codeNum = n > 0 && strcmp(quadruples[n - 1].operator, "HALT") == 0 ? n : n + 1;
+    prog->code = (VMInstr *) calloc(prog->codeNum, sizeof(VMInstr));
+    prog->lines = (int32_t *) calloc(prog->codeNum, sizeof(int32_t));
+    for (i = 0; i < n; i++) {
+        q = &quadruples[i];
+        ins = &prog->code[i];
+        prog->lines[i] = q->lineno;
+        ins->op = opcodeOf(q->operator);
+        ins->a = -1;
+        ins->b = -1;
+        ins->c = -1;
+        switch (ins->op) {
+            case OP_JMP:
+            case OP_JEQ:
+            case OP_JLT:
+            case OP_JGT:
+            case OP_JLE:
+            case OP_JGE:
+                if (ins->op != OP_JMP) {
+                    ins->a = operandSlot(prog, q->arg1);
+                    ins->b = operandSlot(prog, q->arg2);
+                }
+                target = q->result == NULL ? n : atoi(q->result);
+                ins->c = target < 0 || target >= prog->codeNum ? prog->codeNum - 1 : target;
+                break;
+            case OP_OUT:
+                ins->a = operandSlot(prog, q->result);
+                break;
+            case OP_HALT:
+                break;
+            default:
+                ins->a = operandSlot(prog, q->arg1);
+                ins->b = operandSlot(prog, q->arg2);
+                ins->c = operandSlot(prog, q->result);
+                break;
+        }
+    }
+    if (prog->codeNum > n)
+        prog->code[n].op = OP_HALT;
+
+    /*沿复制求可能存放字符串的寄存器，输出它们时按字符串输出*/
+    isString = (char *) calloc(prog->regNum + 1, sizeof(char));
+    for (i = 0; i < prog->regNum; i++)
+        isString[i] = vmSlotName(prog, i)[0] == '\'';
+    do {
+        changed = FALSE;
+        for (i = 0; i < n; i++) {
+            ins = &prog->code[i];
+            if (ins->op == OP_MOVE && isString[ins->a] && !isString[ins->c]) {
+                isString[ins->c] = TRUE;
+                changed = TRUE;
+            }
+        }
+    } while (changed);
+    for (i = 0; i < n; i++)
+        if (prog->code[i].op == OP_OUT && isString[prog->code[i].a])
+            prog->code[i].op = OP_OUTS;
+    free(isString);
+    nameTableClear(&slotTable);
+    nameTableClear(&stringTable);
+    return prog;
+}
+
+/*释放程序，映射进来的程序解除映射*/
+void vmFree(VMProgram *prog) {
+    if (prog == NULL)
+        return;
+    if (prog->mapping != NULL)
+        munmap(prog->mapping, prog->mappingSize);
+    else {
+        free(prog->pool);
+        free(prog->stringOff);
+        free(prog->nameOff);
+        free(prog->lines);
+        free(prog->init);
+        free(prog->code);
+    }
+    free(prog->super);
+    free(prog);
+}
+
+/*寄存器是否为整数常量，常量的寄存器不会被写*/
+static int isConstSlot(VMProgram *prog, int slot) {
+    return slot >= 0 && isNumber(vmSlotName(prog, slot));
+}
+
+/*从第i条指令开始的超级指令，没有时返回原来的指令。
+ * 只看第i条和第i + 1条，不管第i + 1条是不是跳转的目标，因为第i + 1条本身保持不变*/
+static VMInstr selectAt(VMProgram *prog, int i) {
+    VMInstr ins = prog->code[i], *next = &prog->code[i + 1];
+    int temp, kind, immediate = FALSE;
+    if (ins.op == OP_HALT)
+        return ins;
+    if (ins.op >= OP_JEQ && ins.op <= OP_JGE) {
+        if (next->op == OP_JMP)
+            ins.op += OP_JEQ2 - OP_JEQ;
+        return ins;
+    }
+    if (ins.op != OP_ADD && ins.op != OP_SUB && ins.op != OP_MUL)
+        return ins;
+    kind = ins.op - OP_ADD;/*超级指令按加、减、乘的顺序排列*/
+    /*加法和乘法可以交换，使常量在后*/
+    if (ins.op != OP_SUB && isConstSlot(prog, ins.a) && !isConstSlot(prog, ins.b)) {
+        temp = ins.a;
+        ins.a = ins.b;
+        ins.b = temp;
+    }
+    if (isConstSlot(prog, ins.b)) {
+        ins.b = prog->init[ins.b];
+        immediate = TRUE;
+    }
+    if (next->op == OP_MOVE && next->a == ins.c)
+        ins.op = (immediate ? OP_ADDI_MOVE : OP_ADD_MOVE) + kind;
+    else if (immediate)
+        ins.op = OP_ADDI + kind;
+    return ins;
+}
+
+/*重新建立执行用的指令。超级指令之后的一条总是MOVE或JMP，它们不会被换成超级指令，
+ * 执行超级指令时从中取出的目标寄存器和跳转目标与code中相同*/
+void vmSelectSuper(VMProgram *prog, int enable) {
+    int i;
+    if (prog->super == NULL)
+        prog->super = (VMInstr *) malloc(prog->codeNum * sizeof(VMInstr));
+    for (i = 0; i < prog->codeNum; i++)
+        prog->super[i] = enable ? selectAt(prog, i) : prog->code[i];
+    prog->threadedLoaded = FALSE;
+}
+
+/*各条指令的语义，两种分派方式共用。算术按补码回绕，与常量折叠一致*/
+#define EXEC_MOVE regs[ip->c] = regs[ip->a]
+#define EXEC_ADD regs[ip->c] = (int) ((unsigned) regs[ip->a] + (unsigned) regs[ip->b])
+#define EXEC_SUB regs[ip->c] = (int) ((unsigned) regs[ip->a] - (unsigned) regs[ip->b])
+#define EXEC_MUL regs[ip->c] = (int) ((unsigned) regs[ip->a] * (unsigned) regs[ip->b])
+#define EXEC_DIV do { \
+        if (regs[ip->b] == 0) { \
+            status = VM_DIV_ZERO; \
+            goto done; \
+        } \
+        regs[ip->c] = regs[ip->b] == -1 ? (int) (0u - (unsigned) regs[ip->a]) : regs[ip->a] / regs[ip->b]; \
+    } while (0)
+#define EXEC_IN do { \
+        if (fscanf(prog->in, "%d", &regs[ip->c]) != 1) { \
+            status = VM_BAD_INPUT; \
+            goto done; \
+        } \
+    } while (0)
+#define EXEC_ADDI regs[ip->c] = (int) ((unsigned) regs[ip->a] + (unsigned) ip->b)
+#define EXEC_SUBI regs[ip->c] = (int) ((unsigned) regs[ip->a] - (unsigned) ip->b)
+#define EXEC_MULI regs[ip->c] = (int) ((unsigned) regs[ip->a] * (unsigned) ip->b)
+/*运算并赋值的超级指令，把临时变量复制到下一条赋值的目标*/
+#define EXEC_STORE regs[ip[1].c] = regs[ip->c]
+#define EXEC_OUT fprintf(prog->out, "%d\n", regs[ip->a])
+#define EXEC_OUTS do { \
+        if (regs[ip->a] >= 0 && regs[ip->a] < prog->stringNum) \
+            fprintf(prog->out, "%s\n", vmString(prog, regs[ip->a])); \
+        else \
+            fprintf(prog->out, "%d\n", regs[ip->a]); \
+    } while (0)
+
+/*用switch分派执行*/
+static int runSwitch(VMProgram *prog, int *regs) {
+    VMInstr *code = prog->super, *ip = code;
+    int status = VM_OK;
+    for (;;) {
+        switch (ip->op) {
+            case OP_MOVE:
+                EXEC_MOVE;
+                ip++;
+                break;
+            case OP_ADD:
+                EXEC_ADD;
+                ip++;
+                break;
+            case OP_SUB:
+                EXEC_SUB;
+                ip++;
+                break;
+            case OP_MUL:
+                EXEC_MUL;
+                ip++;
+                break;
+            case OP_DIV:
+                EXEC_DIV;
+                ip++;
+                break;
+            case OP_JMP:
+                ip = code + ip->c;
+                break;
+            case OP_JEQ:
+                ip = regs[ip->a] == regs[ip->b] ? code + ip->c : ip + 1;
+                break;
+            case OP_JLT:
+                ip = regs[ip->a] < regs[ip->b] ? code + ip->c : ip + 1;
+                break;
+            case OP_JGT:
+                ip = regs[ip->a] > regs[ip->b] ? code + ip->c : ip + 1;
+                break;
+            case OP_JLE:
+                ip = regs[ip->a] <= regs[ip->b] ? code + ip->c : ip + 1;
+                break;
+            case OP_JGE:
+                ip = regs[ip->a] >= regs[ip->b] ? code + ip->c : ip + 1;
+                break;
+            case OP_IN:
+                EXEC_IN;
+                ip++;
+                break;
+            case OP_OUT:
+                EXEC_OUT;
+                ip++;
+                break;
+            case OP_OUTS:
+                EXEC_OUTS;
+                ip++;
+                break;
+            case OP_JEQ2:
+                ip = code + (regs[ip->a] == regs[ip->b] ? ip->c : ip[1].c);
+                break;
+            case OP_JLT2:
+                ip = code + (regs[ip->a] < regs[ip->b] ? ip->c : ip[1].c);
+                break;
+            case OP_JGT2:
+                ip = code + (regs[ip->a] > regs[ip->b] ? ip->c : ip[1].c);
+                break;
+            case OP_JLE2:
+                ip = code + (regs[ip->a] <= regs[ip->b] ? ip->c : ip[1].c);
+                break;
+            case OP_JGE2:
+                ip = code + (regs[ip->a] >= regs[ip->b] ? ip->c : ip[1].c);
+                break;
+            case OP_ADDI:
+                EXEC_ADDI;
+                ip++;
+                break;
+            case OP_SUBI:
+                EXEC_SUBI;
+                ip++;
+                break;
+            case OP_MULI:
+                EXEC_MULI;
+                ip++;
+                break;
+            case OP_ADD_MOVE:
+                EXEC_ADD;
+                EXEC_STORE;
+                ip += 2;
+                break;
+            case OP_SUB_MOVE:
+                EXEC_SUB;
+                EXEC_STORE;
+                ip += 2;
+                break;
+            case OP_MUL_MOVE:
+                EXEC_MUL;
+                EXEC_STORE;
+                ip += 2;
+                break;
+            case OP_ADDI_MOVE:
+                EXEC_ADDI;
+                EXEC_STORE;
+                ip += 2;
+                break;
+            case OP_SUBI_MOVE:
+                EXEC_SUBI;
+                EXEC_STORE;
+                ip += 2;
+                break;
+            case OP_MULI_MOVE:
+                EXEC_MULI;
+                EXEC_STORE;
+                ip += 2;
+                break;
+            case OP_HALT:
+            default:
+                goto done;
+        }
+    }
+    done:
+    return status;
+}
+
+#if defined(__GNUC__) && !defined(VM_NO_THREADING)
+#define VM_THREADED 1
+
+/*直接线程化分派：每条指令保存处理代码的地址，执行完直接跳到下一条指令的处理代码*/
+static int runThreaded(VMProgram *prog, int *regs) {
+    static const void *labels[] = {
+            &&L_MOVE, &&L_ADD, &&L_SUB, &&L_MUL, &&L_DIV,
+            &&L_JMP, &&L_JEQ, &&L_JLT, &&L_JGT, &&L_JLE, &&L_JGE,
+            &&L_IN, &&L_OUT, &&L_OUTS, &&L_HALT,
+            &&L_JEQ2, &&L_JLT2, &&L_JGT2, &&L_JLE2, &&L_JGE2,
+            &&L_ADDI, &&L_SUBI, &&L_MULI,
+            &&L_ADD_MOVE, &&L_SUB_MOVE, &&L_MUL_MOVE,
+            &&L_ADDI_MOVE, &&L_SUBI_MOVE, &&L_MULI_MOVE
+    };
+    VMInstr *code = prog->super, *ip = code;
+    int status = VM_OK, i;
+    if (!prog->threadedLoaded) {
+        for (i = 0; i < prog->codeNum; i++)
+            code[i].u.handler = labels[code[i].op];
+        prog->threadedLoaded = TRUE;
+    }
+#define DISPATCH goto *ip->u.handler
+    DISPATCH;
+    L_MOVE:
+    EXEC_MOVE;
+    ip++;
+    DISPATCH;
+    L_ADD:
+    EXEC_ADD;
+    ip++;
+    DISPATCH;
+    L_SUB:
+    EXEC_SUB;
+    ip++;
+    DISPATCH;
+    L_MUL:
+    EXEC_MUL;
+    ip++;
+    DISPATCH;
+    L_DIV:
+    EXEC_DIV;
+    ip++;
+    DISPATCH;
+    L_JMP:
+    ip = code + ip->c;
+    DISPATCH;
+    L_JEQ:
+    ip = regs[ip->a] == regs[ip->b] ? code + ip->c : ip + 1;
+    DISPATCH;
+    L_JLT:
+    ip = regs[ip->a] < regs[ip->b] ? code + ip->c : ip + 1;
+    DISPATCH;
+    L_JGT:
+    ip = regs[ip->a] > regs[ip->b] ? code + ip->c : ip + 1;
+    DISPATCH;
+    L_JLE:
+    ip = regs[ip->a] <= regs[ip->b] ? code + ip->c : ip + 1;
+    DISPATCH;
+    L_JGE:
+    ip = regs[ip->a] >= regs[ip->b] ? code + ip->c : ip + 1;
+    DISPATCH;
+    L_IN:
+    EXEC_IN;
+    ip++;
+    DISPATCH;
+    L_OUT:
+    EXEC_OUT;
+    ip++;
+    DISPATCH;
+    L_OUTS:
+    EXEC_OUTS;
+    ip++;
+    DISPATCH;
+    L_JEQ2:
+    ip = code + (regs[ip->a] == regs[ip->b] ? ip->c : ip[1].c);
+    DISPATCH;
+    L_JLT2:
+    ip = code + (regs[ip->a] < regs[ip->b] ? ip->c : ip[1].c);
+    DISPATCH;
+    L_JGT2:
+    ip = code + (regs[ip->a] > regs[ip->b] ? ip->c : ip[1].c);
+    DISPATCH;
+    L_JLE2:
+    ip = code + (regs[ip->a] <= regs[ip->b] ? ip->c : ip[1].c);
+    DISPATCH;
+    L_JGE2:
+    ip = code + (regs[ip->a] >= regs[ip->b] ? ip->c : ip[1].c);
+    DISPATCH;
+    L_ADDI:
+    EXEC_ADDI;
+    ip++;
+    DISPATCH;
+    L_SUBI:
+    EXEC_SUBI;
+    ip++;
+    DISPATCH;
+    L_MULI:
+    EXEC_MULI;
+    ip++;
+    DISPATCH;
+    L_ADD_MOVE:
+    EXEC_ADD;
+    EXEC_STORE;
+    ip += 2;
+    DISPATCH;
+    L_SUB_MOVE:
+    EXEC_SUB;
+    EXEC_STORE;
+    ip += 2;
+    DISPATCH;
+    L_MUL_MOVE:
+    EXEC_MUL;
+    EXEC_STORE;
+    ip += 2;
+    DISPATCH;
+    L_ADDI_MOVE:
+    EXEC_ADDI;
+    EXEC_STORE;
+    ip += 2;
+    DISPATCH;
+    L_SUBI_MOVE:
+    EXEC_SUBI;
+    EXEC_STORE;
+    ip += 2;
+    DISPATCH;
+    L_MULI_MOVE:
+    EXEC_MULI;
+    EXEC_STORE;
+    ip += 2;
+    DISPATCH;
+#undef DISPATCH
+    L_HALT:
+    done:
+    return status;
+}
+
+#else
+#define VM_THREADED 0
+#endif
+
+/*用switch分派执行并计数。为了不拖慢平常的执行，计数的版本单独写一份*/
+static int runProfiled(VMProgram *prog, int *regs, VMProfile *profile) {
+    VMInstr *code = prog->code, *ip = code, *next;
+    int status = VM_OK;
+    for (;;) {
+        profile->counts[ip - code]++;
+        next = ip + 1;
+        switch (ip->op) {
+            case OP_MOVE:
+                EXEC_MOVE;
+                break;
+            case OP_ADD:
+                EXEC_ADD;
+                break;
+            case OP_SUB:
+                EXEC_SUB;
+                break;
+            case OP_MUL:
+                EXEC_MUL;
+                break;
+            case OP_DIV:
+                EXEC_DIV;
+                break;
+            case OP_JMP:
+                next = code + ip->c;
+                break;
+            case OP_JEQ:
+            case OP_JLT:
+            case OP_JGT:
+            case OP_JLE:
+            case OP_JGE:
+                if (ip->op == OP_JEQ ? regs[ip->a] == regs[ip->b] :
+                    ip->op == OP_JLT ? regs[ip->a] < regs[ip->b] :
+                    ip->op == OP_JGT ? regs[ip->a] > regs[ip->b] :
+                    ip->op == OP_JLE ? regs[ip->a] <= regs[ip->b] : regs[ip->a] >= regs[ip->b]) {
+                    profile->taken[ip - code]++;
+                    next = code + ip->c;
+                }
+                break;
+            case OP_IN:
+                EXEC_IN;
+                break;
+            case OP_OUT:
+                EXEC_OUT;
+                break;
+            case OP_OUTS:
+                EXEC_OUTS;
+                break;
+            case OP_HALT:
+            default:
+                goto done;
+        }
+        ip = next;
+    }
+    done:
+    return status;
+}
+
+/*是否支持直接线程化分派*/
+int vmThreadedAvailable(void) {
+    return VM_THREADED;
+}
+
+/*执行程序，每次执行都从寄存器的初值开始*/
+int vmRun(VMProgram *prog, int threaded) {
+    int status;
+    int *regs = (int *) malloc((prog->regNum + 1) * sizeof(int));
+    memcpy(regs, prog->init, prog->regNum * sizeof(int));
+    if (prog->super == NULL)
+        vmSelectSuper(prog, TRUE);
+#if VM_THREADED
+    if (threaded)
+        status = runThreaded(prog, regs);
+    else
+#endif
+        status = runSwitch(prog, regs);
+    (void) threaded;
+    fflush(prog->out);
+    free(regs);
+    return status;
+}
+
+/*为程序建立全为0的剖析*/
+VMProfile *vmProfileNew(VMProgram *prog) {
+    VMProfile *profile = (VMProfile *) malloc(sizeof(VMProfile));
+    profile->codeNum = prog->codeNum;
+    profile->counts = (uint64_t *) calloc(prog->codeNum, sizeof(uint64_t));
+    profile->taken = (uint64_t *) calloc(prog->codeNum, sizeof(uint64_t));
+    return profile;
+}
+
+void vmProfileFree(VMProfile *profile) {
+    if (profile == NULL)
+        return;
+    free(profile->counts);
+    free(profile->taken);
+    free(profile);
+}
+
+/*执行程序并计数，可以多次执行，次数累加*/
+int vmRunProfiled(VMProgram *prog, VMProfile *profile) {
+    int status;
+    int *regs = (int *) malloc((prog->regNum + 1) * sizeof(int));
+    memcpy(regs, prog->init, prog->regNum * sizeof(int));
+    status = runProfiled(prog, regs, profile);
+    fflush(prog->out);
+    free(regs);
+    return status;
+}
+
+/*每条指令执行一次分派；超级指令执行时省去下一条的分派，两路跳转只在条件不成立时省去*/
+uint64_t vmDispatchCount(VMProgram *prog, VMProfile *profile, int super) {
+    uint64_t count = 0;
+    VMInstr ins;
+    int i;
+    for (i = 0; i < prog->codeNum && i < profile->codeNum; i++) {
+        count += profile->counts[i];
+        if (!super)
+            continue;
+        ins = selectAt(prog, i);
+        if (ins.op >= OP_JEQ2 && ins.op <= OP_JGE2)
+            count -= profile->counts[i] - profile->taken[i];
+        else if (ins.op >= OP_ADD_MOVE)
+            count -= profile->counts[i];
+    }
+    return count;
+}
@@ -0,0 +1,104 @@
+//
+// Created by liang on 2020/7/10.
+//
+
+#ifndef TINY_VM_H
+#define TINY_VM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*虚拟机的操作码，OP_HALT及以前的与四元式的操作符一一对应。
+ * 以后的是超级指令，只在执行前由vmSelectSuper从相邻的指令选出，不出现在code和字节码文件中：
+ * OP_JEQ2……OP_JGE2：条件跳转和后面的无条件跳转，c为条件成立时的目标，不成立时的目标取下一条指令的c；
+ * OP_ADDI……OP_MULI：b为常量操作数的值；
+ * OP_ADD_MOVE……：运算到临时变量c，再由下一条的赋值复制到它的c，执行后跳过下一条。
+ * 超级指令之后的指令保持原样，跳到它的跳转仍然正确*/
+typedef enum {
+    OP_MOVE, OP_ADD, OP_SUB, OP_MUL, OP_DIV,
+    OP_JMP, OP_JEQ, OP_JLT, OP_JGT, OP_JLE, OP_JGE,
+    OP_IN, OP_OUT, OP_OUTS, OP_HALT,
+    OP_JEQ2, OP_JLT2, OP_JGT2, OP_JLE2, OP_JGE2,
+    OP_ADDI, OP_SUBI, OP_MULI,
+    OP_ADD_MOVE, OP_SUB_MOVE, OP_MUL_MOVE,
+    OP_ADDI_MOVE, OP_SUBI_MOVE, OP_MULI_MOVE,
+    OP_NUM
+} VMOpcode;
+
+/*运行结果*/
+#define VM_OK 0
+#define VM_DIV_ZERO 1
+#define VM_BAD_INPUT 2
+
+/*解码后的指令，操作数都是寄存器文件的下标（常量也预先放在寄存器中），
+ * 跳转指令的c为目标指令的下标。字节码文件中的指令记录与它逐字节相同*/
+typedef struct VMInstrRec {
+    union {
+        const void *handler;/*直接线程化分派时处理代码的地址，第一次运行时填写*/
+        int64_t reserved;/*文件中为0，使记录在各平台上都是24字节*/
+    } u;
+    int32_t op;
+    int32_t a, b, c;
+} VMInstr;
+
+/*可执行的程序。各个表可以单独分配，也可以直接指向映射进来的字节码文件*/
+typedef struct VMProgramRec {
+    VMInstr *code;
+    int codeNum;/*最后一条总是HALT*/
+    int32_t *init;/*常量池：寄存器的初值，变量为0，常量为其值*/
+    int regNum;
+    int32_t *lines;/*每条指令的源程序行号，编译器插入的为0*/
+    int32_t *nameOff;/*符号表：寄存器对应的变量名或常量在字符串池中的偏移*/
+    int32_t *stringOff;/*字符串常量在字符串池中的偏移，字符串的值是它在此表中的下标*/
+    int stringNum;
+    char *pool;/*字符串池，每个字符串以'\0'结尾*/
+    int poolSize;
+    FILE *in;/*IN和OUT使用的文件，默认为stdin和stdout*/
+    FILE *out;
+    VMInstr *super;/*执行用的指令，与code一一对应，在可能的地方换成超级指令，第一次运行时建立*/
+    int threadedLoaded;/*super中的handler是否已填写*/
+    void *mapping;/*从字节码文件映射时为映射的区域，否则为NULL*/
+    size_t mappingSize;
+} VMProgram;
+
+/*寄存器对应的变量名或常量*/
+#define vmSlotName(prog, slot) ((prog)->pool + (prog)->nameOff[slot])
+
+/*第k个字符串常量*/
+#define vmString(prog, k) ((prog)->pool + (prog)->stringOff[k])
+
+/*把当前的四元式解码为虚拟机程序*/
+VMProgram *vmLoad(void);
+
+/*释放程序*/
+void vmFree(VMProgram *prog);
+
+/*执行程序，threaded为TRUE时使用直接线程化分派（编译器不支持computed goto时退回switch），
+ * 返回VM_OK或运行错误*/
+int vmRun(VMProgram *prog, int threaded);
+
+/*是否支持直接线程化分派*/
+int vmThreadedAvailable(void);
+
+/*重新建立prog->super，enable为FALSE时不用超级指令。vmRun第一次运行时自动以TRUE调用*/
+void vmSelectSuper(VMProgram *prog, int enable);
+
+/*执行剖析：每条指令的执行次数，条件跳转另外记下跳转的次数*/
+typedef struct VMProfileRec {
+    uint64_t *counts;
+    uint64_t *taken;
+    int codeNum;
+} VMProfile;
+
+/*为程序建立全为0的剖析*/
+VMProfile *vmProfileNew(VMProgram *prog);
+
+void vmProfileFree(VMProfile *profile);
+
+/*用switch分派执行程序，同时把执行次数累加到profile中。计数的执行不用超级指令*/
+int vmRunProfiled(VMProgram *prog, VMProfile *profile);
+
+/*按剖析计算分派的次数，super为TRUE时按vmSelectSuper选出的超级指令计算*/
+uint64_t vmDispatchCount(VMProgram *prog, VMProfile *profile, int super);
+
+#endif //TINY_VM_H
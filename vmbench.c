@@ -0,0 +1,102 @@
+//
+// Created by liang on 2020/7/10.
+//
+#include <time.h>
+#include <inttypes.h>
+#include "globals.h"
+#include "util.h"
+#include "parse.h"
+#include "analyze.h"
+#include "translate.h"
+#include "vm.h"
+#include "jit.h"
+#include "trace.h"
+#include "outbuf.h"
+
+/*比较虚拟机switch分派、直接线程化分派和即时编译的速度：
+ * vmbench <filename> [runs]，程序的输出被丢弃，输入从stdin读入时只能运行一次。
+ * 同时输出不用超级指令时直接线程化分派的时间，以及用与不用超级指令时的分派次数*/
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*执行runs次，返回每次的平均时间（秒）。jit不为NULL时执行本机代码*/
+static double timeRuns(VMProgram *prog, JITCode *jit, int threaded, int runs) {
+    int i;
+    double start = now();
+    for (i = 0; i < runs; i++)
+        if ((jit != NULL ? jitRun(jit, prog) : vmRun(prog, threaded)) != VM_OK) {
+            fprintf(stderr, "Runtime error\n");
+            exit(1);
+        }
+    return (now() - start) / runs;
+}
+
+int main(int argc, char *argv[]) {
+    TreeNode *syntaxTree;
+    VMProgram *prog;
+    JITCode *jit;
+    VMProfile *profile;
+    uint64_t base, fused;
+    int runs = 5;
+    double sw, th, plain, jt = 0;
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "usage: %s <filename> [runs]\n", argv[0]);
+        exit(1);
+    }
+    if (argc == 3)
+        runs = atoi(argv[2]);
+    if (runs < 1)
+        runs = 1;
+    source = fopen(argv[1], "r");
+    if (source == NULL) {
+        fprintf(stderr, "File %s not found\n", argv[1]);
+        exit(1);
+    }
+    listing = stderr;
+    traceSetAll(0);
+    code = fopen("/dev/null", "w");
+    syntaxTree = parse();
+    if (!Error)
+        buildSymTab(syntaxTree);
+    if (Error)
+        exit(1);
+    codeGen(syntaxTree, "/dev/null");
+    outClose(code);
+    fclose(code);
+    fclose(source);
+
+    prog = vmLoad();
+    prog->out = fopen("/dev/null", "w");
+    /*先各运行一次预热缓存，并填好线程化分派的处理地址*/
+    jit = jitCompile(prog);
+    timeRuns(prog, NULL, FALSE, 1);
+    timeRuns(prog, NULL, TRUE, 1);
+    sw = timeRuns(prog, NULL, FALSE, runs);
+    th = timeRuns(prog, NULL, TRUE, runs);
+    vmSelectSuper(prog, FALSE);
+    timeRuns(prog, NULL, TRUE, 1);
+    plain = timeRuns(prog, NULL, TRUE, runs);
+    vmSelectSuper(prog, TRUE);
+    profile = vmProfileNew(prog);
+    vmRunProfiled(prog, profile);
+    base = vmDispatchCount(prog, profile, FALSE);
+    fused = vmDispatchCount(prog, profile, TRUE);
+    vmProfileFree(profile);
+    if (jit != NULL)
+        jt = timeRuns(prog, jit, FALSE, runs);
+    printf("%-24s %6d instrs  switch %9.3f ms  threaded %9.3f ms  speedup %.2fx%s",
+           argv[1], prog->codeNum, sw * 1e3, th * 1e3, th > 0 ? sw / th : 0.0,
+           vmThreadedAvailable() ? "" : " (no computed goto)");
+    if (jit != NULL)
+        printf("  jit %9.3f ms  speedup %.2fx", jt * 1e3, jt > 0 ? sw / jt : 0.0);
+    printf("\n%-24s superinstructions: threaded %9.3f ms without  dispatches %" PRIu64 " -> %" PRIu64 " (%.1f%%)\n",
+           "", plain * 1e3, base, fused, base > 0 ? fused * 100.0 / base : 0.0);
+    jitFree(jit);
+    fclose(prog->out);
+    vmFree(prog);
+    return 0;
+}